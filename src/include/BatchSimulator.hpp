@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    struct BatchStatistics {
+        std::size_t completedJobs = 0;
+        std::size_t parallelJobs = 0;
+        std::size_t stolenTasks = 0;
+    };
+
+    /**
+     * Receives solution of job-th environment of batch, called on worker thread.
+    */
+    typedef std::function<void(std::size_t job, Solution &&solution)> BatchCallback;
+
+    /**
+     * Work-stealing pool which runs batches of environments. Every worker owns a deque of jobs and
+     * a deque of gate pieces of big jobs. Worker takes its own pieces first, then steals pieces of
+     * others, then takes its own jobs and steals jobs of others, so free workers join big job before
+     * starting new ones.
+     * Job of at most 2^parallelQubits amplitudes runs on one worker, bigger job is split into pieces
+     * of at least 2^parallelQubits amplitudes, up to one piece per worker. State of job is built
+     * directly in state of its solution, so worker keeps no memory between jobs.
+    */
+    class BatchSimulator : public Simulator<QubitEnv> {
+        // argument is index of worker which runs task
+        typedef std::function<void(std::size_t)> Task;
+
+        struct Worker;
+
+        std::size_t threads;
+        uint32_t parallelQubits;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> pool;
+
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        std::atomic<std::size_t> queuedTasks{0};
+        std::atomic<std::size_t> nextWorker{0};
+        bool isStopping = false;
+
+        std::atomic<std::size_t> completedJobs{0};
+        std::atomic<std::size_t> parallelJobs{0};
+        std::atomic<std::size_t> stolenTasks{0};
+
+        void post(Task &&task, bool isPiece, std::size_t worker);
+        bool takeTask(std::size_t self, Task &task, bool piecesOnly);
+        void workerLoop(std::size_t self);
+
+        /**
+         * Runs f(piece) for every piece in [0, pieces), piece 0 on calling worker, other pieces are
+         * pushed to its deque. Caller runs pieces until all of them are done.
+        */
+        void parallelFor(std::size_t self, std::size_t pieces, const std::function<void(std::size_t)> &f);
+
+        Solution execute(std::size_t self, const QubitEnv &env);
+
+        public:
+        BatchSimulator(std::size_t threads = 0, uint32_t parallelQubits = 16);
+        ~BatchSimulator();
+
+        BatchSimulator(const BatchSimulator &) = delete;
+        BatchSimulator& operator=(const BatchSimulator &) = delete;
+
+        /**
+         * Queues every environment of batch, future of job i holds its solution or exception.
+        */
+        std::vector<std::future<Solution>> submit(std::vector<QubitEnv> jobs);
+
+        /**
+         * Queues every environment of batch and passes solutions to callback as soon as they are ready,
+         * in any order. Returned future is ready when the whole batch is done and holds the first
+         * exception thrown by a job or by callback.
+        */
+        std::future<void> submit(std::vector<QubitEnv> jobs, BatchCallback callback);
+
+        /**
+         * Runs batch and waits for it, solutions are in order of jobs.
+        */
+        std::vector<Solution> run(std::vector<QubitEnv> jobs);
+
+        /**
+         * Runs single environment on pool. Must not be called from callback, it blocks worker.
+        */
+        Solution constructSolution(const QubitEnv &env) override;
+
+        /**
+         * Amount of workers which run job of given size.
+        */
+        std::size_t threadsFor(std::size_t qubitsCount) const;
+
+        BatchStatistics getStatistics() const;
+
+        std::size_t getThreadsCount() const {
+            return threads;
+        }
+    };
+
+} // simulator
+} // qce
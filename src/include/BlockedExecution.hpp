@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    struct BlockedStatistics {
+        std::size_t blockedRuns = 0;
+        std::size_t blockedGates = 0;
+        std::size_t sweeps = 0;
+    };
+
+    /**
+     * Applies run of gates whose qubits are all stored below blockBits tile by tile: the whole run
+     * is applied to one tile of 2^blockBits amplitudes while it stays in cache, then to the next one.
+    */
+    void applyBlockedRun(
+        kernels::Amplitude_t *amplitudes,
+        uint64_t size,
+        const operations::Node<operations::GateRecord> *gates,
+        std::size_t count,
+        const operations::GateOperands &operands,
+        const kernels::BitLayout &layout,
+        uint32_t blockBits
+    );
+
+    /**
+     * Simulator which splits compiled gate list into maximal runs of consecutive gates acting
+     * below blockBits. Every run costs one sweep over state instead of one sweep per gate,
+     * other gates are applied one by one. Default tile of 2^14 amplitudes takes 256 KiB.
+    */
+    class BlockedSimulator : public Simulator<QubitEnv> {
+        uint32_t blockBits;
+        BlockedStatistics statistics;
+
+        public:
+        BlockedSimulator(uint32_t blockBits = 14);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        const BlockedStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+} // simulator
+} // qce
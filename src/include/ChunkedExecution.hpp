@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+#include "ChunkedState.hpp"
+
+namespace qce {
+namespace simulator {
+
+    struct ChunkedStatistics {
+        std::size_t gatePasses = 0;
+        std::size_t swapPasses = 0;
+        // gates applied before some gate which preceded them in compiled list
+        std::size_t reorderedGates = 0;
+    };
+
+    /**
+     * Runs env on state of env's qubits count and leaves result in natural layout.
+     * State is streamed chunk by chunk. Gates are reordered so that one pass applies every gate
+     * which only touches local qubits and doesn't depend on pending non-local gates. When nothing
+     * local is left, planRemap chooses high qubits for upcoming gates, and each of them is
+     * exchanged with a low qubit in one pass over pairs of chunks.
+    */
+    void runChunked(const QubitEnv &env, ChunkedState &state, std::size_t lookahead, ChunkedStatistics &statistics);
+
+    /**
+     * Simulator for states too big for one allocation, chunks are allocated separately.
+     * Default chunk of 2^24 amplitudes takes 256 MiB.
+    */
+    class ChunkedSimulator : public Simulator<QubitEnv> {
+        uint32_t chunkBits;
+        std::size_t lookahead;
+        ChunkedStatistics statistics;
+
+        public:
+        ChunkedSimulator(uint32_t chunkBits = 24, std::size_t lookahead = 256);
+
+        /**
+         * Runs env and returns chunked state without copying it into contiguous memory.
+        */
+        ChunkedState run(const QubitEnv &env);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        const ChunkedStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+    /**
+     * Simulator which keeps state in memory mapped file, so state may exceed physical memory.
+     * Every pass reads the file sequentially.
+    */
+    class OutOfCoreSimulator : public Simulator<QubitEnv> {
+        std::string directory;
+        uint32_t chunkBits;
+        std::size_t lookahead;
+        ChunkedStatistics statistics;
+
+        public:
+        /**
+         * State file is created in directory, empty directory means TMPDIR or /tmp.
+         * Default chunk of 2^20 amplitudes takes 16 MiB.
+        */
+        OutOfCoreSimulator(const std::string &directory = "", uint32_t chunkBits = 20, std::size_t lookahead = 256);
+
+        /**
+         * Runs env and returns state in natural layout without copying it into memory.
+        */
+        ChunkedState run(const QubitEnv &env);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        const ChunkedStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+} // simulator
+} // qce
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Qubit.h"
+#include "GateKernels.hpp"
+#include "MappedFile.hpp"
+
+namespace qce {
+namespace simulator {
+
+    /**
+     * State vector accessed by chunks of 2^chunkBits amplitudes. Qubits stored below chunkBits are
+     * local to every chunk, so gates on them are applied to chunks one after another with in-memory
+     * kernels, higher bits select chunk.
+     * Chunks are either separate allocations, so huge state doesn't need one contiguous range of
+     * address space, or pieces of memory mapped file, which are left to page cache when not
+     * accessed, so state may be larger than RAM.
+    */
+    class ChunkedState {
+        utils::MappedFile file;
+        std::vector<std::unique_ptr<kernels::Amplitude_t[]>> chunks;
+        std::size_t qubitsCount = 0;
+        uint32_t chunkBits = 0;
+
+        public:
+        ChunkedState() {}
+
+        /**
+         * State in memory, amplitudes are zero.
+        */
+        ChunkedState(std::size_t qubitsCount, uint32_t chunkBits);
+
+        /**
+         * State in memory mapped file, file must hold 2^qubitsCount amplitudes.
+        */
+        ChunkedState(utils::MappedFile &&file, std::size_t qubitsCount, uint32_t chunkBits);
+
+        bool isMapped() const {
+            return chunks.empty();
+        }
+
+        std::size_t getQubitsCount() const {
+            return qubitsCount;
+        }
+
+        uint64_t size() const {
+            return uint64_t(1) << qubitsCount;
+        }
+
+        uint32_t getChunkBits() const {
+            return chunkBits;
+        }
+
+        uint64_t getChunkSize() const {
+            return uint64_t(1) << chunkBits;
+        }
+
+        uint64_t getChunksCount() const {
+            return size() >> chunkBits;
+        }
+
+        kernels::Amplitude_t* chunk(uint64_t index) {
+            if (!isMapped()) {
+                return chunks[index].get();
+            }
+            return reinterpret_cast<kernels::Amplitude_t*>(file.data()) + index * getChunkSize();
+        }
+
+        const kernels::Amplitude_t* chunk(uint64_t index) const {
+            if (!isMapped()) {
+                return chunks[index].get();
+            }
+            return reinterpret_cast<const kernels::Amplitude_t*>(file.data()) + index * getChunkSize();
+        }
+
+        kernels::Amplitude_t operator[](uint64_t index) const {
+            return chunk(index >> chunkBits)[index & (getChunkSize() - 1)];
+        }
+
+        /**
+         * Asks kernel to start reading chunk of mapped state in background.
+        */
+        void prefetch(uint64_t index) const;
+
+        /**
+         * Drops chunk of mapped state from address space. Dirty pages stay in page cache and are
+         * written back by kernel, so resident memory is bounded by chunks of current pass.
+        */
+        void release(uint64_t index) const;
+
+        /**
+         * Copies whole state into contiguous memory.
+        */
+        DynamicQubitState load() const;
+
+        const utils::MappedFile& getFile() const {
+            return file;
+        }
+    };
+
+} // simulator
+} // qce
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Qubit.h"
+#include "GateRecord.hpp"
+#include "MappedFile.hpp"
+#include "Simulator.hpp"
+
+namespace qce {
+namespace operations {
+
+    /**
+     * Layout of circuit file, all fields are in native byte order:
+     * header, parameter table of parametersCount doubles, then opcode stream of streamBytes.
+     * Initial state of qubit q is parameters 4q..4q+3 (real and imaginary parts of |0> and |1>
+     * amplitudes), the rest of table is reserved for parameters of gates.
+     * Every gate in stream is opcode byte (GateKind) followed by varint target and, for two qubit
+     * gates, varint control. Multi-controlled and unitary gates have varint controls count and varint controls
+     * instead of control, then varint second target for MCSwap and its values as pairs of raw
+     * doubles. Varint stores 7 bits per byte, low bits first, high bit of byte is set
+     * when more bytes follow.
+     * checksum covers parameter table and opcode stream.
+    */
+    struct CircuitHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t qubitsCount;
+        uint64_t gatesCount;
+        uint64_t parametersCount;
+        uint64_t streamBytes;
+        uint64_t checksum;
+    };
+
+    const uint32_t CIRCUIT_FORMAT_VERSION = 1;
+
+    inline void appendVarint(std::vector<uint8_t> &buffer, uint64_t value) {
+        while (value >= 0x80) {
+            buffer.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back((uint8_t)value);
+    }
+
+    /**
+     * Decodes varint at position and moves position past it, returns false if stream ends
+     * before varint does or varint doesn't fit into 64 bits.
+    */
+    inline bool readVarint(const uint8_t *&position, const uint8_t *end, uint64_t &value) {
+        value = 0;
+        for (uint32_t shift = 0; shift < 64 && position != end; shift += 7) {
+            uint8_t byte = *position++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Streaming writer of circuit file, gates are encoded into buffer which is flushed to file
+     * by large writes, so circuits of any length are written in constant memory.
+     * File is complete only after close(), destructor closes it silently.
+    */
+    class CircuitWriter {
+        std::ofstream file;
+        std::string path;
+        CircuitHeader header;
+        std::vector<uint8_t> buffer;
+        uint64_t checksum;
+        bool isClosed = false;
+
+        void flush();
+
+        public:
+        CircuitWriter(const std::string &path, const std::vector<QubitState> &initialStates);
+        ~CircuitWriter();
+
+        CircuitWriter(const CircuitWriter &) = delete;
+        CircuitWriter& operator=(const CircuitWriter &) = delete;
+
+        void add(const GateRecord &gate);
+
+        /**
+         * Adds gate with its entry in operands of circuit, for multi-controlled gates.
+        */
+        void add(const GateRecord &gate, const GateOperands &operands);
+
+        void close();
+    };
+
+    /**
+     * Writes initial states and compiled gates of deferred env.
+    */
+    void writeCircuit(const std::string &path, const QubitEnv &env);
+
+    /**
+     * Read-only mapping of circuit file. Gates are decoded straight from mapped opcode stream,
+     * nothing is allocated per gate, so executor can start as soon as file is mapped.
+    */
+    class MappedCircuit {
+        utils::MappedFile file;
+        CircuitHeader header;
+        const double *parameters = nullptr;
+        const uint8_t *stream = nullptr;
+
+        public:
+        /**
+         * Throws std::runtime_error if file is damaged or of unknown version, checksum is verified
+         * with one sequential read when verify is set.
+        */
+        MappedCircuit(const std::string &path, bool verify = true);
+
+        std::size_t getQubitsCount() const {
+            return header.qubitsCount;
+        }
+
+        uint64_t getGatesCount() const {
+            return header.gatesCount;
+        }
+
+        std::vector<QubitState> getInitialStates() const;
+
+        const double* getParameters() const {
+            return parameters;
+        }
+
+        uint64_t getParametersCount() const {
+            return header.parametersCount;
+        }
+
+        /**
+         * Sequential decoder of opcode stream.
+        */
+        class Cursor {
+            const uint8_t *position;
+            const uint8_t *end;
+            uint32_t qubitsCount;
+            GateOperands operands;
+
+            public:
+            Cursor(const uint8_t *begin, const uint8_t *end, uint32_t qubitsCount):
+                position{begin}, end{end}, qubitsCount{qubitsCount} {}
+
+            /**
+             * Decodes next gate, returns false at the end of stream.
+             * Throws std::runtime_error on malformed gate.
+            */
+            bool next(GateRecord &gate);
+
+            /**
+             * Operands of the last multi-controlled gate, valid until the next call of next().
+            */
+            const GateOperands& getOperands() const {
+                return operands;
+            }
+        };
+
+        Cursor cursor() const {
+            return Cursor(stream, stream + header.streamBytes, header.qubitsCount);
+        }
+
+        /**
+         * Calls f(gate, operands) or f(gate) for every gate, the latter is enough for circuits
+         * without multi-controlled gates.
+        */
+        template<typename F>
+        void forEachGate(F f) const {
+            Cursor gates = cursor();
+            GateRecord gate;
+            while (gates.next(gate)) {
+                if constexpr (std::is_invocable_v<F, const GateRecord&, const GateOperands&>) {
+                    f(gate, gates.getOperands());
+                } else {
+                    f(gate);
+                }
+            }
+        }
+    };
+
+} // namespace operations
+
+namespace simulator {
+
+    /**
+     * Runs mapped circuit gate by gate as it is decoded, no graph is built.
+    */
+    class StreamSimulator : public Simulator<operations::MappedCircuit> {
+        public:
+        Solution constructSolution(const operations::MappedCircuit &circuit) override;
+    };
+
+} // namespace simulator
+} // namespace qce
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GateRecord.hpp"
+
+namespace qce {
+namespace operations {
+
+    struct OptimizationReport {
+        std::size_t gatesBefore = 0;
+        std::size_t gatesAfter = 0;
+        std::size_t cancelledPairs = 0;
+        std::size_t mergedPairs = 0;
+        std::size_t passes = 0;
+
+        std::size_t removedGates() const {
+            return gatesBefore - gatesAfter;
+        }
+    };
+
+    /**
+     * Peephole optimization of gate list. Every gate is matched with following gates on its qubits
+     * as long as gates in between commute with it: self-inverse pairs (H·H, X·X, CNOT·CNOT, CZ·CZ, ...)
+     * are cancelled, S·S is merged into Z and CS·CS into CZ. Passes are repeated until nothing changes,
+     * so applying optimization to its result removes nothing.
+     * Lookahead limits amount of gates sharing qubits with current one which are inspected.
+    */
+    OptimizationReport optimizeGates(std::vector<GateRecord> &gates, std::size_t lookahead = 64);
+
+    /**
+     * Optimization of gates with operands of their circuit. Multi-controlled X, Z and swap gates
+     * with the same qubits are cancelled too.
+    */
+    OptimizationReport optimizeGates(std::vector<GateRecord> &gates, const GateOperands &operands, std::size_t lookahead = 64);
+
+} // namespace operations
+} // namespace qce
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GateRecord.hpp"
+#include "OperationGraph.hpp"
+
+namespace qce {
+namespace operations {
+
+    /**
+     * How gate acts on one of its qubits. Gates commute on shared qubit if both act on it
+     * along the same axis: diagonal gates (Z, S, CZ, control of CNOT) commute with each other,
+     * X and CNOT target commute with each other, and so on.
+    */
+    enum class QubitAction : uint8_t {
+        Diagonal,
+        XAxis,
+        YAxis,
+        General
+    };
+
+    QubitAction qubitAction(const GateRecord &record, uint32_t qubit);
+
+    /**
+     * Sufficient condition for two gates to commute.
+    */
+    bool commutes(const GateRecord &first, const GateRecord &second);
+
+    /**
+     * Sufficient condition for two gates of circuit with given operands to commute.
+    */
+    bool commutes(const GateRecord &first, const GateRecord &second, const GateOperands &operands);
+
+    struct DepthStatistics {
+        std::size_t gateCount = 0;
+        std::size_t multiQubitGateCount = 0;
+        std::size_t depth = 0;
+        std::size_t maxLayerWidth = 0;
+    };
+
+    /**
+     * Dependency DAG of gate list. Every gate is linked with previous and next gate on each of its
+     * qubits, gates are assigned to the earliest layer after all their predecessors, so gates of
+     * one layer act on disjoint qubits and can be scheduled together.
+    */
+    class DependencyGraph {
+        #ifndef NO_NODE_INDEX
+            #define NO_NODE_INDEX SIZE_MAX
+        #endif
+
+        public:
+        struct QubitLink {
+            uint32_t qubit;
+            std::size_t predecessor;
+            std::size_t successor;
+        };
+
+        private:
+        std::vector<GateRecord> gates;
+        // links of gate i are links[linkOffsets[i] .. linkOffsets[i+1])
+        std::vector<std::size_t> linkOffsets;
+        std::vector<QubitLink> links;
+        std::vector<std::size_t> layerOfGate;
+        std::vector<std::vector<std::size_t>> layers;
+
+        public:
+        DependencyGraph(const std::vector<Node<GateRecord>> &nodes, std::size_t qubitCount);
+        DependencyGraph(const std::vector<Node<GateRecord>> &nodes, const GateOperands &operands, std::size_t qubitCount);
+
+        std::size_t size() const {
+            return gates.size();
+        }
+
+        const GateRecord& getGate(std::size_t index) const {
+            return gates[index];
+        }
+
+        std::vector<QubitLink> getLinks(std::size_t index) const;
+        std::vector<std::size_t> getPredecessors(std::size_t index) const;
+        std::vector<std::size_t> getSuccessors(std::size_t index) const;
+
+        std::size_t getLayer(std::size_t index) const {
+            return layerOfGate[index];
+        }
+
+        std::size_t getDepth() const {
+            return layers.size();
+        }
+
+        /**
+         * Gate indices of every layer in topological order.
+        */
+        const std::vector<std::vector<std::size_t>>& getLayers() const {
+            return layers;
+        }
+
+        /**
+         * Topological iteration, f is called with gate indices of every layer.
+        */
+        template<typename F>
+        void forEachLayer(F f) const {
+            for (const std::vector<std::size_t> &layer: layers) {
+                f(layer);
+            }
+        }
+
+        DepthStatistics getStatistics() const;
+    };
+
+} // namespace operations
+} // namespace qce
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "Qubit.h"
+#include "GateRecord.hpp"
+
+namespace qce {
+namespace kernels {
+
+    typedef std::complex<double> Amplitude_t;
+
+    /**
+     * Maps logical qubit of environment to bit of amplitude index.
+     * Natural layout places qubit 0 at the most significant bit, like qubit order
+     * of gate classes does.
+    */
+    class BitLayout {
+        std::vector<uint32_t> bits;
+
+        public:
+        BitLayout() {}
+        explicit BitLayout(std::size_t qubitCount);
+
+        uint32_t bitOf(std::size_t qubit) const {
+            return bits[qubit];
+        }
+
+        std::size_t getQubitsCount() const {
+            return bits.size();
+        }
+
+        /**
+         * Qubit stored at given bit.
+        */
+        std::size_t qubitAt(uint32_t bit) const;
+
+        /**
+         * Exchanges bits of two qubits, amplitudes must be permuted accordingly.
+        */
+        void swapQubits(std::size_t first, std::size_t second);
+
+        /**
+         * Layout as qubit order of gate classes: qubit order[p] is stored at bit n-p-1.
+        */
+        std::vector<std::size_t> getQubitOrder() const;
+
+        bool operator==(const BitLayout &other) const {
+            return bits == other.bits;
+        }
+
+        bool operator!=(const BitLayout &other) const {
+            return bits != other.bits;
+        }
+    };
+
+    /**
+     * Inserts zero bit at given position of index, so that iterating over value
+     * in [0, size/2) visits every index with that bit cleared.
+    */
+    inline uint64_t insertZeroBit(uint64_t value, uint32_t bit) {
+        uint64_t low = value & ((uint64_t(1) << bit) - 1);
+        return ((value >> bit) << (bit + 1)) | low;
+    }
+
+    /**
+     * Matrix of single qubit gate kind.
+    */
+    QubitMat_t gateMatrix(operations::GateKind kind);
+
+    /**
+     * Product state of given single qubit states, qubit 0 is the most significant.
+     * Throws std::invalid_argument for 64 or more states.
+    */
+    DynamicQubitState productState(const std::vector<QubitState> &states);
+
+    /**
+     * Applies 2x2 matrix to qubit stored at given bit of amplitudes.
+    */
+    void applyMatrix(Amplitude_t *amplitudes, uint64_t size, const QubitMat_t &matrix, uint32_t bit);
+
+    /**
+     * Part-th of parts equal pieces of applyMatrix. Pieces touch distinct amplitudes,
+     * so they can be applied concurrently; for bits below log2(size/parts) piece p touches
+     * only p-th contiguous piece of amplitudes.
+    */
+    void applyMatrixPart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const QubitMat_t &matrix,
+        uint32_t bit,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Applies gate in place. Bits are positions of target and control qubits in amplitude index,
+     * controlBit is ignored for single qubit gates. Amplitude count must be a power of two
+     * greater than both bits.
+    */
+    void applyGate(Amplitude_t *amplitudes, uint64_t size, operations::GateKind kind, uint32_t targetBit, uint32_t controlBit);
+
+    void applyGate(Amplitude_t *amplitudes, uint64_t size, const operations::GateRecord &record, const BitLayout &layout);
+
+    /**
+     * Part-th of parts equal pieces of applyGate, see applyMatrixPart.
+    */
+    void applyGatePart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        operations::GateKind kind,
+        uint32_t targetBit,
+        uint32_t controlBit,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    void applyGatePart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const operations::GateRecord &record,
+        const BitLayout &layout,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    void applyGate(DynamicQubitState &state, const operations::GateRecord &record, const BitLayout &layout);
+
+    /**
+     * Part-th of parts equal pieces of multi-controlled gate. Only amplitudes with every control bit
+     * set are visited, 1/2^c of state for c controls, the rest of state isn't read at all.
+     * secondBit is the other target of MCSwap, values are phase of MCPhase or row-major matrix of MCU.
+    */
+    void applyControlledGatePart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        operations::GateKind kind,
+        uint32_t targetBit,
+        uint32_t secondBit,
+        const std::vector<uint32_t> &controlBits,
+        const Amplitude_t *values,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Part-th of parts equal pieces of unitary on k = qubitBits.size() qubits, 1 <= k <= 5. Matrix is
+     * row-major 2^k x 2^k, qubitBits[0] is the most significant bit of its index. Every group of 2^k
+     * amplitudes is gathered into fixed-size vector, multiplied by matrix and scattered back, kernel
+     * is instantiated per k, so sizes of loops are known to compiler.
+    */
+    void applyUnitaryPart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const std::vector<uint32_t> &qubitBits,
+        const Amplitude_t *matrix,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Register operations below act on groups of 2^k amplitudes which differ only in given bits,
+     * bits[0] is the most significant bit of value of the group. Every group is handled in one
+     * pass, so operation costs a single sweep over state instead of a sweep per gate of its
+     * decomposition.
+    */
+
+    /**
+     * Part-th of parts equal pieces of quantum Fourier transform, or its inverse, by radix-2 FFT of
+     * every group: O(k 2^n) instead of O(k^2) sweeps of Hadamard and controlled phase gates.
+    */
+    void applyFourierPart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const std::vector<uint32_t> &bits,
+        bool inverse,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Part-th of parts equal pieces of Grover diffusion 2|s><s| - I, every group is reflected
+     * about its mean.
+    */
+    void applyDiffusionPart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const std::vector<uint32_t> &bits,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Part-th of parts equal pieces of diagonal gate, amplitude is multiplied by phases[v] for value v
+     * of its group.
+    */
+    void applyPhaseTablePart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const std::vector<uint32_t> &bits,
+        const Amplitude_t *phases,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Pauli string of PauliRotation record as bits of layout, Y factors are set in both masks.
+    */
+    struct PauliMasks {
+        uint64_t xMask = 0;
+        uint64_t zMask = 0;
+        std::size_t yCount = 0;
+    };
+
+    PauliMasks pauliMasksOf(
+        const operations::GateRecord &record,
+        const operations::GateOperands &operands,
+        const BitLayout &layout
+    );
+
+    /**
+     * Part-th of parts equal pieces of exp(-i theta P) for Pauli string P = i^yCount X(xMask) Z(zMask),
+     * where Y factors are counted in both masks. P maps index x to x ^ xMask with sign of parity of
+     * x & zMask, so rotation mixes every pair (x, x ^ xMask) in one pass, diagonal P (xMask = 0)
+     * only multiplies amplitudes by phases.
+    */
+    void applyPauliRotationPart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        uint64_t xMask,
+        uint64_t zMask,
+        std::size_t yCount,
+        double theta,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    /**
+     * Record-based kernels for gates of any kind, multi-controlled gates take operands of their circuit.
+    */
+    void applyGate(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const operations::GateRecord &record,
+        const operations::GateOperands &operands,
+        const BitLayout &layout
+    );
+
+    void applyGatePart(
+        Amplitude_t *amplitudes,
+        uint64_t size,
+        const operations::GateRecord &record,
+        const operations::GateOperands &operands,
+        const BitLayout &layout,
+        std::size_t part,
+        std::size_t parts
+    );
+
+    void applyGate(
+        DynamicQubitState &state,
+        const operations::GateRecord &record,
+        const operations::GateOperands &operands,
+        const BitLayout &layout
+    );
+
+    /**
+     * Exchanges given pairs of bits of every amplitude index in one sweep. Pairs must be disjoint,
+     * then permutation is an involution and is applied in place.
+    */
+    void swapBits(Amplitude_t *amplitudes, uint64_t size, const std::vector<std::pair<uint32_t, uint32_t>> &bitPairs);
+
+    /**
+     * Permutes amplitudes stored in layout `from` so that they are stored in layout `to`.
+     * Needs a few sweeps of swapBits, every sweep places at least one misplaced qubit.
+    */
+    void changeLayout(Amplitude_t *amplitudes, uint64_t size, BitLayout &from, const BitLayout &to);
+
+} // namespace kernels
+} // namespace qce
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace qce {
+namespace operations {
+
+    /**
+     * Kind of gate described by GateRecord.
+    */
+    enum class GateKind : uint8_t {
+        Hadamard,
+        X,
+        Y,
+        Z,
+        S,
+        Cnot,
+        Swap,
+        CZ,
+        CPhase,
+        MCX,
+        MCZ,
+        MCPhase,
+        MCSwap,
+        MCU,
+        Unitary,
+        QFT,
+        IQFT,
+        GroverDiffusion,
+        PhaseOracle,
+        PauliRotation
+    };
+
+    /**
+     * Multi-controlled kinds have any number of controls, Unitary and register operations (QFT,
+     * IQFT, GroverDiffusion, PhaseOracle, PauliRotation) have any number of qubits, which don't fit GateRecord,
+     * so they are kept in GateOperands of circuit.
+    */
+    inline bool hasOperands(GateKind kind) {
+        return kind >= GateKind::MCX;
+    }
+
+    /**
+     * Unitary and register operations act on ordered list of qubits: target, then the rest of
+     * qubits kept as controls of operands entry. Controls of these kinds aren't conditions.
+    */
+    inline bool isRegisterGate(GateKind kind) {
+        return kind >= GateKind::Unitary;
+    }
+
+    /**
+     * Amount of complex values kept in operands of gate of given kind with given controls count.
+    */
+    inline std::size_t operandValuesCount(GateKind kind, std::size_t controlsCount) {
+        if (kind == GateKind::Unitary) {
+            return std::size_t(1) << (2 * (controlsCount + 1));
+        }
+        if (kind == GateKind::PhaseOracle) {
+            return std::size_t(1) << (controlsCount + 1);
+        }
+        if (kind == GateKind::PauliRotation) {
+            return controlsCount + 2;
+        }
+        return kind == GateKind::MCU ? 4 : kind == GateKind::MCPhase ? 1 : 0;
+    }
+
+    /**
+     * Pauli factor of PauliRotation, kept as real part of its operand value.
+    */
+    enum class PauliCode : uint8_t {
+        I,
+        X,
+        Y,
+        Z
+    };
+
+    const std::size_t MAX_UNITARY_QUBITS = 5;
+    // phase table of oracle has 2^k values
+    const std::size_t MAX_ORACLE_QUBITS = 24;
+
+    #ifndef NO_CONTROL_QUBIT
+        #define NO_CONTROL_QUBIT UINT32_MAX
+    #endif
+
+    /**
+     * Compact value-type description of a gate.
+     * Qubit indices are logical indices of qubits in environment, so record doesn't depend on
+     * amount of qubits and doesn't own any memory. Records are stored contiguously in OperationGraph
+     * and gate classes (HadamardGate, CnotGate, ...) act as facades over them.
+     * Record of multi-controlled kind stores offset of its entry in GateOperands as control.
+    */
+    struct GateRecord {
+        GateKind kind;
+        uint32_t target;
+        uint32_t control;
+
+        GateRecord(): kind{GateKind::Hadamard}, target{0}, control{NO_CONTROL_QUBIT} {}
+
+        GateRecord(GateKind kind, uint32_t target, uint32_t control = NO_CONTROL_QUBIT):
+            kind{kind}, target{target}, control{control} {}
+
+        bool hasControl() const {
+            return control != NO_CONTROL_QUBIT && !hasOperands(kind);
+        }
+
+        bool operator==(const GateRecord &other) const {
+            return kind == other.kind && target == other.target && control == other.control;
+        }
+
+        bool operator!=(const GateRecord &other) const {
+            return !(*this == other);
+        }
+    };
+
+    static_assert(sizeof(GateRecord) <= 12, "GateRecord is expected to stay compact");
+
+    #ifndef NO_OPERAND_VALUES
+        #define NO_OPERAND_VALUES UINT32_MAX
+    #endif
+
+    /**
+     * Pool of operands of multi-controlled gates, one per circuit. Entry is controls count,
+     * second target (NO_CONTROL_QUBIT unless MCSwap), offset of values (NO_OPERAND_VALUES unless
+     * MCPhase, MCU or Unitary) and controls. Values are phase of MCPhase or row-major 2x2 matrix
+     * of MCU. Unitary gate keeps the rest of its qubits as controls, target is the first qubit and
+     * the most significant bit of row-major 2^k x 2^k matrix, controls follow in matrix order.
+     * Register operations keep their qubits the same way, values of PhaseOracle are phases of
+     * all 2^k values of its qubits. Values of PauliRotation exp(-i theta P) are theta and Pauli
+     * of every qubit as PauliCode, identity factors aren't stored.
+     * Pool only grows, so entries stay valid while gates are removed or reordered.
+    */
+    class GateOperands {
+        std::vector<uint32_t> words;
+        std::vector<std::complex<double>> values;
+
+        public:
+        /**
+         * Appends entry, returns its offset which is stored in record.
+        */
+        uint32_t add(
+            const std::vector<uint32_t> &controls,
+            uint32_t secondTarget = NO_CONTROL_QUBIT,
+            const std::vector<std::complex<double>> &values = {}
+        );
+
+        uint32_t getControlsCount(const GateRecord &record) const {
+            return words[record.control];
+        }
+
+        const uint32_t* getControls(const GateRecord &record) const {
+            return words.data() + record.control + 3;
+        }
+
+        uint32_t getSecondTarget(const GateRecord &record) const {
+            return words[record.control + 1];
+        }
+
+        const std::complex<double>* getValues(const GateRecord &record) const {
+            uint32_t offset = words[record.control + 2];
+            return offset == NO_OPERAND_VALUES ? nullptr : values.data() + offset;
+        }
+
+        /**
+         * Returns true if pool has entry record refers to.
+        */
+        bool hasEntry(const GateRecord &record) const {
+            return (std::size_t)record.control + 3 <= words.size() &&
+                (std::size_t)record.control + 3 + words[record.control] <= words.size();
+        }
+
+        bool empty() const {
+            return words.empty();
+        }
+
+        void clear() {
+            words.clear();
+            values.clear();
+        }
+    };
+
+    /**
+     * Returns true if gate of given kind acts on single qubit.
+    */
+    bool isSingleQubitGate(GateKind kind);
+
+    /**
+     * Calls f for every qubit gate acts on, target goes first.
+     * Record of multi-controlled kind needs operands of its circuit.
+    */
+    template<typename F>
+    void forEachGateQubit(const GateRecord &record, F f) {
+        if (hasOperands(record.kind)) {
+            throw std::invalid_argument("Qubits of multi-controlled gate are kept in its operands");
+        }
+
+        f(record.target);
+        if (record.hasControl()) {
+            f(record.control);
+        }
+    }
+
+    template<typename F>
+    void forEachGateQubit(const GateRecord &record, const GateOperands &operands, F f) {
+        if (!hasOperands(record.kind)) {
+            forEachGateQubit(record, f);
+            return;
+        }
+
+        if (!operands.hasEntry(record)) {
+            throw std::invalid_argument("Provided operands have no entry of multi-controlled gate");
+        }
+
+        f(record.target);
+        if (operands.getSecondTarget(record) != NO_CONTROL_QUBIT) {
+            f(operands.getSecondTarget(record));
+        }
+        const uint32_t *controls = operands.getControls(record);
+        for (uint32_t i = 0; i < operands.getControlsCount(record); i++) {
+            f(controls[i]);
+        }
+    }
+
+    /**
+     * Appends canonical words of gate for hashing: kind and qubits, for multi-controlled gate also
+     * its controls and bits of its values, so gates with equal operands hash equally whatever
+     * their offsets are. Fields are appended one by one, padding of record is unspecified.
+    */
+    void appendGateWords(std::vector<uint64_t> &words, const GateRecord &gate, const GateOperands &operands);
+
+    /**
+     * Human-readable name of gate kind, the same one facades use as operationName.
+    */
+    std::string gateName(GateKind kind);
+
+} // namespace operations
+} // namespace qce
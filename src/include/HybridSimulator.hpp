@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    struct HybridStatistics {
+        std::size_t cutGates = 0;
+        uint64_t paths = 0;
+    };
+
+    /**
+     * Schrödinger–Feynman simulator which computes chosen amplitudes without full state.
+     * Register is cut into qubits [0, cut) and [cut, n), each half is simulated as its own state
+     * vector. Every gate across cut is written as sum of products of single qubit operators
+     * (controlled gates as |0><0| x I + |1><1| x U, swap as (II + XX + YY + ZZ) / 2), so choice
+     * of one term per cut gate is a path along which both halves evolve independently, and
+     * amplitude of x is sum over paths of products of amplitudes of halves of x.
+     * Paths are split between threads, every thread keeps one pair of half states, so memory is
+     * threads * (2^cut + 2^(n-cut)) amplitudes. Gates before the first cut gate are applied once.
+     * Multi-controlled and unitary gates must act on qubits of one half.
+    */
+    class HybridSimulator {
+        std::size_t threads;
+        std::size_t cutQubit;
+        uint64_t maxPaths;
+        HybridStatistics statistics;
+
+        public:
+        /**
+         * cutQubit 0 cuts register in the middle. Circuit with more than maxPaths paths is rejected.
+        */
+        HybridSimulator(std::size_t threads = 0, std::size_t cutQubit = 0, uint64_t maxPaths = uint64_t(1) << 32);
+
+        /**
+         * Amplitudes <x|C|initial> of given basis states, qubit 0 is the most significant bit of x.
+         * Throws std::invalid_argument for eager env, env of more than 64 qubits, basis state out of
+         * register, multi-controlled gate across cut or circuit with too many paths.
+        */
+        std::vector<kernels::Amplitude_t> amplitudes(const QubitEnv &env, const std::vector<uint64_t> &basisStates);
+
+        kernels::Amplitude_t amplitude(const QubitEnv &env, uint64_t basisState) {
+            return amplitudes(env, {basisState})[0];
+        }
+
+        const HybridStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+} // simulator
+} // qce
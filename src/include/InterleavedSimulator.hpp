@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace kernels {
+
+    /**
+     * Applies gate to every member of interleaved batch. Real and imaginary parts are stored apart,
+     * amplitude i of member b is at index i * batch + b, so every row of batch is contiguous and
+     * gate is applied to whole row by plain loops over doubles which compiler vectorizes.
+     * Throws std::invalid_argument for multi-controlled and register gates, they need operands.
+    */
+    void applyGateInterleaved(
+        double *real,
+        double *imag,
+        uint64_t size,
+        std::size_t batch,
+        const operations::GateRecord &record,
+        const BitLayout &layout
+    );
+
+    /**
+     * Applies gate of any kind, records[b] and operands[b] are gate and operands pool of member b.
+     * Gates of members must act on the same qubits, values of MCPhase, MCU, Unitary, PhaseOracle
+     * and PauliRotation may differ. Multi-controlled gates run on whole rows like gates above,
+     * register gates mix groups of amplitudes of one member, so every member is gathered and run by
+     * scalar kernel in turn.
+    */
+    void applyGateInterleaved(
+        double *real,
+        double *imag,
+        uint64_t size,
+        std::size_t batch,
+        const std::vector<operations::GateRecord> &records,
+        const std::vector<const operations::GateOperands*> &operands,
+        const BitLayout &layout
+    );
+
+} // namespace kernels
+
+namespace simulator {
+
+    /**
+     * State vectors of batch of circuits of the same size, stored interleaved for applyGateInterleaved.
+    */
+    class InterleavedState {
+        std::size_t qubitsCount;
+        std::size_t batch;
+        std::vector<double> real;
+        std::vector<double> imag;
+
+        public:
+        InterleavedState(std::size_t qubitsCount, std::size_t batch);
+
+        std::size_t getQubitsCount() const {
+            return qubitsCount;
+        }
+
+        std::size_t getBatch() const {
+            return batch;
+        }
+
+        uint64_t size() const {
+            return uint64_t(1) << qubitsCount;
+        }
+
+        double* realData() {
+            return real.data();
+        }
+
+        double* imagData() {
+            return imag.data();
+        }
+
+        /**
+         * Sets member to product state of given single qubit states.
+        */
+        void setProductState(std::size_t member, const std::vector<QubitState> &states);
+
+        kernels::Amplitude_t amplitude(std::size_t member, uint64_t index) const {
+            return kernels::Amplitude_t(real[index * batch + member], imag[index * batch + member]);
+        }
+
+        DynamicQubitState extract(std::size_t member) const;
+    };
+
+    /**
+     * Simulates circuits with the same gates together. Circuits may differ in initial states and in
+     * values of operands of gates, e.g. angles of MCPhase or PauliRotation, but not in qubits of gates.
+     * Environments are split into groups of batchWidth, every group is one interleaved state, so
+     * each gate is one sweep over group instead of one sweep per circuit, and rows of batchWidth
+     * amplitudes are wide enough for SIMD even when single state is a few amplitudes long.
+    */
+    class InterleavedSimulator {
+        std::size_t batchWidth;
+
+        public:
+        InterleavedSimulator(std::size_t batchWidth = 16);
+
+        /**
+         * Solutions in order of envs. Throws std::invalid_argument if environments differ in
+         * size, kinds or qubits of gates, or if any of them is executed eagerly.
+        */
+        std::vector<Solution> constructSolutions(const std::vector<QubitEnv> &envs);
+
+        /**
+         * Runs gates of circuit on every initial state of batch at once.
+        */
+        InterleavedState run(const QubitEnv &circuit, const std::vector<std::vector<QubitState>> &initialStates);
+
+        std::size_t getBatchWidth() const {
+            return batchWidth;
+        }
+    };
+
+} // simulator
+} // qce
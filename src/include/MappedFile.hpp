@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace qce {
+namespace utils {
+
+    enum class MappingMode {
+        ReadOnly,
+        ReadWrite,
+        // file is created or truncated to requested size
+        Create,
+        // copy-on-write mapping of existing file, changes are not written back
+        Private
+    };
+
+    /**
+     * File mapped into memory with mmap, shared with file so that changes are written back,
+     * or private, so that pages are read from file and copied on first write.
+     * Mapping is owned by object and released in destructor.
+    */
+    class MappedFile {
+        int descriptor = -1;
+        void *address = nullptr;
+        uint64_t length = 0;
+        bool writable = false;
+        bool isPrivate = false;
+
+        void release();
+
+        public:
+        MappedFile() {}
+        MappedFile(const std::string &path, MappingMode mode, uint64_t size = 0);
+        ~MappedFile();
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile& operator=(MappedFile &&other) noexcept;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile& operator=(const MappedFile &) = delete;
+
+        /**
+         * Unnamed read-write file of given size in directory, removed from file system right away
+         * and freed when mapping is released. Empty directory means TMPDIR or /tmp.
+        */
+        static MappedFile temporary(const std::string &directory, uint64_t size);
+
+        char* data() {
+            return static_cast<char*>(address);
+        }
+
+        const char* data() const {
+            return static_cast<const char*>(address);
+        }
+
+        uint64_t size() const {
+            return length;
+        }
+
+        bool isWritable() const {
+            return writable;
+        }
+
+        /**
+         * madvise hint for [offset, offset+bytes), range is widened to whole pages.
+         * Hints are advisory, failures are ignored.
+        */
+        void advise(uint64_t offset, uint64_t bytes, int advice) const;
+
+        /**
+         * Writes dirty pages of mapping back to file, waits for completion if synchronous.
+        */
+        void sync(bool synchronous = true) const;
+    };
+
+} // namespace utils
+} // namespace qce
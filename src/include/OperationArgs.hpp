@@ -7,14 +7,14 @@ namespace qce {
 namespace operations {
     struct OperationArgs {
         DynamicQubitState qstate;
-        std::vector<uint32_t> qubitIndices;
+        std::vector<std::size_t> qubitIndices;
 
         OperationArgs();
         OperationArgs(const DynamicQubitState &);
         OperationArgs(DynamicQubitState &&);
-        OperationArgs(const std::vector<uint32_t> &);
-        OperationArgs(const DynamicQubitState &, const std::vector<uint32_t> &);
-        OperationArgs(DynamicQubitState &&, std::vector<uint32_t> &&);
+        OperationArgs(const std::vector<std::size_t> &);
+        OperationArgs(const DynamicQubitState &, const std::vector<std::size_t> &);
+        OperationArgs(DynamicQubitState &&, std::vector<std::size_t> &&);
     };
 }
 } // qce
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <optional>
 #include <vector>
 #include <memory>
 #include <cassert>
@@ -12,6 +15,7 @@
 #include "Utils.hpp"
 #include "QubitConsts.hpp"
 #include "OperationArgs.hpp"
+#include "GateRecord.hpp"
 
 namespace qce {
 namespace operations {
@@ -88,16 +92,18 @@ namespace operations {
         std::vector<std::size_t> controlQubits;
         std::size_t targetQubit;
         std::size_t qubitNumber;
+        GateKind kind;
 
         public:
         std::string operationName = "QubitOperation";
 
         QubitOperation(
+            GateKind kind,
             const std::vector<std::size_t> &controlQubits,
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder,
             const std::string &operationName = ""
-        ): Operation<std::vector<std::size_t>, OperResult_t, OperationResultHolder<DynamicQubitState>>(qubitOrder), targetQubit(targetQubit) {
+        ): Operation<std::vector<std::size_t>, OperResult_t, OperationResultHolder<DynamicQubitState>>(qubitOrder), targetQubit(targetQubit), kind(kind) {
             this->controlQubits = std::vector<std::size_t>(controlQubits);
             this->qubitNumber = QUBIT_NUMBER_UNDEFINED;
             if (operationName != "") {
@@ -106,11 +112,12 @@ namespace operations {
         }
 
         QubitOperation(
+            GateKind kind,
             const std::vector<std::size_t> &controlQubits,
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder,
             const std::string &operationName = ""
-        ): Operation<std::vector<std::size_t>, OperResult_t, DynamicQubitState>(qubitOrder), targetQubit(targetQubit) {
+        ): Operation<std::vector<std::size_t>, OperResult_t, DynamicQubitState>(qubitOrder), targetQubit(targetQubit), kind(kind) {
             this->controlQubits = std::vector<std::size_t>(controlQubits);
             this->qubitNumber = QUBIT_NUMBER_UNDEFINED;
             if (operationName != "") {
@@ -120,6 +127,20 @@ namespace operations {
 
         virtual OperResult_t constructOperation() = 0;
 
+        /**
+         * Compact record of this gate. Qubits of record are positions of
+         * target and control qubits in qubit order of the operation.
+        */
+        GateRecord getRecord() const {
+            uint32_t target = (uint32_t)utils::findIndex(this->data->begin(), this->data->end(), targetQubit);
+            if (controlQubits.empty()) {
+                return GateRecord(kind, target);
+            }
+
+            uint32_t control = (uint32_t)utils::findIndex(this->data->begin(), this->data->end(), controlQubits[0]);
+            return GateRecord(kind, target, control);
+        }
+
         OperationResultHolder<DynamicQubitState> applyOperation(const OperationArgs &args) override {
             // qubitNumber = this->data->size();
             OperResult_t operation = constructOperation();
@@ -135,22 +156,22 @@ namespace operations {
         const qce::QubitMat_t &singleOperationMatrix;
         public:
         SingleQubitOperation(
+            GateKind kind,
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder,
-            const qce::QubitMat_t &singleOperationMatrix,
-            const std::string &operationName
-        ): QubitOperation({}, targetQubit, qubitOrder, operationName), singleOperationMatrix{singleOperationMatrix} {
+            const qce::QubitMat_t &singleOperationMatrix
+        ): QubitOperation(kind, {}, targetQubit, qubitOrder, gateName(kind)), singleOperationMatrix{singleOperationMatrix} {
             if (!controlQubits.empty()) {
                 throw new std::invalid_argument("Provided control qubits to " + operationName + " gate");
             }
         }
 
         SingleQubitOperation(
+            GateKind kind,
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder,
-            const qce::QubitMat_t &singleOperationMatrix,
-            const std::string &operationName
-        ): QubitOperation({}, targetQubit, qubitOrder, operationName), singleOperationMatrix{singleOperationMatrix} {
+            const qce::QubitMat_t &singleOperationMatrix
+        ): QubitOperation(kind, {}, targetQubit, qubitOrder, gateName(kind)), singleOperationMatrix{singleOperationMatrix} {
             if (!controlQubits.empty()) {
                 throw new std::invalid_argument("Provided control qubits to " + operationName + " gate");
             }
@@ -173,60 +194,60 @@ namespace operations {
         HadamardGate(
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::hadamard_gate, "Hadamard gate") {}
+        ): SingleQubitOperation(GateKind::Hadamard, targetQubit, qubitOrder, qubitconsts::hadamard_gate) {}
 
         HadamardGate(
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::hadamard_gate, "Hadamard gate") {}
+        ): SingleQubitOperation(GateKind::Hadamard, targetQubit, qubitOrder, qubitconsts::hadamard_gate) {}
     };
     class XGate : public SingleQubitOperation {
         public:
         XGate(
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::pauli_x_gate, "X gate") {}
+        ): SingleQubitOperation(GateKind::X, targetQubit, qubitOrder, qubitconsts::pauli_x_gate) {}
 
         XGate(
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::pauli_x_gate, "X gate") {}
+        ): SingleQubitOperation(GateKind::X, targetQubit, qubitOrder, qubitconsts::pauli_x_gate) {}
     };
     class YGate : public SingleQubitOperation {
         public:
         YGate(
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::pauli_y_gate, "Y gate") {}
+        ): SingleQubitOperation(GateKind::Y, targetQubit, qubitOrder, qubitconsts::pauli_y_gate) {}
 
         YGate(
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::pauli_y_gate, "Y gate") {}
+        ): SingleQubitOperation(GateKind::Y, targetQubit, qubitOrder, qubitconsts::pauli_y_gate) {}
     };
     class ZGate : public SingleQubitOperation {
         public:
         ZGate(
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::pauli_z_gate, "Z gate") {}
+        ): SingleQubitOperation(GateKind::Z, targetQubit, qubitOrder, qubitconsts::pauli_z_gate) {}
 
         ZGate(
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::pauli_z_gate, "Z gate") {}
+        ): SingleQubitOperation(GateKind::Z, targetQubit, qubitOrder, qubitconsts::pauli_z_gate) {}
     };
     class PhaseGate : public SingleQubitOperation {
         public:
         PhaseGate(
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::phase_s_gate, "S gate") {}
+        ): SingleQubitOperation(GateKind::S, targetQubit, qubitOrder, qubitconsts::phase_s_gate) {}
 
         PhaseGate(
             std::size_t targetQubit,
             std::vector<std::size_t> &&qubitOrder
-        ): SingleQubitOperation(targetQubit, qubitOrder, qubitconsts::phase_s_gate, "S gate") {}  
+        ): SingleQubitOperation(GateKind::S, targetQubit, qubitOrder, qubitconsts::phase_s_gate) {}  
     };
 
     // two qubit operations
@@ -237,7 +258,7 @@ namespace operations {
             const std::vector<std::size_t> &controlQubits,
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): QubitOperation(controlQubits, targetQubit, qubitOrder) {
+        ): QubitOperation(GateKind::Cnot, controlQubits, targetQubit, qubitOrder, gateName(GateKind::Cnot)) {
             if (controlQubits.size() != 1) {
                 throw new std::invalid_argument("Provided invalid control qubits to cnot gate");
             }
@@ -251,11 +272,11 @@ namespace operations {
             std::size_t controlQubitRelativePosition = utils::findIndex(data->begin(), data->end(), controlQubits[0]);
 
             // find power
-            std::size_t targetQubitNumber = (1 << (n-targetQubitRelativePosition-1));
-            std::size_t controlQubitNumber = (1 << (n-controlQubitRelativePosition-1));
+            std::size_t targetQubitNumber = std::size_t(1) << (n-targetQubitRelativePosition-1);
+            std::size_t controlQubitNumber = std::size_t(1) << (n-controlQubitRelativePosition-1);
 
             // implement algorithm for swapping amplitudes for target and control
-            std::size_t resultMatrixSize = (1 << n);
+            std::size_t resultMatrixSize = std::size_t(1) << n;
             DynamicQubitMat_t result = Eigen::MatrixXcd::Zero(resultMatrixSize, resultMatrixSize);
 
             for (std::size_t i = 0; i < resultMatrixSize; i++) {
@@ -284,7 +305,7 @@ namespace operations {
             const std::vector<std::size_t> &controlQubits,
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): QubitOperation(controlQubits, targetQubit, qubitOrder) {}
+        ): QubitOperation(GateKind::Swap, controlQubits, targetQubit, qubitOrder, gateName(GateKind::Swap)) {}
         
         DynamicQubitMat_t constructOperation() override {
             std::size_t n = data->size();
@@ -294,11 +315,11 @@ namespace operations {
             std::size_t controlQubitRelativePosition = utils::findIndex(data->begin(), data->end(), controlQubits[0]);
 
             // find power
-            std::size_t targetQubitNumber = (1 << (n-targetQubitRelativePosition-1));
-            std::size_t controlQubitNumber = (1 << (n-controlQubitRelativePosition-1));
+            std::size_t targetQubitNumber = std::size_t(1) << (n-targetQubitRelativePosition-1);
+            std::size_t controlQubitNumber = std::size_t(1) << (n-controlQubitRelativePosition-1);
 
             // implement algorithm for swapping amplitudes for target and control
-            std::size_t resultMatrixSize = (1 << n);
+            std::size_t resultMatrixSize = std::size_t(1) << n;
             DynamicQubitMat_t result = Eigen::MatrixXcd::Zero(resultMatrixSize, resultMatrixSize);
 
             for (std::size_t i = 0; i < resultMatrixSize; i++) {
@@ -325,7 +346,7 @@ namespace operations {
             const std::vector<std::size_t> &controlQubits,
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): QubitOperation(controlQubits, targetQubit, qubitOrder) {}
+        ): QubitOperation(GateKind::CZ, controlQubits, targetQubit, qubitOrder, gateName(GateKind::CZ)) {}
         
         DynamicQubitMat_t constructOperation() override {
             std::size_t n = data->size();
@@ -335,11 +356,11 @@ namespace operations {
             std::size_t controlQubitRelativePosition = utils::findIndex(data->begin(), data->end(), controlQubits[0]);
 
             // find power
-            std::size_t targetQubitNumber = (1 << (n-targetQubitRelativePosition-1));
-            std::size_t controlQubitNumber = (1 << (n-controlQubitRelativePosition-1));
+            std::size_t targetQubitNumber = std::size_t(1) << (n-targetQubitRelativePosition-1);
+            std::size_t controlQubitNumber = std::size_t(1) << (n-controlQubitRelativePosition-1);
 
             // implement algorithm for swapping amplitudes for target and control
-            std::size_t resultMatrixSize = (1 << n);
+            std::size_t resultMatrixSize = std::size_t(1) << n;
             DynamicQubitMat_t result = Eigen::MatrixXcd::Zero(resultMatrixSize, resultMatrixSize);
 
             for (std::size_t i = 0; i < resultMatrixSize; i++) {
@@ -362,7 +383,7 @@ namespace operations {
             const std::vector<std::size_t> &controlQubits,
             std::size_t targetQubit,
             const std::vector<std::size_t> &qubitOrder
-        ): QubitOperation(controlQubits, targetQubit, qubitOrder) {}
+        ): QubitOperation(GateKind::CPhase, controlQubits, targetQubit, qubitOrder, gateName(GateKind::CPhase)) {}
         
         DynamicQubitMat_t constructOperation() override {
             using namespace std::complex_literals;
@@ -373,11 +394,11 @@ namespace operations {
             std::size_t controlQubitRelativePosition = utils::findIndex(data->begin(), data->end(), controlQubits[0]);
 
             // find power
-            std::size_t targetQubitNumber = (1 << (n-targetQubitRelativePosition-1));
-            std::size_t controlQubitNumber = (1 << (n-controlQubitRelativePosition-1));
+            std::size_t targetQubitNumber = std::size_t(1) << (n-targetQubitRelativePosition-1);
+            std::size_t controlQubitNumber = std::size_t(1) << (n-controlQubitRelativePosition-1);
 
             // implement algorithm for swapping amplitudes for target and control
-            std::size_t resultMatrixSize = (1 << n);
+            std::size_t resultMatrixSize = std::size_t(1) << n;
             DynamicQubitMat_t result = Eigen::MatrixXcd::Zero(resultMatrixSize, resultMatrixSize);
 
             for (std::size_t i = 0; i < resultMatrixSize; i++) {
@@ -397,48 +418,68 @@ namespace operations {
     
     // three qubit operations
 
+    typedef std::shared_ptr<QubitOperation<DynamicQubitMat_t>> QubitOperationPtr_t;
+
+    /**
+     * Constructs gate facade for record. Qubit order of the facade is the natural
+     * order of qubitCount qubits, it lives only as long as the facade itself.
+    */
+    QubitOperationPtr_t makeGateOperation(const GateRecord &record, std::size_t qubitCount);
+
     template<typename NodeData_t>
     class Node {
 
-        std::shared_ptr<NodeData_t> data;
+        NodeData_t data;
 
         public:
-        Node(const Node &node): data{std::make_shared<NodeData_t>(*node.data)} {}
+        Node(const Node &node) = default;
 
-        Node(const NodeData_t& data): data{std::make_shared<NodeData_t>(data)} {}
+        Node(const NodeData_t& data): data{data} {}
 
-        Node(NodeData_t &&data): data{std::make_shared<NodeData_t>(data)} {}
+        Node(NodeData_t &&data): data{std::move(data)} {}
 
-        Node(Node &&node) {
-            data = node.data;
-            node.data = nullptr;
-        }
+        Node(Node &&node) = default;
 
-        Node& operator=(Node &&node) {
-            data = node.data;
-            node.data = nullptr;
-            return *this;
-        }
+        Node& operator=(const Node &node) = default;
+
+        Node& operator=(Node &&node) = default;
 
-        std::shared_ptr<NodeData_t> getData() const {
+        const NodeData_t& getData() const {
             return this->data;
         }
     };
 
+    /**
+     * Nodes are stored contiguously and shared between graph and its compiled states,
+     * graph copies them only if it is modified while compiled state is still alive.
+    */
+    template<typename OperationType_t>
+    using NodeArena_t = std::vector<Node<OperationType_t>>;
+
     template<typename OperationType_t, typename State_t>
     class OperationGraphHolder {
-        std::vector<Node<OperationType_t>> nodes;
+        std::shared_ptr<const NodeArena_t<OperationType_t>> nodes;
         std::vector<State_t> initialStates;
+        std::shared_ptr<const GateOperands> operands;
 
         public:
         OperationGraphHolder(
-            const std::vector<Node<OperationType_t>> &nodes,
-            const std::vector<State_t> &initialStates
-        ):  nodes{std::vector<Node<OperationType_t>>(nodes)},
-            initialStates{std::vector<State_t>(initialStates)} {}
+            const std::shared_ptr<const NodeArena_t<OperationType_t>> &nodes,
+            const std::vector<State_t> &initialStates,
+            const std::shared_ptr<const GateOperands> &operands = std::make_shared<const GateOperands>()
+        ):  nodes{nodes},
+            initialStates{std::vector<State_t>(initialStates)},
+            operands{operands} {}
 
         const std::vector<Node<OperationType_t>>& getNodes() const {
-            return nodes;
+            return *nodes;
+        }
+
+        /**
+         * Operands of multi-controlled gates among nodes.
+        */
+        const GateOperands& getOperands() const {
+            return *operands;
         }
 
         const std::vector<State_t>& getInitialStates() const {
@@ -448,8 +489,36 @@ namespace operations {
 
     template<typename OperationType_t, typename State_t>
     class OperationGraph {
-        std::vector<Node<OperationType_t>> nodes;
+        std::shared_ptr<NodeArena_t<OperationType_t>> nodes = std::make_shared<NodeArena_t<OperationType_t>>();
         std::vector<State_t> initialStates;
+        std::shared_ptr<GateOperands> operands = std::make_shared<GateOperands>();
+
+        // copy-on-write: detach nodes from compiled states before modification
+        NodeArena_t<OperationType_t>& mutableNodes() {
+            if (nodes.use_count() > 1) {
+                nodes = std::make_shared<NodeArena_t<OperationType_t>>(*nodes);
+            }
+
+            return *nodes;
+        }
+
+        GateOperands& mutableOperands() {
+            if (operands.use_count() > 1) {
+                operands = std::make_shared<GateOperands>(*operands);
+            }
+
+            return *operands;
+        }
+
+        // nodes before unchangedPrefix stayed the same since last takeUnchangedPrefix(),
+        // empty if initial states changed
+        std::optional<std::size_t> unchangedPrefix = std::numeric_limits<std::size_t>::max();
+
+        void markChangedFrom(std::size_t operationIndex) {
+            if (unchangedPrefix) {
+                unchangedPrefix = std::min(*unchangedPrefix, operationIndex);
+            }
+        }
 
         // merge-find set for qubit indices in particular states 
         std::vector<std::size_t> parentIndices;
@@ -504,10 +573,10 @@ namespace operations {
             initialStates{std::vector<State_t>(initialStates)} {}
 
         OperationGraph(const std::vector<Node<OperationType_t>> &nodes):
-            nodes{std::vector<Node<OperationType_t>>(nodes)} {}
+            nodes{std::make_shared<NodeArena_t<OperationType_t>>(nodes)} {}
 
         OperationGraph(std::vector<Node<OperationType_t>> &&nodes):
-            nodes{std::vector<Node<OperationType_t>>(nodes)} {}
+            nodes{std::make_shared<NodeArena_t<OperationType_t>>(std::move(nodes))} {}
 
         OperationGraph(const std::size_t qubitsCount, const State_t &state) {
             initialStates.reserve(qubitsCount);
@@ -517,41 +586,94 @@ namespace operations {
         }
 
         void add(const OperationType_t &data) {
-            Node<OperationType_t> node_c(data);
-            if (nodes.capacity() >= 1) {
-                nodes.emplace_back(std::move(node_c));
-            } else {
-                nodes.push_back(std::move(node_c));
-            }
+            mutableNodes().emplace_back(data);
         }
 
         void add(OperationType_t &&data) {
-            Node<OperationType_t> node_m(data);
-            if (nodes.capacity() >= 1) {
-                nodes.emplace_back(std::move(node_m));
-            } else {
-                nodes.push_back(std::move(node_m));
+            mutableNodes().emplace_back(std::move(data));
+        }
+
+        /**
+         * Appends operands of multi-controlled gate, returns offset to store in its record.
+        */
+        uint32_t addOperands(
+            const std::vector<uint32_t> &controls,
+            uint32_t secondTarget = NO_CONTROL_QUBIT,
+            const std::vector<std::complex<double>> &values = {}
+        ) {
+            return mutableOperands().add(controls, secondTarget, values);
+        }
+
+        /**
+         * Drops all operands, only valid when no node refers to them.
+        */
+        void clearOperands() {
+            if (operands.use_count() > 1) {
+                operands = std::make_shared<GateOperands>();
+                return;
             }
+            operands->clear();
+        }
+
+        const GateOperands& getOperands() const {
+            return *operands;
         }
 
         void remove(const std::size_t operationIndex) {
-            if (operationIndex > nodes.size()) {
+            if (operationIndex >= nodes->size()) {
                 throw std::invalid_argument("Provided invalid argument operationIndex OperationGraph");
             }
 
-            nodes.erase(nodes.begin() + (std::ptrdiff_t)operationIndex);
+            NodeArena_t<OperationType_t> &arena = mutableNodes();
+            arena.erase(arena.begin() + (std::ptrdiff_t)operationIndex);
+            markChangedFrom(operationIndex);
+        }
+
+        /**
+         * Replaces all nodes, e.g. with result of optimization pass.
+        */
+        void setNodes(std::vector<Node<OperationType_t>> &&newNodes) {
+            std::size_t commonPrefix = 0;
+            while (commonPrefix < newNodes.size() && commonPrefix < nodes->size() &&
+                newNodes[commonPrefix].getData() == (*nodes)[commonPrefix].getData()) {
+                commonPrefix++;
+            }
+            markChangedFrom(commonPrefix);
+
+            nodes = std::make_shared<NodeArena_t<OperationType_t>>(std::move(newNodes));
+        }
+
+        std::size_t getNodesCount() const {
+            return nodes->size();
         }
 
         void changeState(const std::size_t stateIndex, const State_t &newState) {
             assert(stateIndex < initialStates.size());
+            if (initialStates[stateIndex] != newState) {
+                unchangedPrefix.reset();
+            }
             initialStates[stateIndex] = State_t(newState);
         }
 
         void changeState(const std::size_t stateIndex, State_t &&newState) {
             assert(stateIndex < initialStates.size());
+            if (initialStates[stateIndex] != newState) {
+                unchangedPrefix.reset();
+            }
             initialStates[stateIndex] = State_t(newState);
         }
 
+        /**
+         * Length of node prefix which stayed the same since previous call, appended nodes don't
+         * change it. Empty if any initial state changed. Lets owner of state computed from graph
+         * keep it if only nodes after it were touched.
+        */
+        std::optional<std::size_t> takeUnchangedPrefix() {
+            std::optional<std::size_t> result = unchangedPrefix;
+            unchangedPrefix = std::numeric_limits<std::size_t>::max();
+            return result;
+        }
+
         const std::size_t getQubitsCount() const {
             return initialStates.size();
         }
@@ -569,7 +691,7 @@ namespace operations {
         }
 
         OperationGraphHolder<OperationType_t, State_t> compileState() const {
-            return OperationGraphHolder<OperationType_t, State_t>(nodes, initialStates);
+            return OperationGraphHolder<OperationType_t, State_t>(nodes, initialStates, operands);
         }
     };
 } // namespace operations
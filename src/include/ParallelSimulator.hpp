@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    /**
+     * Reusable barrier for fixed amount of threads. Thread which fails cancels barrier, then
+     * every current and later wait returns false at once, so the rest of threads can leave.
+    */
+    class ThreadBarrier {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::size_t threads;
+        std::size_t waiting = 0;
+        std::size_t generation = 0;
+        bool isCancelled = false;
+
+        public:
+        ThreadBarrier(std::size_t threads): threads{threads} {}
+
+        /**
+         * Blocks until all threads arrive, returns false if barrier is cancelled.
+        */
+        bool wait();
+        void cancel();
+    };
+
+    /**
+     * Where pages of state vector live in relation to threads which work on them.
+     * Pages are sampled per thread, unknownPages are pages whose node couldn't be queried
+     * (no NUMA support in kernel or page not yet faulted in).
+    */
+    struct PlacementStatistics {
+        std::size_t numaNodes = 1;
+        std::size_t localPages = 0;
+        std::size_t remotePages = 0;
+        std::size_t unknownPages = 0;
+    };
+
+    /**
+     * Multithreaded simulator. State is allocated untouched and every worker initializes its own
+     * contiguous piece of amplitudes (first touch places pages on worker's node), workers are pinned
+     * to cores, and every gate is split so that worker p processes p-th piece of iteration space,
+     * which for all bits below log2(size/threads) is exactly the piece it initialized.
+    */
+    class ParallelSimulator : public Simulator<QubitEnv> {
+        std::size_t threads;
+        bool pinThreads;
+        PlacementStatistics placement;
+
+        public:
+        ParallelSimulator(std::size_t threads = 0, bool pinThreads = true);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        /**
+         * Placement of state pages measured after initialization of last solution.
+        */
+        const PlacementStatistics& getPlacementStatistics() const {
+            return placement;
+        }
+
+        std::size_t getThreadsCount() const {
+            return threads;
+        }
+    };
+
+    /**
+     * NUMA node of cpu, 0 if topology is unknown.
+    */
+    std::size_t numaNodeOfCpu(std::size_t cpu);
+
+} // simulator
+} // qce
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    struct PrefixCacheStatistics {
+        std::size_t memoryHits = 0;
+        std::size_t diskHits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t spills = 0;
+    };
+
+    /**
+     * LRU cache of state vectors keyed by prefix hash, bounded by memoryBytes of amplitudes.
+     * With non-empty spillDirectory states evicted from memory are written there, files are kept
+     * in their own LRU bounded by diskBytes and are removed with cache.
+    */
+    class PrefixStateCache {
+        struct Entry {
+            uint64_t key;
+            DynamicQubitState state;
+        };
+
+        struct SpilledEntry {
+            uint64_t key;
+            uint64_t bytes;
+            std::string path;
+        };
+
+        std::size_t memoryBytes;
+        std::string spillDirectory;
+        std::size_t diskBytes;
+
+        std::list<Entry> entries;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+        std::size_t usedMemory = 0;
+
+        std::list<SpilledEntry> spilled;
+        std::unordered_map<uint64_t, std::list<SpilledEntry>::iterator> spilledIndex;
+        std::size_t usedDisk = 0;
+
+        PrefixCacheStatistics statistics;
+
+        void spill(Entry &&entry);
+        void removeSpilled(std::list<SpilledEntry>::iterator entry);
+
+        public:
+        PrefixStateCache(std::size_t memoryBytes, const std::string &spillDirectory = "", std::size_t diskBytes = 0);
+        ~PrefixStateCache();
+
+        PrefixStateCache(const PrefixStateCache &) = delete;
+        PrefixStateCache& operator=(const PrefixStateCache &) = delete;
+
+        /**
+         * Copies cached state into state and marks it as most recently used. State found on disk
+         * is moved back into memory.
+        */
+        bool lookup(uint64_t key, DynamicQubitState &state);
+
+        /**
+         * Stores copy of state, evicting least recently used states. State larger than the whole
+         * memory budget goes straight to disk or isn't cached at all.
+        */
+        void insert(uint64_t key, const DynamicQubitState &state);
+
+        bool contains(uint64_t key) const {
+            return index.count(key) != 0 || spilledIndex.count(key) != 0;
+        }
+
+        std::size_t getUsedMemory() const {
+            return usedMemory;
+        }
+
+        std::size_t getUsedDisk() const {
+            return usedDisk;
+        }
+
+        const PrefixCacheStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+    /**
+     * Simulator for circuit families which share long gate prefixes. Key of prefix of k gates
+     * chains hash of k-th gate onto key of prefix of k-1 gates, starting from hash of initial states,
+     * so keys of all prefixes cost one pass over compiled gate list.
+     * State after every checkpointInterval gates and the final state are cached, next circuit
+     * starts from the longest cached prefix of its gates.
+    */
+    class PrefixCacheSimulator : public Simulator<QubitEnv> {
+        std::size_t checkpointInterval;
+        PrefixStateCache cache;
+        std::size_t skippedGates = 0;
+
+        public:
+        PrefixCacheSimulator(
+            std::size_t memoryBytes = std::size_t(1) << 30,
+            std::size_t checkpointInterval = 32,
+            const std::string &spillDirectory = "",
+            std::size_t diskBytes = 0
+        );
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        PrefixStateCache& getCache() {
+            return cache;
+        }
+
+        /**
+         * Gates not applied because their prefix was cached, over all solutions.
+        */
+        std::size_t getSkippedGates() const {
+            return skippedGates;
+        }
+    };
+
+    /**
+     * Keys of prefixes of 0..gates.size() gates of circuit with given initial states and operands.
+    */
+    std::vector<uint64_t> prefixKeysOf(
+        const std::vector<QubitState> &initialStates,
+        const std::vector<operations::Node<operations::GateRecord>> &gates,
+        const operations::GateOperands &operands
+    );
+
+} // simulator
+} // qce
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "QubitEnv.hpp"
+#include "GateRecord.hpp"
+
+namespace qce {
+namespace qasm {
+
+    class QasmError : public std::runtime_error {
+        std::size_t line;
+
+        public:
+        QasmError(const std::string &message, std::size_t line):
+            std::runtime_error("QASM line " + std::to_string(line) + ": " + message), line{line} {}
+
+        std::size_t getLine() const {
+            return line;
+        }
+    };
+
+    /**
+     * Receiver of parsed program. Qubits of all quantum registers are numbered consecutively
+     * in order of declaration, so are bits of classical registers.
+    */
+    class QasmVisitor {
+        public:
+        virtual ~QasmVisitor() = default;
+
+        /**
+         * Called once, before the first gate or measurement, with total size of quantum registers.
+         * Program with qregs but without gates declares its qubits when parsing finishes.
+        */
+        virtual void declareQubits(std::size_t count) = 0;
+
+        virtual void gate(const operations::GateRecord &gate) = 0;
+
+        /**
+         * ccx gate. By default it is decomposed into H, CS, CZ and CNOT gates:
+         * CCZ = CS(b, t) CX(a, b) CS(b, t)^-1 CX(a, b) CS(a, t), where CS^-1 = CZ CS.
+        */
+        virtual void toffoli(uint32_t firstControl, uint32_t secondControl, uint32_t target);
+
+        virtual void measure(std::size_t qubit, std::size_t bit) = 0;
+    };
+
+    /**
+     * Visitor which adds gates to QubitEnv. In streaming mode environment is switched to eager
+     * execution right after it is created, so every gate is applied as soon as it is parsed and
+     * neither text nor gate graph of program is kept in memory.
+    */
+    class QasmEnvBuilder : public QasmVisitor {
+        bool streaming;
+        std::size_t fusionWindow;
+        std::unique_ptr<QubitEnv> env;
+        std::vector<std::pair<std::size_t, std::size_t>> measurements;
+
+        public:
+        QasmEnvBuilder(bool streaming = false, std::size_t fusionWindow = 0);
+
+        void declareQubits(std::size_t count) override;
+        void gate(const operations::GateRecord &gate) override;
+
+        /**
+         * ccx is added as single Toffoli gate of environment, without decomposition.
+        */
+        void toffoli(uint32_t firstControl, uint32_t secondControl, uint32_t target) override;
+        void measure(std::size_t qubit, std::size_t bit) override;
+
+        /**
+         * Environment of parsed program with buffered gates applied, throws std::logic_error if program
+         * declared no qubits.
+        */
+        QubitEnv& getEnv();
+
+        /**
+         * Measured (qubit, bit) pairs in program order.
+        */
+        const std::vector<std::pair<std::size_t, std::size_t>>& getMeasurements() const {
+            return measurements;
+        }
+    };
+
+    /**
+     * Parses OpenQASM 2 subset: qreg, creg, h, x, y, z, s, cx, cz, swap, ccx, measure and barrier,
+     * with register broadcasting; include is allowed for qelib1.inc only. Input is read by blocks
+     * of bufferBytes and tokenized in place, only the unfinished statement at the end of block is
+     * carried over to the next one. Throws QasmError on unsupported or malformed program.
+    */
+    void parseQasm(std::istream &input, QasmVisitor &visitor, std::size_t bufferBytes = std::size_t(1) << 20);
+
+    /**
+     * Parses file mapped into memory, tokens point straight into mapping.
+    */
+    void parseQasmFile(const std::string &path, QasmVisitor &visitor);
+
+} // namespace qasm
+} // namespace qce
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <functional>
+#include <string>
 #include <vector>
 
 #include "Qubit.h"
 #include "QubitConsts.hpp"
 #include "OperationArgs.hpp"
 #include "OperationGraph.hpp"
+#include "GateKernels.hpp"
+#include "DependencyGraph.hpp"
+#include "CircuitOptimizer.hpp"
 
 namespace qce {
 
@@ -22,15 +27,89 @@ namespace qce {
         >> BaseOperationPtr_t;
 
     typedef operations::OperationGraph<
-        BaseOperationPtr_t,
+        operations::GateRecord,
         QubitState> QubitOperationGraph;
 
-    typedef qce::operations::OperationGraphHolder<qce::BaseOperationPtr_t, qce::QubitState> OperGraphState;
+    typedef qce::operations::OperationGraphHolder<qce::operations::GateRecord, qce::QubitState> OperGraphState;
+
+    /**
+     * Deferred environment stores gates in graph and is executed by simulator.
+     * Eager environment owns live state vector and applies every gate as soon as it is added,
+     * nothing is stored in graph, so memory doesn't grow with circuit length.
+    */
+    enum class ExecutionMode {
+        Deferred,
+        Eager
+    };
+
+    /**
+     * Term weight * P of Hamiltonian, paulis[j] ('I', 'X', 'Y' or 'Z') acts on qubits[j].
+    */
+    struct PauliTerm {
+        std::string paulis;
+        std::vector<std::size_t> qubits;
+        double weight;
+    };
+
+    /**
+     * Product formula of Trotter step: First is exp(-i t H_1) ... exp(-i t H_m), Second is
+     * symmetric Strang splitting with half steps around the last term, its error is O(t^3).
+    */
+    enum class TrotterOrder {
+        First,
+        Second
+    };
 
     class QubitEnv : public AbstractEnvironment<OperGraphState> {
 
         private:
         QubitOperationGraph graph;
+        ExecutionMode mode = ExecutionMode::Deferred;
+
+        // eager mode part, pending window is flushed only by non-const methods, const getters never write
+        std::size_t fusionWindow = 0;
+        kernels::BitLayout layout;
+        DynamicQubitState liveState;
+        std::vector<operations::GateRecord> pendingGates;
+        operations::GateOperands pendingOperands;
+
+        // deferred mode part, state after first computedGates nodes of graph, kept only on request
+        DynamicQubitState computedState;
+        std::size_t computedGates = 0;
+        bool hasComputedState = false;
+
+        void addGate(const operations::GateRecord &record);
+        /**
+         * Checks that qubits of one or two qubit gate are in environment and differ, then adds it.
+        */
+        void addGate(operations::GateKind kind, std::size_t targetQubitIndex, std::size_t controlQubitIndex = NO_CONTROL_QUBIT);
+
+        /**
+         * Checks qubits of multi-controlled gate and stores its operands in graph, or in pending
+         * operands of eager environment.
+        */
+        void addControlledGate(
+            operations::GateKind kind,
+            std::size_t targetQubitIndex,
+            std::size_t secondQubitIndex,
+            const std::vector<std::size_t> &controlQubitIndices,
+            const std::vector<std::complex<double>> &values = {}
+        );
+        /**
+         * Stores gate over ordered qubits: the first one is target, the rest are kept as controls.
+        */
+        void addRegisterGate(
+            operations::GateKind kind,
+            const std::vector<std::size_t> &qubitIndices,
+            const std::vector<std::complex<double>> &values = {}
+        );
+        void flushPendingGates();
+
+        /**
+         * Drops computed state if graph changed before its position, called after every
+         * modification of graph other than appending.
+        */
+        void invalidateComputedState();
 
         public:
         QubitEnv();
@@ -81,16 +160,155 @@ namespace qce {
         /**
          * Toffoli gate
         */
-        void toffoli();
+        void toffoli(std::size_t inverseQubitIndex, std::size_t firstControlIndex, std::size_t secondControlIndex);
+        /**
+         * Controlled Fredkin gate, swaps two qubits if control qubit is |1>
+        */
+        void cfredkin(std::size_t firstQubitIndex, std::size_t secondQubitIndex, std::size_t controlQubitIndex);
+
+        // Multi-controlled gates act only if every control qubit is |1>, any number of controls is allowed.
+        // Qubits of gate must be distinct, otherwise std::invalid_argument is thrown.
+
+        /**
+         * Multi-controlled X gate
+        */
+        void mcx(std::size_t inverseQubitIndex, const std::vector<std::size_t> &controlQubitIndices);
+        /**
+         * Multi-controlled Z gate
+        */
+        void mcz(std::size_t zQubitIndex, const std::vector<std::size_t> &controlQubitIndices);
         /**
-         * Controlled Fredkin gate
+         * Multi-controlled phase gate, multiplies |1> of qubit by e^(i * angle)
         */
-        void cfredkin();
+        void mcphase(std::size_t qubitIndex, const std::vector<std::size_t> &controlQubitIndices, double angle);
+        /**
+         * Multi-controlled swap gate
+        */
+        void mcswap(
+            std::size_t firstQubitIndex,
+            std::size_t secondQubitIndex,
+            const std::vector<std::size_t> &controlQubitIndices
+        );
+        /**
+         * Multi-controlled arbitrary single qubit gate
+        */
+        void mcu(std::size_t qubitIndex, const std::vector<std::size_t> &controlQubitIndices, const QubitMat_t &matrix);
+        /**
+         * Arbitrary gate on 1 to 5 distinct qubits, qubitIndices[0] is the most significant bit of
+         * index of 2^k x 2^k matrix. Throws std::invalid_argument if size of matrix doesn't match
+         * qubits count or, when checkUnitarity is set, matrix isn't unitary.
+        */
+        void unitary(const DynamicQubitMat_t &matrix, const std::vector<std::size_t> &qubitIndices, bool checkUnitarity = true);
+
+        // Register operations act on given qubits as on one integer, qubitIndices[0] is its most
+        // significant bit. Every operation is a single pass over state instead of its gates.
+
+        /**
+         * Quantum Fourier transform, the same as Hadamard and controlled phase ladder followed by
+         * swaps which reverse order of qubits.
+        */
+        void qft(const std::vector<std::size_t> &qubitIndices);
+        /**
+         * Inverse quantum Fourier transform
+        */
+        void iqft(const std::vector<std::size_t> &qubitIndices);
+        /**
+         * Grover diffusion 2|s><s| - I, where |s> is uniform superposition of qubits. Decomposition
+         * H, X, MCZ, X, H gives the same operation up to global phase -1.
+        */
+        void groverDiffusion(const std::vector<std::size_t> &qubitIndices);
+        /**
+         * Flips sign of basis states for which predicate of value of qubits is true. Predicate is
+         * called for every value once when oracle is added, so at most 24 qubits are allowed.
+        */
+        void phaseOracle(const std::function<bool(uint64_t)> &predicate, const std::vector<std::size_t> &qubitIndices);
+        /**
+         * Phase oracle over the whole register, predicate takes basis index.
+        */
+        void phaseOracle(const std::function<bool(uint64_t)> &predicate);
+
+        /**
+         * exp(-i theta P) for Pauli string P, paulis[j] acts on qubitIndices[j]. It's a single pass
+         * over pairs of amplitudes instead of CNOT ladders and RZ of its decomposition.
+        */
+        void pauliExp(const std::string &paulis, const std::vector<std::size_t> &qubitIndices, double theta);
+
+        /**
+         * Trotter step exp(-i time H) for H = sum of weight * P. Diagonal terms (only I and Z) commute,
+         * so they are grouped into one phase table pass when they act on at most 24 qubits together,
+         * every other term is one Pauli rotation.
+        */
+        void trotterStep(const std::vector<PauliTerm> &hamiltonian, double time, TrotterOrder order = TrotterOrder::First);
 
         // Common gates section end
 
         std::size_t compute();
-        
+
+        /**
+         * Switches environment to eager execution. Gates added before are applied to live state
+         * and dropped from graph. Up to fusionWindow gates are buffered, consecutive single qubit
+         * gates on the same qubit in buffer are fused into one matrix before applying.
+        */
+        void enableEagerExecution(std::size_t fusionWindow = 0);
+        ExecutionMode getExecutionMode() const;
+
+        /**
+         * Applies gates buffered in fusion window of eager environment to live state.
+        */
+        void flush();
+
+        bool hasPendingGates() const {
+            return !pendingGates.empty();
+        }
+
+        /**
+         * Current state of eager environment. Throws std::logic_error while gates are buffered,
+         * flush() applies them, so const environment shared by threads is only read.
+        */
+        const DynamicQubitState& getLiveState() const;
+
+        /**
+         * State of environment after all gates stored in graph, computed anew on every call.
+        */
+        DynamicQubitState computeState() const;
+
+        /**
+         * State of deferred environment after all gates stored in graph, for loops which append
+         * gates and simulate again. The computed state is kept in environment, so after appending
+         * gates only new ones are applied. Removing gate or changing initial state drops it only
+         * if it depends on them. Kept state costs 2^n amplitudes and is copied with environment,
+         * releaseComputedState frees it.
+        */
+        const DynamicQubitState& computeStateIncrementally();
+
+        void releaseComputedState();
+
+        /**
+         * Amount of gates already applied to state kept by computeStateIncrementally.
+        */
+        std::size_t getComputedGatesCount() const {
+            return hasComputedState ? computedGates : 0;
+        }
+
+        /**
+         * Removes index-th gate stored in graph.
+        */
+        void removeGate(std::size_t index);
+
+        /**
+         * Replaces initial state of qubit, only deferred environment can change it.
+        */
+        void changeState(std::size_t qubitIndex, const QubitState &state);
+
+        /**
+         * Runs peephole optimization over gates stored in graph.
+        */
+        operations::OptimizationReport optimize(std::size_t lookahead = 64);
+
+        /**
+         * Dependency DAG of gates stored in graph.
+        */
+        operations::DependencyGraph getDependencyGraph() const;
 
         qce::Qubit getQubit(std::size_t qubitIndex) const;
         std::size_t getQubitCount() const;
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    struct RemapStatistics {
+        std::size_t remaps = 0;
+        std::size_t movedQubits = 0;
+    };
+
+    /**
+     * Chooses qubits to exchange so that qubits used by gates[position .. position+lookahead)
+     * (as many of them as fit, in order of first use) are stored below localBits.
+     * Low qubits which are used latest (or not used at all) are moved out.
+    */
+    std::vector<std::pair<std::size_t, std::size_t>> planRemap(
+        const std::vector<operations::Node<operations::GateRecord>> &nodes,
+        const operations::GateOperands &operands,
+        std::size_t position,
+        const kernels::BitLayout &layout,
+        uint32_t localBits,
+        std::size_t lookahead
+    );
+
+    /**
+     * Simulator which keeps logical to physical qubit permutation as runtime variable.
+     * When gate touches qubit stored at bit >= localBits, qubits needed by upcoming gates are moved
+     * to low, cache-resident bits with single bulk bit permutation sweep. Natural layout is restored
+     * before solution is returned.
+    */
+    class RemappingSimulator : public Simulator<QubitEnv> {
+        uint32_t localBits;
+        std::size_t lookahead;
+        RemapStatistics statistics;
+
+        public:
+        RemappingSimulator(uint32_t localBits = 14, std::size_t lookahead = 256);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        const RemapStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+} // simulator
+} // qce
@@ -17,11 +17,11 @@ namespace qce {
     class MultipleQubitState {
         typedef Eigen::Matrix<std::complex<double>, Eigen::Dynamic, 1> QubitMatrix_t;
         std::shared_ptr<QubitMatrix_t> state;
-        std::vector<unsigned> indices;
+        std::vector<std::size_t> indices;
 
         public:
-        MultipleQubitState(const std::vector<unsigned> &indices) {
-            this->indices = std::vector<unsigned>(indices);
+        MultipleQubitState(const std::vector<std::size_t> &indices) {
+            this->indices = std::vector<std::size_t>(indices);
             uint64_t stateSize = utils::binpow<uint64_t, std::size_t>(2, indices.size());
             state = std::make_shared<QubitMatrix_t>(stateSize);
         }
@@ -36,11 +36,11 @@ namespace qce {
         std::vector<std::shared_ptr<MultipleQubitState>> qubits; // acts like a vector of merged qubits
  
         virtual void constructState(std::shared_ptr<MultipleQubitState> vState, std::complex<double> probability,
-            unsigned qubitStatePosition, unsigned index) = 0;
+            uint64_t qubitStatePosition, std::size_t index) = 0;
 
         public:
         virtual std::shared_ptr<MultipleQubitState> getState() = 0;
-        virtual std::shared_ptr<MultipleQubitState> getState(const std::vector<unsigned>& qubitIndices) = 0;
+        virtual std::shared_ptr<MultipleQubitState> getState(const std::vector<std::size_t>& qubitIndices) = 0;
         virtual void add(const Qubit& q) = 0;
         virtual void clear() = 0;
     };
@@ -89,7 +89,7 @@ namespace qce {
     //         return qubitsState;
     //     }
 
-    //     std::shared_ptr<MultipleQubitState> getState(const std::vector<unsigned>& qubitIndices) override {
+    //     std::shared_ptr<MultipleQubitState> getState(const std::vector<std::size_t>& qubitIndices) override {
     //         if (qubitIndices.size() == 0) {
     //             return std::make_shared<MultipleQubitState>(0);
     //         }
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "MappedFile.hpp"
+
+namespace qce {
+namespace simulator {
+
+    enum class ResultKind : uint32_t {
+        State,
+        Histogram
+    };
+
+    /**
+     * Measured basis states with their counts, sorted by basis state.
+    */
+    typedef std::vector<std::pair<uint64_t, uint64_t>> Histogram;
+
+    /**
+     * Layout of index file of result cache: header followed by slotsCount slots of open addressing
+     * table with linear probing, key 0 marks empty slot. Index is mapped, so lookup is a few
+     * memory reads. All fields are in native byte order.
+    */
+    struct ResultIndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotsCount;
+        uint64_t entriesCount;
+        uint64_t usedBytes;
+        uint64_t clock;
+    };
+
+    struct ResultIndexSlot {
+        uint64_t key;
+        uint64_t check;
+        uint64_t bytes;
+        uint64_t lastUse;
+    };
+
+    /**
+     * Every result is file <key>.result in cache directory: this header, then count amplitudes
+     * or count (basis state, count) pairs. checksum covers data after header, check is check of
+     * ResultKey of result.
+    */
+    struct ResultFileHeader {
+        char magic[8];
+        uint32_t version;
+        ResultKind kind;
+        uint64_t key;
+        uint64_t check;
+        uint64_t count;
+        uint64_t checksum;
+    };
+
+    const uint32_t RESULT_CACHE_VERSION = 2;
+
+    /**
+     * Key of cached result. key addresses index slot and names result file, check is independent
+     * hash of the same canonical words which is kept in slot and file and compared on load, so
+     * two circuits with colliding keys miss instead of returning each other's result.
+    */
+    struct ResultKey {
+        uint64_t key;
+        uint64_t check;
+
+        bool operator==(const ResultKey &other) const {
+            return key == other.key && check == other.check;
+        }
+
+        bool operator!=(const ResultKey &other) const {
+            return !(*this == other);
+        }
+    };
+
+    struct ResultCacheStatistics {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t stores = 0;
+        std::size_t evictions = 0;
+        std::size_t damaged = 0;
+        std::size_t failedStores = 0;
+    };
+
+    /**
+     * Canonical key of result of deferred env: two hashes of qubits count, initial states, compiled
+     * gates hashed field by field, backend name, precision, result kind and shots. Throws
+     * std::invalid_argument for eager env, it has no gates to hash.
+    */
+    ResultKey resultKeyOf(
+        const QubitEnv &env,
+        const std::string &backend,
+        const std::string &precision,
+        ResultKind kind,
+        uint64_t shots = 0
+    );
+
+    /**
+     * Content-addressed cache of final states and sample histograms in local directory, shared
+     * by runs of program. Total size of result files is kept under maxBytes by evicting least
+     * recently used results. Result file is written under temporary name and renamed, damaged
+     * result is dropped on load. Cache holds exclusive lock of index while it's open, so directory
+     * is used by one cache at a time.
+    */
+    class ResultCache {
+        std::string directory;
+        uint64_t maxBytes;
+        int lockDescriptor = -1;
+        utils::MappedFile index;
+        ResultIndexHeader *header = nullptr;
+        ResultIndexSlot *slots = nullptr;
+        ResultCacheStatistics statistics;
+
+        std::string pathOf(uint64_t key) const;
+        ResultIndexSlot* find(uint64_t key) const;
+        void erase(ResultIndexSlot *slot);
+        void evictFor(uint64_t bytes);
+        void createIndex(const std::string &path, uint32_t slotsCount);
+
+        /**
+         * Writes result file and adds entry. Cache is best effort: result which can't be written
+         * is dropped and counted in failedStores.
+        */
+        void store(const ResultKey &key, ResultKind kind, const void *data, uint64_t count, uint64_t itemBytes);
+
+        /**
+         * Maps result file and checks it, returns empty mapping and drops entry if it is damaged.
+        */
+        utils::MappedFile open(const ResultKey &key, ResultKind kind, uint64_t itemBytes, uint64_t &count);
+
+        public:
+        /**
+         * Opens cache in existing directory. Index is created with slotsCount slots (rounded up to
+         * power of two) if it's missing or unreadable, then result files of old index are removed.
+         * Throws std::runtime_error if index can't be opened or is locked by another cache.
+        */
+        ResultCache(const std::string &directory, uint64_t maxBytes, uint32_t slotsCount = 1u << 14);
+
+        ResultCache(const ResultCache &) = delete;
+        ResultCache& operator=(const ResultCache &) = delete;
+
+        ~ResultCache();
+
+        bool loadState(const ResultKey &key, DynamicQubitState &state);
+        void storeState(const ResultKey &key, const DynamicQubitState &state);
+
+        bool loadHistogram(const ResultKey &key, Histogram &histogram);
+        void storeHistogram(const ResultKey &key, const Histogram &histogram);
+
+        bool contains(const ResultKey &key) const {
+            const ResultIndexSlot *slot = find(key.key);
+            return slot != nullptr && slot->check == key.check;
+        }
+
+        void remove(const ResultKey &key);
+
+        uint64_t getUsedBytes() const {
+            return header->usedBytes;
+        }
+
+        std::size_t getEntriesCount() const {
+            return header->entriesCount;
+        }
+
+        const ResultCacheStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+    /**
+     * Simulator which looks result up in cache before running backend and stores it after.
+     * Eager environments are passed through, their state is already computed.
+    */
+    class CachedSimulator : public Simulator<QubitEnv> {
+        Simulator<QubitEnv> &backend;
+        std::string backendName;
+        std::string precision;
+        ResultCache &cache;
+
+        public:
+        CachedSimulator(
+            Simulator<QubitEnv> &backend,
+            const std::string &backendName,
+            ResultCache &cache,
+            const std::string &precision = "complex128"
+        );
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        /**
+         * Histogram of shots samples of final state, cached like final state. Cached histogram is
+         * returned as is, so repeated circuit gets the same samples.
+        */
+        Histogram sample(const QubitEnv &env, uint64_t shots);
+    };
+
+} // simulator
+} // qce
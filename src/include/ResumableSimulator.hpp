@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+#include "MappedFile.hpp"
+
+namespace qce {
+namespace simulator {
+
+    /**
+     * Layout of checkpoint file, all fields are in native byte order:
+     * header, RNG state of rngStateBytes, zero padding up to dataOffset (multiple of page size),
+     * then 2^qubitsCount amplitudes.
+     * headerChecksum covers header with headerChecksum set to zero and RNG state,
+     * stateChecksum covers amplitudes.
+    */
+    struct CheckpointHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t qubitsCount;
+        uint64_t position;
+        uint64_t gatesCount;
+        uint64_t circuitHash;
+        uint64_t rngStateBytes;
+        uint64_t dataOffset;
+        uint64_t stateChecksum;
+        uint64_t headerChecksum;
+    };
+
+    const uint32_t CHECKPOINT_VERSION = 2;
+
+    /**
+     * Simulator which can be stopped after any gate and continued later, possibly in another
+     * process. checkpoint() stores state, position in compiled gate list and state of RNG used
+     * by measure(). restore() maps checkpoint file back without copying, amplitudes are read
+     * from page cache and copied only when gate writes them.
+     * Checkpoint is written to temporary file which replaces path only after it is fully synced,
+     * so preemption during checkpoint leaves previous checkpoint intact.
+    */
+    class ResumableSimulator : public Simulator<QubitEnv> {
+        std::string checkpointPath;
+        std::size_t checkpointInterval;
+
+        std::size_t qubitsCount = 0;
+        std::vector<operations::GateRecord> gates;
+        operations::GateOperands operands;
+        uint64_t circuitHash = 0;
+        std::size_t position = 0;
+        bool isRestored = false;
+
+        DynamicQubitState ownedState;
+        utils::MappedFile mappedState;
+        kernels::Amplitude_t *amplitudes = nullptr;
+        uint64_t size = 0;
+
+        std::mt19937_64 engine;
+
+        /**
+         * Compiles env, keeps current state if it belongs to the same circuit.
+        */
+        void prepare(const QubitEnv &env);
+
+        /**
+         * Applies up to count next gates of prepared circuit, returns true when all are applied.
+        */
+        bool applyGates(std::size_t count);
+
+        public:
+        /**
+         * With non-empty checkpointPath and checkpointInterval, constructSolution writes checkpoint
+         * every checkpointInterval gates.
+        */
+        ResumableSimulator(const std::string &checkpointPath = "", std::size_t checkpointInterval = 0);
+
+        /**
+         * Applies up to count next gates of env, returns true when all gates are applied.
+         * Circuit of current state is continued from its position, other circuit starts anew.
+         * Every call compiles and hashes env, constructSolution does it once for all intervals.
+        */
+        bool advance(const QubitEnv &env, std::size_t count);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        void checkpoint(const std::string &path) const;
+
+        /**
+         * Maps checkpoint, throws std::runtime_error if file is damaged or of unknown version.
+         * Next run must be of the circuit checkpoint was made for, otherwise std::invalid_argument
+         * is thrown. State checksum is verified with one sequential read when verifyState is set.
+        */
+        void restore(const std::string &path, bool verifyState = true);
+
+        /**
+         * Samples basis state from current state with simulator's RNG.
+        */
+        std::size_t measure();
+
+        void seed(uint64_t value) {
+            engine.seed(value);
+        }
+
+        std::size_t getPosition() const {
+            return position;
+        }
+    };
+
+    /**
+     * Hash of initial states and gate list identifying circuit of checkpoint.
+    */
+    uint64_t circuitHashOf(const std::vector<QubitState> &initialStates, const std::vector<operations::GateRecord> &gates);
+
+    uint64_t circuitHashOf(
+        const std::vector<QubitState> &initialStates,
+        const std::vector<operations::GateRecord> &gates,
+        const operations::GateOperands &operands
+    );
+
+} // simulator
+} // qce
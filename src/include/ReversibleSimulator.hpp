@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulator.hpp"
+
+namespace qce {
+namespace simulator {
+
+    /**
+     * Returns true if every gate only permutes basis states (X, Cnot, Swap, MCX like Toffoli and
+     * MCSwap like Fredkin), so circuit is a classical reversible function of its input bits.
+    */
+    bool isReversibleCircuit(const std::vector<operations::Node<operations::GateRecord>> &gates);
+
+    /**
+     * Returns true if circuit is reversible and every initial state is |0> or |1>, then final
+     * state is a single basis state. Eager env is never classical, it has no gates.
+    */
+    bool isClassicalCircuit(const QubitEnv &env);
+
+    /**
+     * Simulator of reversible circuits as bit operations, without amplitudes.
+     * Single input is packed as bits: qubit q is bit q % 64 of word q / 64, so gate is a couple
+     * of word operations and width of register only costs n / 64 words. Batch is bit-sliced:
+     * word q holds qubit q of up to 64 inputs, and every gate processes all of them in one
+     * instruction (Cnot is lanes[t] ^= lanes[c], Toffoli is lanes[t] ^= lanes[c1] & lanes[c2]).
+     * Other circuits are simulated by the dense kernels like in SimpleSimulator.
+    */
+    class ReversibleSimulator : public Simulator<QubitEnv> {
+        public:
+        Solution constructSolution(const QubitEnv &env) override;
+
+        /**
+         * Final basis state of classical env, packed as bits. Throws std::invalid_argument if env
+         * is not classical.
+        */
+        std::vector<uint64_t> evaluate(const QubitEnv &env) const;
+
+        /**
+         * Outputs of reversible circuit of env for bit-sliced inputs, lanes[q] holds qubit q of
+         * every input, initial states of env are ignored. Throws std::invalid_argument if circuit
+         * is not reversible or lanes count differs from qubits count.
+        */
+        std::vector<uint64_t> evaluateBatch(const QubitEnv &env, const std::vector<uint64_t> &lanes) const;
+    };
+
+} // simulator
+} // qce
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    /**
+     * Point-to-point transport between ranks of sharded simulation.
+    */
+    class ShardTransport {
+        public:
+        virtual ~ShardTransport() = default;
+
+        virtual std::size_t getRank() const = 0;
+        virtual std::size_t getRanksCount() const = 0;
+
+        virtual void send(std::size_t peer, const void *buffer, std::size_t bytes) = 0;
+        virtual void receive(std::size_t peer, void *buffer, std::size_t bytes) = 0;
+
+        /**
+         * Sends buffer to peer and receives the same amount of bytes from it.
+         * Lower rank sends first, so pairwise exchange can't deadlock.
+        */
+        void exchange(std::size_t peer, const void *sendBuffer, void *receiveBuffer, std::size_t bytes);
+    };
+
+    /**
+     * Transport over Unix socket pairs between processes forked on one machine.
+    */
+    class SocketTransport : public ShardTransport {
+        std::size_t rank;
+        std::vector<int> sockets;
+
+        public:
+        /**
+         * sockets[peer] is connected to peer, sockets[rank] is unused.
+        */
+        SocketTransport(std::size_t rank, const std::vector<int> &sockets);
+        ~SocketTransport();
+
+        SocketTransport(const SocketTransport &) = delete;
+        SocketTransport& operator=(const SocketTransport &) = delete;
+
+        std::size_t getRank() const override {
+            return rank;
+        }
+
+        std::size_t getRanksCount() const override {
+            return sockets.size();
+        }
+
+        void send(std::size_t peer, const void *buffer, std::size_t bytes) override;
+        void receive(std::size_t peer, void *buffer, std::size_t bytes) override;
+    };
+
+    struct ShardStatistics {
+        std::size_t globalSwaps = 0;
+        uint64_t exchangedBytes = 0;
+    };
+
+    /**
+     * Executes compiled gate list on one shard. State is split between 2^g ranks by g most significant
+     * bits, rank keeps 2^(n-g) amplitudes. Gates on local qubits run without communication, global
+     * qubit of gate is first swapped with local qubit by exchanging half of local amplitudes with
+     * partner rank. Result of rank 0 is the whole state gathered from all ranks in natural layout,
+     * other ranks return empty state.
+    */
+    DynamicQubitState runShard(const OperGraphState &args, ShardTransport &transport, ShardStatistics &statistics);
+
+    /**
+     * Sharded state vector simulator. Ranks are processes forked on local machine and connected
+     * with SocketTransport, other transports can be plugged in through runShard.
+    */
+    class ShardedSimulator : public Simulator<QubitEnv> {
+        std::size_t ranks;
+        ShardStatistics statistics;
+
+        public:
+        ShardedSimulator(std::size_t ranks = 2);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        /**
+         * Statistics of rank 0.
+        */
+        const ShardStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+} // simulator
+} // qce
@@ -2,10 +2,12 @@
 
 #include <memory>
 #include <iostream>
+#include <utility>
 
 #include "OperationGraph.hpp"
 #include "QubitEnv.hpp"
 #include "OperationArgs.hpp"
+#include "GateKernels.hpp"
 #include "Utils.hpp"
 
 namespace qce {
@@ -15,7 +17,7 @@ namespace simulator {
         DynamicQubitState result;
         public:
 
-        Solution(DynamicQubitState &&state): result{state} {}
+        Solution(DynamicQubitState &&state): result{std::move(state)} {}
 
         const DynamicQubitState& getResult() const {
             return result;
@@ -41,18 +43,11 @@ namespace simulator {
         
         public:
         Solution constructSolution(const QubitEnv &env) override {
-            qce::OperGraphState args = env.provideExecutionArgs();
-            DynamicQubitState curState = (DynamicQubitState(1) << 1).finished();
-
-            for (const qce::QubitState &initState: args.getInitialStates()) {
-                curState = qce::utils::kroneckerProduct(curState, initState);
-            }
-
-            for (const qce::operations::Node<qce::BaseOperationPtr_t> &node: args.getNodes()) {
-                curState = (*node.getData())->applyOperation(qce::operations::OperationArgs(curState)).result;
+            if (env.getExecutionMode() == ExecutionMode::Eager) {
+                return Solution(DynamicQubitState(env.getLiveState()));
             }
 
-            return Solution(std::move(curState));
+            return Solution(env.computeState());
         }
     };
 } // simulator
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulator.hpp"
+#include "GateKernels.hpp"
+
+namespace qce {
+namespace simulator {
+
+    /**
+     * State vector which keeps only non-zero amplitudes, as open addressing table with linear
+     * probing from basis index to amplitude. Qubit q is stored at bit n-q-1 of basis index like
+     * in dense state. Table is at most half full, so registers of up to 63 qubits are supported
+     * and all ones index marks empty slot.
+    */
+    class SparseState {
+        struct Entry {
+            uint64_t key;
+            kernels::Amplitude_t value;
+        };
+
+        std::size_t qubitsCount;
+        std::vector<Entry> table;
+        std::size_t entriesCount = 0;
+
+        std::size_t slotOf(uint64_t key) const;
+        void grow();
+
+        public:
+        static const uint64_t EMPTY_KEY = UINT64_MAX;
+
+        explicit SparseState(std::size_t qubitsCount, std::size_t capacity = 16);
+
+        /**
+         * Product state of given single qubit states, zero amplitudes of qubits are skipped.
+        */
+        static SparseState productState(const std::vector<QubitState> &states);
+
+        std::size_t getQubitsCount() const {
+            return qubitsCount;
+        }
+
+        std::size_t size() const {
+            return entriesCount;
+        }
+
+        /**
+         * Adds value to amplitude of basis index, entry is created if it's missing.
+        */
+        void add(uint64_t key, kernels::Amplitude_t value);
+
+        kernels::Amplitude_t amplitude(uint64_t key) const;
+
+        /**
+         * Calls f(key, amplitude) for every stored entry.
+        */
+        template<typename F>
+        void forEach(F f) const {
+            for (const Entry &entry: table) {
+                if (entry.key != EMPTY_KEY) {
+                    f(entry.key, entry.value);
+                }
+            }
+        }
+
+        /**
+         * Applies gate visiting only stored entries. Diagonal gates scale entries in place,
+         * other gates move entries into new table, so gate costs O(entries) whatever size
+         * of register is. Multi-controlled gates only touch entries with all controls set.
+         * Entries with magnitude below threshold are dropped; returns their count.
+        */
+        std::size_t applyGate(
+            const operations::GateRecord &record,
+            const operations::GateOperands &operands,
+            const kernels::BitLayout &layout,
+            double threshold
+        );
+
+        DynamicQubitState toDense() const;
+    };
+
+    struct SparseStatistics {
+        std::size_t maxEntries = 0;
+        std::size_t prunedEntries = 0;
+        std::size_t denseFallbacks = 0;
+    };
+
+    /**
+     * Simulator for circuits which keep only a few non-zero amplitudes, like reversible arithmetic
+     * and oracles. Circuit starts on SparseState, amplitudes with magnitude below pruneThreshold are
+     * dropped after every gate. When stored entries exceed densityCutoff of 2^n, the rest of circuit
+     * runs on dense state vector, sparse table would only be slower there.
+    */
+    class SparseSimulator : public Simulator<QubitEnv> {
+        double pruneThreshold;
+        double densityCutoff;
+        SparseStatistics statistics;
+
+        public:
+        SparseSimulator(double pruneThreshold = 1e-12, double densityCutoff = 1. / 16);
+
+        Solution constructSolution(const QubitEnv &env) override;
+
+        /**
+         * Final state of env without dense fallback, for registers too wide for dense state.
+         * Throws std::invalid_argument for eager env or env of more than 63 qubits and
+         * std::runtime_error if entries exceed maxEntries.
+        */
+        SparseState sparseState(const QubitEnv &env, std::size_t maxEntries = std::size_t(1) << 24);
+
+        const SparseStatistics& getStatistics() const {
+            return statistics;
+        }
+    };
+
+} // simulator
+} // qce
@@ -51,12 +51,27 @@ namespace utils {
      * Function for finding index number of value in iterator range. 
     */
     template<typename Iter>
-    std::size_t findIndex(Iter begin, Iter end, typename std::iterator_traits<Iter>::value_type &value) {
+    std::size_t findIndex(Iter begin, Iter end, const typename std::iterator_traits<Iter>::value_type &value) {
         std::size_t ind = 0;
         for (;begin != end && *begin != value; begin++, ind++);
         return ind;
     }
 
+    const uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+    /**
+     * 64-bit hash of byte range, bytes are consumed by 8-byte words. Hash of concatenation
+     * may be computed piece by piece passing previous hash as seed, if all pieces but the last
+     * one are multiples of 8 bytes.
+    */
+    uint64_t hashBytes(const void *data, std::size_t bytes, uint64_t seed = HASH_SEED);
+
+    /**
+     * Appends canonical words of initial states for hashing: their count, then bits of real and
+     * imaginary parts of both amplitudes of every state, -0.0 is appended as 0.0.
+    */
+    void appendStateWords(std::vector<uint64_t> &words, const std::vector<QubitState> &states);
+
     int32_t rrandom32();
     int64_t rrandom64();
     uint32_t rrandom32u();
@@ -84,8 +99,8 @@ namespace utils {
      * Function for picking random number in specified range  with given probabilities
      * of every possible outcome.
     */
-    unsigned probabilityRandomChoice(Eigen::Matrix<double, -1, 1> probabilities);
-    Eigen::Matrix<double, -1, 1> convertAmplitudes2Probs(qce::DynamicQubitState qState);
+    std::size_t probabilityRandomChoice(const Eigen::Matrix<double, -1, 1> &probabilities);
+    Eigen::Matrix<double, -1, 1> convertAmplitudes2Probs(const qce::DynamicQubitState &qState);
 
 } // utils
 } // qce
\ No newline at end of file
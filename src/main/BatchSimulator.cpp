@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <deque>
+#include <exception>
+
+#include "BatchSimulator.hpp"
+
+using namespace qce::operations;
+using qce::kernels::Amplitude_t;
+
+struct qce::simulator::BatchSimulator::Worker {
+    std::mutex mutex;
+    std::deque<Task> jobs;
+    std::deque<Task> pieces;
+};
+
+namespace {
+    /**
+     * Writes amplitudes [begin, end) of product state of given single qubit states.
+    */
+    void productStatePart(
+        Amplitude_t *amplitudes,
+        const std::vector<qce::QubitState> &states,
+        uint64_t begin,
+        uint64_t end
+    ) {
+        const std::size_t n = states.size();
+        for (uint64_t i = begin; i < end; i++) {
+            Amplitude_t amplitude = 1;
+            for (std::size_t q = 0; q < n; q++) {
+                amplitude *= states[q][(i >> (n - q - 1)) & 1];
+            }
+            amplitudes[i] = amplitude;
+        }
+    }
+
+    uint64_t pieceBegin(uint64_t size, std::size_t piece, std::size_t pieces) {
+        return size / pieces * piece + std::min<uint64_t>(piece, size % pieces);
+    }
+} // namespace
+
+qce::simulator::BatchSimulator::BatchSimulator(std::size_t threads, uint32_t parallelQubits):
+    threads{threads}, parallelQubits{parallelQubits} {
+    if (this->threads == 0) {
+        this->threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    for (std::size_t i = 0; i < this->threads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (std::size_t i = 0; i < this->threads; i++) {
+        pool.emplace_back(&BatchSimulator::workerLoop, this, i);
+    }
+}
+
+qce::simulator::BatchSimulator::~BatchSimulator() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        isStopping = true;
+    }
+    wakeUp.notify_all();
+
+    // queued jobs are finished before workers exit
+    for (std::thread &thread: pool) {
+        thread.join();
+    }
+}
+
+void qce::simulator::BatchSimulator::post(Task &&task, bool isPiece, std::size_t worker) {
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        (isPiece ? workers[worker]->pieces : workers[worker]->jobs).push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedTasks++;
+    }
+    wakeUp.notify_one();
+}
+
+bool qce::simulator::BatchSimulator::takeTask(std::size_t self, Task &task, bool piecesOnly) {
+    auto take = [&](std::size_t worker, bool isPiece, bool fromBack) {
+        Worker &owner = *workers[worker];
+        std::lock_guard<std::mutex> lock(owner.mutex);
+        std::deque<Task> &tasks = isPiece ? owner.pieces : owner.jobs;
+        if (tasks.empty()) {
+            return false;
+        }
+
+        if (fromBack) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        queuedTasks--;
+        return true;
+    };
+
+    // own pieces are taken newest first, stolen ones and jobs oldest first
+    if (take(self, true, true)) {
+        return true;
+    }
+    for (std::size_t i = 1; i < threads; i++) {
+        if (take((self + i) % threads, true, false)) {
+            stolenTasks++;
+            return true;
+        }
+    }
+    if (piecesOnly) {
+        return false;
+    }
+
+    if (take(self, false, false)) {
+        return true;
+    }
+    for (std::size_t i = 1; i < threads; i++) {
+        if (take((self + i) % threads, false, true)) {
+            stolenTasks++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void qce::simulator::BatchSimulator::workerLoop(std::size_t self) {
+    Task task;
+    while (true) {
+        if (takeTask(self, task, false)) {
+            task(self);
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [&]() { return queuedTasks > 0 || isStopping; });
+        if (isStopping && queuedTasks == 0) {
+            return;
+        }
+    }
+}
+
+void qce::simulator::BatchSimulator::parallelFor(
+    std::size_t self,
+    std::size_t pieces,
+    const std::function<void(std::size_t)> &f
+) {
+    std::atomic<std::size_t> remaining{pieces - 1};
+    std::vector<std::exception_ptr> errors(pieces);
+
+    for (std::size_t piece = 1; piece < pieces; piece++) {
+        post([&, piece](std::size_t) {
+            try {
+                f(piece);
+            } catch (...) {
+                errors[piece] = std::current_exception();
+            }
+            remaining--;
+        }, true, self);
+    }
+
+    try {
+        f(0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+
+    // pieces reference this frame, so they are waited for even after error
+    Task task;
+    while (remaining > 0) {
+        if (takeTask(self, task, true)) {
+            task(self);
+            task = nullptr;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (const std::exception_ptr &error: errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+qce::simulator::Solution qce::simulator::BatchSimulator::execute(std::size_t self, const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const std::size_t n = initialStates.size();
+    const kernels::BitLayout layout(n);
+    const uint64_t size = uint64_t(1) << n;
+
+    // built in place so result is handed to solution without copy
+    DynamicQubitState state(size);
+    Amplitude_t *amplitudes = state.data();
+
+    const std::size_t pieces = threadsFor(n);
+    if (pieces == 1) {
+        productStatePart(amplitudes, initialStates, 0, size);
+        for (const Node<GateRecord> &node: nodes) {
+            kernels::applyGate(amplitudes, size, node.getData(), args.getOperands(), layout);
+        }
+    } else {
+        parallelJobs++;
+        parallelFor(self, pieces, [&](std::size_t piece) {
+            productStatePart(amplitudes, initialStates, pieceBegin(size, piece, pieces), pieceBegin(size, piece + 1, pieces));
+        });
+        for (const Node<GateRecord> &node: nodes) {
+            parallelFor(self, pieces, [&](std::size_t piece) {
+                kernels::applyGatePart(amplitudes, size, node.getData(), args.getOperands(), layout, piece, pieces);
+            });
+        }
+    }
+
+    return Solution(std::move(state));
+}
+
+std::size_t qce::simulator::BatchSimulator::threadsFor(std::size_t qubitsCount) const {
+    if (qubitsCount <= parallelQubits) {
+        return 1;
+    }
+
+    const std::size_t extraBits = qubitsCount - parallelQubits;
+    return extraBits >= 63 ? threads : (std::size_t)std::min<uint64_t>(threads, uint64_t(1) << extraBits);
+}
+
+std::vector<std::future<qce::simulator::Solution>> qce::simulator::BatchSimulator::submit(std::vector<QubitEnv> jobs) {
+    auto batch = std::make_shared<const std::vector<QubitEnv>>(std::move(jobs));
+    std::vector<std::future<Solution>> futures;
+    futures.reserve(batch->size());
+
+    for (std::size_t job = 0; job < batch->size(); job++) {
+        auto promise = std::make_shared<std::promise<Solution>>();
+        futures.push_back(promise->get_future());
+        post([this, batch, job, promise](std::size_t self) {
+            try {
+                Solution solution = execute(self, (*batch)[job]);
+                completedJobs++;
+                promise->set_value(std::move(solution));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        }, false, nextWorker++ % threads);
+    }
+
+    return futures;
+}
+
+std::future<void> qce::simulator::BatchSimulator::submit(std::vector<QubitEnv> jobs, BatchCallback callback) {
+    struct BatchState {
+        std::vector<QubitEnv> jobs;
+        BatchCallback callback;
+        std::atomic<std::size_t> remaining;
+        std::mutex mutex;
+        std::exception_ptr error;
+        std::promise<void> done;
+    };
+
+    auto batch = std::make_shared<BatchState>();
+    batch->jobs = std::move(jobs);
+    batch->callback = std::move(callback);
+    batch->remaining = batch->jobs.size();
+    std::future<void> done = batch->done.get_future();
+    if (batch->jobs.empty()) {
+        batch->done.set_value();
+        return done;
+    }
+
+    for (std::size_t job = 0; job < batch->jobs.size(); job++) {
+        post([this, batch, job](std::size_t self) {
+            try {
+                Solution solution = execute(self, batch->jobs[job]);
+                completedJobs++;
+                batch->callback(job, std::move(solution));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                if (!batch->error) {
+                    batch->error = std::current_exception();
+                }
+            }
+
+            if (--batch->remaining == 0) {
+                if (batch->error) {
+                    batch->done.set_exception(batch->error);
+                } else {
+                    batch->done.set_value();
+                }
+            }
+        }, false, nextWorker++ % threads);
+    }
+
+    return done;
+}
+
+std::vector<qce::simulator::Solution> qce::simulator::BatchSimulator::run(std::vector<QubitEnv> jobs) {
+    std::vector<std::future<Solution>> futures = submit(std::move(jobs));
+    std::vector<Solution> solutions;
+    solutions.reserve(futures.size());
+    for (std::future<Solution> &future: futures) {
+        solutions.push_back(future.get());
+    }
+
+    return solutions;
+}
+
+qce::simulator::Solution qce::simulator::BatchSimulator::constructSolution(const QubitEnv &env) {
+    // env outlives task because caller waits for it
+    std::promise<Solution> promise;
+    std::future<Solution> future = promise.get_future();
+    post([this, &env, &promise](std::size_t self) {
+        try {
+            Solution solution = execute(self, env);
+            completedJobs++;
+            promise.set_value(std::move(solution));
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }, false, nextWorker++ % threads);
+
+    return future.get();
+}
+
+qce::simulator::BatchStatistics qce::simulator::BatchSimulator::getStatistics() const {
+    BatchStatistics statistics;
+    statistics.completedJobs = completedJobs;
+    statistics.parallelJobs = parallelJobs;
+    statistics.stolenTasks = stolenTasks;
+    return statistics;
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "BlockedExecution.hpp"
+
+using namespace qce::operations;
+
+void qce::simulator::applyBlockedRun(
+    kernels::Amplitude_t *amplitudes,
+    uint64_t size,
+    const Node<GateRecord> *gates,
+    std::size_t count,
+    const GateOperands &operands,
+    const kernels::BitLayout &layout,
+    uint32_t blockBits
+) {
+    const uint64_t tileSize = std::min(size, uint64_t(1) << blockBits);
+
+    for (uint64_t offset = 0; offset < size; offset += tileSize) {
+        for (std::size_t i = 0; i < count; i++) {
+            kernels::applyGate(amplitudes + offset, tileSize, gates[i].getData(), operands, layout);
+        }
+    }
+}
+
+qce::simulator::BlockedSimulator::BlockedSimulator(uint32_t blockBits): blockBits{blockBits} {
+    if (blockBits < 2) {
+        throw std::invalid_argument("Provided blockBits can't hold two qubit gate");
+    }
+}
+
+qce::simulator::Solution qce::simulator::BlockedSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    statistics = BlockedStatistics();
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const kernels::BitLayout layout(args.getInitialStates().size());
+    DynamicQubitState state = kernels::productState(args.getInitialStates());
+
+    auto isBlockable = [&](const GateRecord &gate) {
+        bool result = true;
+        forEachGateQubit(gate, args.getOperands(), [&](uint32_t qubit) { result = result && layout.bitOf(qubit) < blockBits; });
+        return result;
+    };
+
+    std::size_t position = 0;
+    while (position < nodes.size()) {
+        std::size_t runEnd = position;
+        while (runEnd < nodes.size() && isBlockable(nodes[runEnd].getData())) {
+            runEnd++;
+        }
+
+        if (runEnd - position > 1) {
+            applyBlockedRun(
+                state.data(), (uint64_t)state.size(), nodes.data() + position, runEnd - position,
+                args.getOperands(), layout, blockBits
+            );
+            statistics.blockedRuns++;
+            statistics.blockedGates += runEnd - position;
+            statistics.sweeps++;
+            position = runEnd;
+            continue;
+        }
+
+        kernels::applyGate(state, nodes[position].getData(), args.getOperands(), layout);
+        statistics.sweeps++;
+        position++;
+    }
+
+    return Solution(std::move(state));
+}
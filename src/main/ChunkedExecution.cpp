@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "ChunkedExecution.hpp"
+#include "BlockedExecution.hpp"
+#include "QubitRemapping.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    /**
+     * Exchanges two bits of every amplitude index in one pass. Low bits are swapped inside chunks,
+     * high bit with low bit exchanges halves of chunk pairs, two high bits exchange whole chunks.
+    */
+    void swapStateBits(qce::simulator::ChunkedState &state, uint32_t first, uint32_t second) {
+        const uint32_t chunkBits = state.getChunkBits();
+        const uint64_t chunkSize = state.getChunkSize();
+        const uint32_t lowBit = std::min(first, second);
+        const uint32_t highBit = std::max(first, second);
+
+        if (highBit < chunkBits) {
+            for (uint64_t index = 0; index < state.getChunksCount(); index++) {
+                state.prefetch(index + 1);
+                qce::kernels::swapBits(state.chunk(index), chunkSize, {{lowBit, highBit}});
+                state.release(index);
+            }
+            return;
+        }
+
+        const uint64_t highMask = uint64_t(1) << (highBit - chunkBits);
+        if (lowBit < chunkBits) {
+            // amplitudes with high bit 0 and low bit 1 trade places with high bit 1 and low bit 0
+            const uint64_t lowMask = uint64_t(1) << lowBit;
+            for (uint64_t index = 0; index < state.getChunksCount(); index++) {
+                if ((index & highMask) != 0) {
+                    continue;
+                }
+
+                Amplitude_t *zero = state.chunk(index), *one = state.chunk(index | highMask);
+                for (uint64_t k = 0; k < chunkSize >> 1; k++) {
+                    uint64_t i = qce::kernels::insertZeroBit(k, lowBit);
+                    std::swap(zero[i | lowMask], one[i]);
+                }
+                state.release(index);
+                state.release(index | highMask);
+            }
+            return;
+        }
+
+        const uint64_t lowMask = uint64_t(1) << (lowBit - chunkBits);
+        for (uint64_t index = 0; index < state.getChunksCount(); index++) {
+            if ((index & highMask) == 0 || (index & lowMask) != 0) {
+                continue;
+            }
+
+            uint64_t partner = index ^ highMask ^ lowMask;
+            std::swap_ranges(state.chunk(index), state.chunk(index) + chunkSize, state.chunk(partner));
+            state.release(index);
+            state.release(partner);
+        }
+    }
+} // namespace
+
+void qce::simulator::runChunked(
+    const QubitEnv &env,
+    ChunkedState &state,
+    std::size_t lookahead,
+    ChunkedStatistics &statistics
+) {
+    const std::size_t n = state.getQubitsCount();
+    if (env.getQubitCount() != n) {
+        throw std::invalid_argument("Provided state doesn't match qubits count of environment");
+    }
+
+    const uint32_t localBits = state.getChunkBits();
+    const uint64_t chunkSize = state.getChunkSize();
+    const uint64_t chunksCount = state.getChunksCount();
+
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        const DynamicQubitState &live = env.getLiveState();
+        for (uint64_t index = 0; index < chunksCount; index++) {
+            std::memcpy(state.chunk(index), live.data() + index * chunkSize, chunkSize * sizeof(Amplitude_t));
+            state.release(index);
+        }
+        return;
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+
+    // qubits 0..n-localBits-1 select chunk in natural layout, chunk is their factor times low product
+    const std::size_t highCount = n - localBits;
+    const DynamicQubitState low = kernels::productState(
+        std::vector<QubitState>(initialStates.begin() + (std::ptrdiff_t)highCount, initialStates.end())
+    );
+    for (uint64_t index = 0; index < chunksCount; index++) {
+        Amplitude_t factor = 1;
+        for (std::size_t qubit = 0; qubit < highCount; qubit++) {
+            factor *= initialStates[qubit][(index >> (highCount - qubit - 1)) & 1];
+        }
+
+        Amplitude_t *amplitudes = state.chunk(index);
+        for (uint64_t i = 0; i < chunkSize; i++) {
+            amplitudes[i] = factor * low[(Eigen::Index)i];
+        }
+        state.release(index);
+    }
+
+    const kernels::BitLayout natural(n);
+    kernels::BitLayout layout = natural;
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const GateOperands &operands = args.getOperands();
+    for (const Node<GateRecord> &node: nodes) {
+        std::size_t gateQubits = 0;
+        forEachGateQubit(node.getData(), operands, [&](uint32_t) { gateQubits++; });
+        if (gateQubits > localBits) {
+            throw std::invalid_argument("Provided chunks can't hold qubits of " + gateName(node.getData().kind));
+        }
+    }
+
+    // gates before start are all applied, gates after it may be applied out of order
+    std::vector<bool> isApplied(nodes.size(), false);
+    std::size_t start = 0;
+    std::vector<Node<GateRecord>> pass;
+    std::vector<bool> isBlocked(n);
+    while (start < nodes.size()) {
+        // local gate joins pass unless it shares qubit with earlier gate left for later,
+        // once every qubit is blocked no later gate can join
+        pass.clear();
+        isBlocked.assign(n, false);
+        std::size_t blockedCount = 0;
+        bool hasSkipped = false;
+        for (std::size_t i = start; i < nodes.size() && blockedCount < n; i++) {
+            if (isApplied[i]) {
+                continue;
+            }
+
+            const GateRecord &gate = nodes[i].getData();
+            bool isReady = true;
+            forEachGateQubit(gate, operands, [&](uint32_t qubit) {
+                isReady = isReady && !isBlocked[qubit] && layout.bitOf(qubit) < localBits;
+            });
+
+            if (isReady) {
+                statistics.reorderedGates += hasSkipped ? 1 : 0;
+                pass.push_back(nodes[i]);
+                isApplied[i] = true;
+                continue;
+            }
+
+            hasSkipped = true;
+            forEachGateQubit(gate, operands, [&](uint32_t qubit) {
+                blockedCount += isBlocked[qubit] ? 0 : 1;
+                isBlocked[qubit] = true;
+            });
+        }
+        while (start < nodes.size() && isApplied[start]) {
+            start++;
+        }
+
+        if (pass.empty()) {
+            // the first unapplied gate isn't local, remap is planned over the next unapplied gates
+            const std::size_t windowSize = std::max<std::size_t>(lookahead, 1);
+            std::vector<Node<GateRecord>> window;
+            for (std::size_t i = start; i < nodes.size() && window.size() < windowSize; i++) {
+                if (!isApplied[i]) {
+                    window.push_back(nodes[i]);
+                }
+            }
+
+            for (const auto &swap: planRemap(window, operands, 0, layout, localBits, windowSize)) {
+                swapStateBits(state, layout.bitOf(swap.first), layout.bitOf(swap.second));
+                layout.swapQubits(swap.first, swap.second);
+                statistics.swapPasses++;
+            }
+            continue;
+        }
+
+        for (uint64_t index = 0; index < chunksCount; index++) {
+            state.prefetch(index + 1);
+            applyBlockedRun(state.chunk(index), chunkSize, pass.data(), pass.size(), operands, layout, localBits);
+            state.release(index);
+        }
+        statistics.gatePasses++;
+    }
+
+    // high bits are placed one by one, then low bits are permuted inside every chunk
+    for (uint32_t bit = (uint32_t)n; bit-- > localBits;) {
+        std::size_t qubit = natural.qubitAt(bit);
+        if (layout.bitOf(qubit) != bit) {
+            swapStateBits(state, layout.bitOf(qubit), bit);
+            layout.swapQubits(qubit, layout.qubitAt(bit));
+            statistics.swapPasses++;
+        }
+    }
+
+    if (layout != natural) {
+        for (uint64_t index = 0; index < chunksCount; index++) {
+            kernels::BitLayout from = layout;
+            state.prefetch(index + 1);
+            kernels::changeLayout(state.chunk(index), chunkSize, from, natural);
+            state.release(index);
+        }
+        statistics.swapPasses++;
+    }
+}
+
+qce::simulator::ChunkedSimulator::ChunkedSimulator(uint32_t chunkBits, std::size_t lookahead):
+    chunkBits{chunkBits}, lookahead{lookahead} {
+    if (chunkBits < 2) {
+        throw std::invalid_argument("Provided chunkBits can't hold two qubit gate");
+    }
+}
+
+qce::simulator::ChunkedState qce::simulator::ChunkedSimulator::run(const QubitEnv &env) {
+    statistics = ChunkedStatistics();
+    std::size_t n = env.getQubitCount();
+    ChunkedState state(n, (uint32_t)std::min<std::size_t>(chunkBits, n));
+    runChunked(env, state, lookahead, statistics);
+    return state;
+}
+
+qce::simulator::Solution qce::simulator::ChunkedSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    return Solution(run(env).load());
+}
+
+qce::simulator::OutOfCoreSimulator::OutOfCoreSimulator(
+    const std::string &directory,
+    uint32_t chunkBits,
+    std::size_t lookahead
+): directory{directory}, chunkBits{chunkBits}, lookahead{lookahead} {
+    if (chunkBits < 2) {
+        throw std::invalid_argument("Provided chunkBits can't hold two qubit gate");
+    }
+}
+
+qce::simulator::ChunkedState qce::simulator::OutOfCoreSimulator::run(const QubitEnv &env) {
+    statistics = ChunkedStatistics();
+    std::size_t n = env.getQubitCount();
+    const uint64_t bytes = (uint64_t(1) << n) * sizeof(Amplitude_t);
+
+    ChunkedState state(utils::MappedFile::temporary(directory, bytes), n, (uint32_t)std::min<std::size_t>(chunkBits, n));
+    state.getFile().advise(0, bytes, MADV_SEQUENTIAL);
+    runChunked(env, state, lookahead, statistics);
+    return state;
+}
+
+qce::simulator::Solution qce::simulator::OutOfCoreSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    return Solution(run(env).load());
+}
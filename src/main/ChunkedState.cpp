@@ -0,0 +1,52 @@
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "ChunkedState.hpp"
+
+qce::simulator::ChunkedState::ChunkedState(std::size_t qubitsCount, uint32_t chunkBits):
+    qubitsCount{qubitsCount}, chunkBits{chunkBits} {
+    if (chunkBits > qubitsCount) {
+        throw std::invalid_argument("Provided chunkBits exceed qubits count");
+    }
+
+    chunks.reserve(getChunksCount());
+    for (uint64_t index = 0; index < getChunksCount(); index++) {
+        chunks.push_back(std::make_unique<kernels::Amplitude_t[]>(getChunkSize()));
+    }
+}
+
+qce::simulator::ChunkedState::ChunkedState(utils::MappedFile &&file, std::size_t qubitsCount, uint32_t chunkBits):
+    file{std::move(file)}, qubitsCount{qubitsCount}, chunkBits{chunkBits} {
+    if (chunkBits > qubitsCount) {
+        throw std::invalid_argument("Provided chunkBits exceed qubits count");
+    }
+    if (this->file.size() < size() * sizeof(kernels::Amplitude_t)) {
+        throw std::invalid_argument("Provided file is too small for state");
+    }
+}
+
+void qce::simulator::ChunkedState::prefetch(uint64_t index) const {
+    if (isMapped()) {
+        const uint64_t chunkBytes = getChunkSize() * sizeof(kernels::Amplitude_t);
+        file.advise(index * chunkBytes, chunkBytes, MADV_WILLNEED);
+    }
+}
+
+void qce::simulator::ChunkedState::release(uint64_t index) const {
+    if (isMapped()) {
+        const uint64_t chunkBytes = getChunkSize() * sizeof(kernels::Amplitude_t);
+        file.advise(index * chunkBytes, chunkBytes, MADV_DONTNEED);
+    }
+}
+
+qce::DynamicQubitState qce::simulator::ChunkedState::load() const {
+    DynamicQubitState result((Eigen::Index)size());
+    const uint64_t chunkSize = getChunkSize();
+    for (uint64_t index = 0; index < getChunksCount(); index++) {
+        std::memcpy(result.data() + index * chunkSize, chunk(index), chunkSize * sizeof(kernels::Amplitude_t));
+        release(index);
+    }
+
+    return result;
+}
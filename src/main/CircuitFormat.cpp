@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "CircuitFormat.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    const char CIRCUIT_MAGIC[8] = {'Q', 'C', 'E', 'C', 'I', 'R', 'C', '\0'};
+    // buffer is flushed in pieces of this size, pieces are multiples of 8 bytes for hashBytes
+    const std::size_t FLUSH_BYTES = std::size_t(1) << 20;
+
+    bool isKnownGateKind(uint8_t opcode) {
+        return opcode <= (uint8_t)GateKind::PauliRotation;
+    }
+} // namespace
+
+CircuitWriter::CircuitWriter(const std::string &path, const std::vector<QubitState> &initialStates):
+    file{path, std::ios::binary | std::ios::trunc}, path{path}, header{}, checksum{utils::HASH_SEED} {
+    if (!file) {
+        throw std::runtime_error("Failed to create circuit file " + path);
+    }
+
+    std::memcpy(header.magic, CIRCUIT_MAGIC, sizeof(header.magic));
+    header.version = CIRCUIT_FORMAT_VERSION;
+    header.qubitsCount = (uint32_t)initialStates.size();
+    header.parametersCount = 4 * initialStates.size();
+
+    // header is rewritten on close, when counts are known
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<double> parameters;
+    parameters.reserve(header.parametersCount);
+    for (const QubitState &state: initialStates) {
+        parameters.insert(parameters.end(), {state[0].real(), state[0].imag(), state[1].real(), state[1].imag()});
+    }
+    checksum = utils::hashBytes(parameters.data(), parameters.size() * sizeof(double), checksum);
+    file.write(reinterpret_cast<const char*>(parameters.data()), (std::streamsize)(parameters.size() * sizeof(double)));
+
+    buffer.reserve(FLUSH_BYTES + 16);
+}
+
+CircuitWriter::~CircuitWriter() {
+    if (!isClosed) {
+        try {
+            close();
+        } catch (...) {}
+    }
+}
+
+void CircuitWriter::flush() {
+    // only multiples of 8 bytes are hashed before close, so hash is the same as of whole stream
+    std::size_t bytes = isClosed ? buffer.size() : buffer.size() / 8 * 8;
+    checksum = utils::hashBytes(buffer.data(), bytes, checksum);
+    file.write(reinterpret_cast<const char*>(buffer.data()), (std::streamsize)bytes);
+    header.streamBytes += bytes;
+    buffer.erase(buffer.begin(), buffer.begin() + (std::ptrdiff_t)bytes);
+}
+
+void CircuitWriter::add(const GateRecord &gate) {
+    add(gate, GateOperands());
+}
+
+void CircuitWriter::add(const GateRecord &gate, const GateOperands &operands) {
+    if (isClosed) {
+        throw std::logic_error("Circuit file " + path + " is already closed");
+    }
+
+    bool isValid = true;
+    forEachGateQubit(gate, operands, [&](uint32_t qubit) { isValid = isValid && qubit < header.qubitsCount; });
+    if (!isValid) {
+        throw std::invalid_argument("Provided gate acts on qubit outside of circuit");
+    }
+
+    buffer.push_back((uint8_t)gate.kind);
+    appendVarint(buffer, gate.target);
+    if (hasOperands(gate.kind)) {
+        const uint32_t *controls = operands.getControls(gate);
+        appendVarint(buffer, operands.getControlsCount(gate));
+        for (uint32_t i = 0; i < operands.getControlsCount(gate); i++) {
+            appendVarint(buffer, controls[i]);
+        }
+        if (gate.kind == GateKind::MCSwap) {
+            appendVarint(buffer, operands.getSecondTarget(gate));
+        }
+
+        const std::complex<double> *values = operands.getValues(gate);
+        for (std::size_t i = 0; i < operandValuesCount(gate.kind, operands.getControlsCount(gate)); i++) {
+            const double parts[2] = {values[i].real(), values[i].imag()};
+            const uint8_t *bytes = reinterpret_cast<const uint8_t*>(parts);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(parts));
+        }
+    } else if (!isSingleQubitGate(gate.kind)) {
+        appendVarint(buffer, gate.control);
+    }
+    header.gatesCount++;
+
+    if (buffer.size() >= FLUSH_BYTES) {
+        flush();
+    }
+}
+
+void CircuitWriter::close() {
+    if (isClosed) {
+        return;
+    }
+
+    isClosed = true;
+    flush();
+    header.checksum = checksum;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("Failed to write circuit file " + path);
+    }
+}
+
+void qce::operations::writeCircuit(const std::string &path, const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to write");
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    CircuitWriter writer(path, args.getInitialStates());
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        writer.add(node.getData(), args.getOperands());
+    }
+    writer.close();
+}
+
+MappedCircuit::MappedCircuit(const std::string &path, bool verify):
+    file{path, utils::MappingMode::ReadOnly} {
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("Circuit file " + path + " is truncated");
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CIRCUIT_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File " + path + " is not a circuit file");
+    }
+    if (header.version != CIRCUIT_FORMAT_VERSION) {
+        throw std::runtime_error("Circuit file " + path + " has unsupported version " + std::to_string(header.version));
+    }
+
+    const uint64_t available = (file.size() - sizeof(header)) / sizeof(double);
+    if (header.parametersCount > available || header.parametersCount < 4 * (uint64_t)header.qubitsCount ||
+        header.streamBytes != file.size() - sizeof(header) - header.parametersCount * sizeof(double)) {
+        throw std::runtime_error("Circuit file " + path + " is truncated");
+    }
+
+    parameters = reinterpret_cast<const double*>(file.data() + sizeof(header));
+    stream = reinterpret_cast<const uint8_t*>(parameters + header.parametersCount);
+
+    if (verify) {
+        file.advise(0, file.size(), MADV_SEQUENTIAL);
+        uint64_t checksum = utils::hashBytes(parameters, header.parametersCount * sizeof(double));
+        checksum = utils::hashBytes(stream, header.streamBytes, checksum);
+        if (checksum != header.checksum) {
+            throw std::runtime_error("Circuit file " + path + " is damaged");
+        }
+        file.advise(0, file.size(), MADV_NORMAL);
+    }
+}
+
+std::vector<qce::QubitState> MappedCircuit::getInitialStates() const {
+    std::vector<QubitState> states(header.qubitsCount);
+    for (std::size_t qubit = 0; qubit < states.size(); qubit++) {
+        const double *values = parameters + 4 * qubit;
+        states[qubit] << std::complex<double>(values[0], values[1]), std::complex<double>(values[2], values[3]);
+    }
+
+    return states;
+}
+
+bool MappedCircuit::Cursor::next(GateRecord &gate) {
+    if (position == end) {
+        return false;
+    }
+
+    uint8_t opcode = *position++;
+    if (!isKnownGateKind(opcode)) {
+        throw std::runtime_error("Circuit stream has unknown opcode " + std::to_string(opcode));
+    }
+
+    uint64_t target = 0, control = NO_CONTROL_QUBIT;
+    bool isValid = readVarint(position, end, target) && target < qubitsCount;
+    if (isValid && hasOperands((GateKind)opcode)) {
+        // qubits of multi-controlled gate are validated by entry of scratch operands
+        uint64_t controlsCount = 0, second = NO_CONTROL_QUBIT;
+        isValid = readVarint(position, end, controlsCount) && controlsCount < qubitsCount &&
+            ((GateKind)opcode != GateKind::Unitary || controlsCount < MAX_UNITARY_QUBITS) &&
+            ((GateKind)opcode != GateKind::PhaseOracle || controlsCount < MAX_ORACLE_QUBITS);
+        std::vector<uint32_t> controls;
+        for (uint64_t i = 0, qubit = 0; isValid && i < controlsCount; i++) {
+            isValid = readVarint(position, end, qubit) && qubit < qubitsCount;
+            controls.push_back((uint32_t)qubit);
+        }
+        if (isValid && (GateKind)opcode == GateKind::MCSwap) {
+            isValid = readVarint(position, end, second) && second < qubitsCount;
+        }
+
+        // count of values is checked against rest of stream before table is allocated
+        const std::size_t valuesCount = isValid ? operandValuesCount((GateKind)opcode, controlsCount) : 0;
+        isValid = isValid && (std::size_t)(end - position) / (2 * sizeof(double)) >= valuesCount;
+        std::vector<std::complex<double>> values(isValid ? valuesCount : 0);
+        for (std::size_t i = 0; isValid && i < values.size(); i++) {
+            double parts[2];
+            std::memcpy(parts, position, sizeof(parts));
+            position += sizeof(parts);
+            values[i] = std::complex<double>(parts[0], parts[1]);
+        }
+
+        if (isValid) {
+            std::vector<uint32_t> qubits = controls;
+            qubits.push_back((uint32_t)target);
+            if (second != NO_CONTROL_QUBIT) {
+                qubits.push_back((uint32_t)second);
+            }
+            std::sort(qubits.begin(), qubits.end());
+            isValid = std::adjacent_find(qubits.begin(), qubits.end()) == qubits.end();
+        }
+        if (!isValid) {
+            throw std::runtime_error("Circuit stream has malformed gate");
+        }
+
+        operands.clear();
+        gate = GateRecord((GateKind)opcode, (uint32_t)target, operands.add(controls, (uint32_t)second, values));
+        return true;
+    }
+    if (isValid && !isSingleQubitGate((GateKind)opcode)) {
+        isValid = readVarint(position, end, control) && control < qubitsCount && control != target;
+    }
+    if (!isValid) {
+        throw std::runtime_error("Circuit stream has malformed gate");
+    }
+
+    gate = GateRecord((GateKind)opcode, (uint32_t)target, (uint32_t)control);
+    return true;
+}
+
+qce::simulator::Solution qce::simulator::StreamSimulator::constructSolution(const MappedCircuit &circuit) {
+    // header only limits qubits count by file size, wide circuits are readable but not simulable
+    if (circuit.getQubitsCount() >= 64) {
+        throw std::invalid_argument("Circuit of 64 or more qubits can't be simulated on state vector");
+    }
+    DynamicQubitState state = kernels::productState(circuit.getInitialStates());
+    const kernels::BitLayout layout(circuit.getQubitsCount());
+
+    circuit.forEachGate([&](const GateRecord &gate, const GateOperands &operands) {
+        kernels::applyGate(state, gate, operands, layout);
+    });
+
+    return Solution(std::move(state));
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+
+#include "CircuitOptimizer.hpp"
+#include "DependencyGraph.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    enum class Combination {
+        None,
+        Cancel,
+        Merge
+    };
+
+    bool sameQubitPair(const GateRecord &first, const GateRecord &second, bool symmetric) {
+        if (first.target == second.target && first.control == second.control) {
+            return true;
+        }
+
+        return symmetric && first.target == second.control && first.control == second.target;
+    }
+
+    bool shareQubits(const GateRecord &first, const GateRecord &second, const GateOperands &operands) {
+        bool shared = false;
+        forEachGateQubit(first, operands, [&](uint32_t qubit) {
+            forEachGateQubit(second, operands, [&](uint32_t other) { shared = shared || other == qubit; });
+        });
+
+        return shared;
+    }
+
+    std::vector<uint32_t> sortedControls(const GateRecord &gate, const GateOperands &operands) {
+        const uint32_t *controls = operands.getControls(gate);
+        std::vector<uint32_t> result(controls, controls + operands.getControlsCount(gate));
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // multi-controlled gates of the same kind on the same qubits, controls may be listed in any order
+    bool sameControlledQubits(const GateRecord &first, const GateRecord &second, const GateOperands &operands) {
+        uint32_t firstSecond = operands.getSecondTarget(first), secondSecond = operands.getSecondTarget(second);
+        bool sameTargets = (first.target == second.target && firstSecond == secondSecond) ||
+            (first.kind == GateKind::MCSwap && first.target == secondSecond && firstSecond == second.target);
+
+        return sameTargets && sortedControls(first, operands) == sortedControls(second, operands);
+    }
+
+    Combination combine(const GateRecord &first, const GateRecord &second, const GateOperands &operands, GateRecord &merged) {
+        if (first.kind != second.kind) {
+            return Combination::None;
+        }
+
+        switch (first.kind) {
+            case GateKind::Hadamard:
+            case GateKind::X:
+            case GateKind::Y:
+            case GateKind::Z:
+                return first.target == second.target ? Combination::Cancel : Combination::None;
+            case GateKind::S:
+                if (first.target != second.target) {
+                    return Combination::None;
+                }
+                merged = GateRecord(GateKind::Z, first.target);
+                return Combination::Merge;
+            case GateKind::Cnot:
+                return sameQubitPair(first, second, false) ? Combination::Cancel : Combination::None;
+            case GateKind::Swap:
+            case GateKind::CZ:
+                return sameQubitPair(first, second, true) ? Combination::Cancel : Combination::None;
+            case GateKind::CPhase:
+                if (!sameQubitPair(first, second, true)) {
+                    return Combination::None;
+                }
+                merged = GateRecord(GateKind::CZ, first.target, first.control);
+                return Combination::Merge;
+            case GateKind::MCX:
+            case GateKind::MCZ:
+            case GateKind::MCSwap:
+                return sameControlledQubits(first, second, operands) ? Combination::Cancel : Combination::None;
+            default:
+                break;
+        }
+
+        return Combination::None;
+    }
+} // namespace
+
+OptimizationReport qce::operations::optimizeGates(std::vector<GateRecord> &gates, std::size_t lookahead) {
+    return optimizeGates(gates, GateOperands(), lookahead);
+}
+
+OptimizationReport qce::operations::optimizeGates(
+    std::vector<GateRecord> &gates,
+    const GateOperands &operands,
+    std::size_t lookahead
+) {
+    OptimizationReport report;
+    report.gatesBefore = gates.size();
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        report.passes++;
+        std::vector<bool> alive(gates.size(), true);
+
+        for (std::size_t i = 0; i < gates.size(); i++) {
+            if (!alive[i]) {
+                continue;
+            }
+
+            std::size_t inspected = 0;
+            for (std::size_t j = i + 1; j < gates.size() && inspected < lookahead; j++) {
+                if (!alive[j] || !shareQubits(gates[i], gates[j], operands)) {
+                    continue;
+                }
+                inspected++;
+
+                // gates in between commute with gates[i], so it can be moved right before gates[j]
+                GateRecord merged;
+                Combination combination = combine(gates[i], gates[j], operands, merged);
+                if (combination == Combination::Cancel) {
+                    alive[i] = alive[j] = false;
+                    report.cancelledPairs++;
+                    changed = true;
+                    break;
+                }
+                if (combination == Combination::Merge) {
+                    gates[j] = merged;
+                    alive[i] = false;
+                    report.mergedPairs++;
+                    changed = true;
+                    break;
+                }
+
+                if (!commutes(gates[i], gates[j], operands)) {
+                    break;
+                }
+            }
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < gates.size(); i++) {
+            if (alive[i]) {
+                gates[kept++] = gates[i];
+            }
+        }
+        gates.resize(kept);
+    }
+
+    report.gatesAfter = gates.size();
+    return report;
+}
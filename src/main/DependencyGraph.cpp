@@ -0,0 +1,162 @@
+#include <algorithm>
+
+#include "DependencyGraph.hpp"
+
+using namespace qce::operations;
+
+QubitAction qce::operations::qubitAction(const GateRecord &record, uint32_t qubit) {
+    switch (record.kind) {
+        case GateKind::X:
+            return QubitAction::XAxis;
+        case GateKind::Y:
+            return QubitAction::YAxis;
+        case GateKind::Z:
+        case GateKind::S:
+        case GateKind::CZ:
+        case GateKind::CPhase:
+            return QubitAction::Diagonal;
+        case GateKind::Cnot:
+            return qubit == record.control ? QubitAction::Diagonal : QubitAction::XAxis;
+        case GateKind::MCX:
+            return qubit == record.target ? QubitAction::XAxis : QubitAction::Diagonal;
+        case GateKind::MCZ:
+        case GateKind::MCPhase:
+        case GateKind::PhaseOracle:
+            return QubitAction::Diagonal;
+        case GateKind::MCU:
+            return qubit == record.target ? QubitAction::General : QubitAction::Diagonal;
+        default:
+            return QubitAction::General;
+    }
+}
+
+static bool sameGate(const GateRecord &first, const GateRecord &second) {
+    if (first == second) {
+        return true;
+    }
+
+    // symmetric two qubit gates
+    bool symmetric = first.kind == GateKind::Swap || first.kind == GateKind::CZ || first.kind == GateKind::CPhase;
+    return symmetric && first.kind == second.kind &&
+        first.target == second.control && first.control == second.target;
+}
+
+bool qce::operations::commutes(const GateRecord &first, const GateRecord &second) {
+    return commutes(first, second, GateOperands());
+}
+
+bool qce::operations::commutes(const GateRecord &first, const GateRecord &second, const GateOperands &operands) {
+    if (sameGate(first, second)) {
+        return true;
+    }
+
+    bool result = true;
+    forEachGateQubit(first, operands, [&](uint32_t qubit) {
+        bool shared = false;
+        forEachGateQubit(second, operands, [&](uint32_t other) { shared = shared || other == qubit; });
+        if (!shared) {
+            return;
+        }
+
+        QubitAction action = qubitAction(first, qubit);
+        result = result && action != QubitAction::General && action == qubitAction(second, qubit);
+    });
+
+    return result;
+}
+
+DependencyGraph::DependencyGraph(const std::vector<Node<GateRecord>> &nodes, std::size_t qubitCount):
+    DependencyGraph(nodes, GateOperands(), qubitCount) {}
+
+DependencyGraph::DependencyGraph(
+    const std::vector<Node<GateRecord>> &nodes,
+    const GateOperands &operands,
+    std::size_t qubitCount
+) {
+    gates.reserve(nodes.size());
+    linkOffsets.reserve(nodes.size() + 1);
+    layerOfGate.reserve(nodes.size());
+
+    // last gate on every qubit wire
+    std::vector<std::size_t> lastGate(qubitCount, NO_NODE_INDEX);
+
+    linkOffsets.push_back(0);
+    for (const Node<GateRecord> &node: nodes) {
+        const GateRecord &gate = node.getData();
+        std::size_t index = gates.size();
+        std::size_t layer = 0;
+
+        forEachGateQubit(gate, operands, [&](uint32_t qubit) {
+            std::size_t predecessor = lastGate[qubit];
+            if (predecessor != NO_NODE_INDEX) {
+                layer = std::max(layer, layerOfGate[predecessor] + 1);
+                for (std::size_t l = linkOffsets[predecessor]; l < linkOffsets[predecessor+1]; l++) {
+                    if (links[l].qubit == qubit) {
+                        links[l].successor = index;
+                    }
+                }
+            }
+
+            links.push_back(QubitLink{qubit, predecessor, NO_NODE_INDEX});
+            lastGate[qubit] = index;
+        });
+
+        gates.push_back(gate);
+        linkOffsets.push_back(links.size());
+        layerOfGate.push_back(layer);
+
+        if (layer == layers.size()) {
+            layers.emplace_back();
+        }
+        layers[layer].push_back(index);
+    }
+}
+
+std::vector<DependencyGraph::QubitLink> DependencyGraph::getLinks(std::size_t index) const {
+    return std::vector<QubitLink>(
+        links.begin() + (std::ptrdiff_t)linkOffsets[index],
+        links.begin() + (std::ptrdiff_t)linkOffsets[index+1]
+    );
+}
+
+std::vector<std::size_t> DependencyGraph::getPredecessors(std::size_t index) const {
+    std::vector<std::size_t> result;
+    for (std::size_t l = linkOffsets[index]; l < linkOffsets[index+1]; l++) {
+        std::size_t predecessor = links[l].predecessor;
+        if (predecessor != NO_NODE_INDEX && std::find(result.begin(), result.end(), predecessor) == result.end()) {
+            result.push_back(predecessor);
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::size_t> DependencyGraph::getSuccessors(std::size_t index) const {
+    std::vector<std::size_t> result;
+    for (std::size_t l = linkOffsets[index]; l < linkOffsets[index+1]; l++) {
+        std::size_t successor = links[l].successor;
+        if (successor != NO_NODE_INDEX && std::find(result.begin(), result.end(), successor) == result.end()) {
+            result.push_back(successor);
+        }
+    }
+
+    return result;
+}
+
+DepthStatistics DependencyGraph::getStatistics() const {
+    DepthStatistics statistics;
+    statistics.gateCount = gates.size();
+    statistics.depth = layers.size();
+
+    for (const GateRecord &gate: gates) {
+        if (!isSingleQubitGate(gate.kind)) {
+            statistics.multiQubitGateCount++;
+        }
+    }
+
+    for (const std::vector<std::size_t> &layer: layers) {
+        statistics.maxLayerWidth = std::max(statistics.maxLayerWidth, layer.size());
+    }
+
+    return statistics;
+}
@@ -0,0 +1,747 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "GateKernels.hpp"
+#include "QubitConsts.hpp"
+
+using namespace qce::operations;
+
+qce::kernels::BitLayout::BitLayout(std::size_t qubitCount): bits(qubitCount) {
+    for (std::size_t i = 0; i < qubitCount; i++) {
+        bits[i] = (uint32_t)(qubitCount - i - 1);
+    }
+}
+
+std::size_t qce::kernels::BitLayout::qubitAt(uint32_t bit) const {
+    for (std::size_t qubit = 0; qubit < bits.size(); qubit++) {
+        if (bits[qubit] == bit) {
+            return qubit;
+        }
+    }
+
+    throw std::out_of_range("Provided bit is not used by layout");
+}
+
+void qce::kernels::BitLayout::swapQubits(std::size_t first, std::size_t second) {
+    std::swap(bits[first], bits[second]);
+}
+
+std::vector<std::size_t> qce::kernels::BitLayout::getQubitOrder() const {
+    std::size_t n = bits.size();
+    std::vector<std::size_t> order(n);
+    for (std::size_t qubit = 0; qubit < n; qubit++) {
+        order[n - bits[qubit] - 1] = qubit;
+    }
+
+    return order;
+}
+
+qce::QubitMat_t qce::kernels::gateMatrix(GateKind kind) {
+    switch (kind) {
+        case GateKind::Hadamard: return qubitconsts::hadamard_gate;
+        case GateKind::X: return qubitconsts::pauli_x_gate;
+        case GateKind::Y: return qubitconsts::pauli_y_gate;
+        case GateKind::Z: return qubitconsts::pauli_z_gate;
+        case GateKind::S: return qubitconsts::phase_s_gate;
+        default:
+            throw std::invalid_argument("Provided gate kind is not a single qubit gate");
+    }
+}
+
+qce::DynamicQubitState qce::kernels::productState(const std::vector<QubitState> &states) {
+    if (states.size() >= 64) {
+        throw std::invalid_argument("State vector of 64 or more qubits can't be indexed");
+    }
+    DynamicQubitState result(uint64_t(1) << states.size());
+    result[0] = 1;
+
+    uint64_t filled = 1;
+    for (const QubitState &state: states) {
+        // every amplitude splits into pair, current qubit becomes the least significant bit
+        for (uint64_t i = filled; i-- > 0;) {
+            Amplitude_t amplitude = result[i];
+            result[2*i] = amplitude * state[0];
+            result[2*i + 1] = amplitude * state[1];
+        }
+        filled <<= 1;
+    }
+
+    return result;
+}
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    // [begin, end) of part-th of parts equal pieces of count iterations
+    uint64_t partBegin(uint64_t count, std::size_t part, std::size_t parts) {
+        return count / parts * part + std::min<uint64_t>(part, count % parts);
+    }
+
+    bool parity(uint64_t value) {
+        for (uint32_t shift = 32; shift > 0; shift >>= 1) {
+            value ^= value >> shift;
+        }
+        return (value & 1) != 0;
+    }
+
+    /**
+     * Offsets of values of group are walked in order of value without table of all 2^k offsets.
+     * Adding 1 to value clears its t trailing ones and sets the next bit, so offset is xored with
+     * flips[t], the bits of the t + 1 least significant bits of value. bits[0] is the most
+     * significant bit of value, or the least significant one if reversed.
+    */
+    std::vector<uint64_t> valueFlips(const std::vector<uint32_t> &bits, bool reversed = false) {
+        std::vector<uint64_t> flips(bits.size());
+        uint64_t flip = 0;
+        for (std::size_t t = 0; t < bits.size(); t++) {
+            flip |= uint64_t(1) << bits[reversed ? t : bits.size() - 1 - t];
+            flips[t] = flip;
+        }
+        return flips;
+    }
+
+    inline uint64_t nextOffset(uint64_t offset, uint64_t value, const std::vector<uint64_t> &flips) {
+        std::size_t t = 0;
+        while (((value >> t) & 1) == 0) {
+            t++;
+        }
+        return offset ^ flips[t];
+    }
+
+    /**
+     * Calls f(value, index) for every value of group at base in order of value.
+    */
+    template<typename F>
+    void forEachValue(uint64_t base, const std::vector<uint64_t> &flips, F f) {
+        const uint64_t n = uint64_t(1) << flips.size();
+        uint64_t index = base;
+        for (uint64_t value = 0; value < n; value++) {
+            if (value > 0) {
+                index = nextOffset(index, value, flips);
+            }
+            f(value, index);
+        }
+    }
+
+    /**
+     * Calls f(base) for groups [begin, end) of part, base is the index of group with all bits cleared.
+    */
+    template<typename F>
+    void forEachGroup(uint64_t size, const std::vector<uint32_t> &bits, std::size_t part, std::size_t parts, F f) {
+        if (bits.empty() || bits.size() > 63) {
+            throw std::invalid_argument("Register operation acts on 1 to 63 qubits");
+        }
+        std::vector<uint32_t> sortedBits(bits);
+        std::sort(sortedBits.begin(), sortedBits.end());
+
+        const uint64_t count = size >> bits.size();
+        const uint64_t end = partBegin(count, part + 1, parts);
+        for (uint64_t k = partBegin(count, part, parts); k < end; k++) {
+            uint64_t base = k;
+            for (uint32_t bit: sortedBits) {
+                base = qce::kernels::insertZeroBit(base, bit);
+            }
+            f(base);
+        }
+    }
+
+    /**
+     * In-place radix-2 FFT of group at base with e^(2 pi i jk/N) kernel (e^(-2 pi i jk/N) if inverse),
+     * normalized by 1/sqrt(N) like the Fourier transform of amplitudes. roots[j] is the j-th power of
+     * the N-th root. Butterflies run on amplitudes at strided indices of group, nothing is copied.
+    */
+    void fourierTransform(
+        Amplitude_t *amplitudes,
+        uint64_t base,
+        const std::vector<uint32_t> &bits,
+        const std::vector<uint64_t> &flips,
+        const std::vector<uint64_t> &reversedFlips,
+        const std::vector<Amplitude_t> &roots
+    ) {
+        const std::size_t k = bits.size();
+        const uint64_t n = uint64_t(1) << k;
+
+        // value and its bit reversal are walked together, every pair is swapped once
+        uint64_t reversedIndex = base;
+        forEachValue(base, flips, [&](uint64_t value, uint64_t index) {
+            if (value > 0) {
+                reversedIndex = nextOffset(reversedIndex, value, reversedFlips);
+            }
+            if (index < reversedIndex) {
+                std::swap(amplitudes[index], amplitudes[reversedIndex]);
+            }
+        });
+
+        for (std::size_t stage = 0; stage < k; stage++) {
+            const uint64_t half = uint64_t(1) << stage, step = n >> (stage + 1);
+            const uint64_t pairMask = uint64_t(1) << bits[k - 1 - stage];
+            forEachValue(base, flips, [&](uint64_t value, uint64_t index) {
+                if ((value & half) == 0) {
+                    Amplitude_t u = amplitudes[index], t = roots[(value & (half - 1)) * step] * amplitudes[index | pairMask];
+                    amplitudes[index] = u + t;
+                    amplitudes[index | pairMask] = u - t;
+                }
+            });
+        }
+
+        const double norm = 1 / std::sqrt((double)n);
+        forEachValue(base, flips, [&](uint64_t, uint64_t index) {
+            amplitudes[index] *= norm;
+        });
+    }
+
+    template<int K>
+    void applyUnitaryRange(
+        Amplitude_t *amplitudes,
+        const std::vector<uint32_t> &qubitBits,
+        const Amplitude_t *values,
+        uint64_t begin,
+        uint64_t end
+    ) {
+        constexpr int DIM = 1 << K;
+        typedef Eigen::Matrix<Amplitude_t, DIM, DIM, Eigen::RowMajor> Matrix_t;
+        typedef Eigen::Matrix<Amplitude_t, DIM, 1> Vector_t;
+        const Eigen::Map<const Matrix_t> matrix(values);
+
+        std::array<uint32_t, K> sortedBits;
+        std::copy(qubitBits.begin(), qubitBits.end(), sortedBits.begin());
+        std::sort(sortedBits.begin(), sortedBits.end());
+
+        // offsets[r] sets bits of gate qubits to row r of matrix
+        std::array<uint64_t, DIM> offsets;
+        for (int row = 0; row < DIM; row++) {
+            offsets[row] = 0;
+            for (int j = 0; j < K; j++) {
+                if ((row >> (K - 1 - j)) & 1) {
+                    offsets[row] |= uint64_t(1) << qubitBits[j];
+                }
+            }
+        }
+
+        Vector_t gathered;
+        for (uint64_t k = begin; k < end; k++) {
+            uint64_t base = k;
+            for (uint32_t bit: sortedBits) {
+                base = qce::kernels::insertZeroBit(base, bit);
+            }
+            for (int row = 0; row < DIM; row++) {
+                gathered[row] = amplitudes[base | offsets[row]];
+            }
+            const Vector_t result = matrix * gathered;
+            for (int row = 0; row < DIM; row++) {
+                amplitudes[base | offsets[row]] = result[row];
+            }
+        }
+    }
+
+    void applyMatrixRange(
+        Amplitude_t *amplitudes,
+        const qce::QubitMat_t &matrix,
+        uint32_t bit,
+        uint64_t begin,
+        uint64_t end
+    ) {
+        const uint64_t mask = uint64_t(1) << bit;
+        const Amplitude_t m00 = matrix(0, 0), m01 = matrix(0, 1), m10 = matrix(1, 0), m11 = matrix(1, 1);
+
+        for (uint64_t k = begin; k < end; k++) {
+            uint64_t i0 = qce::kernels::insertZeroBit(k, bit);
+            uint64_t i1 = i0 | mask;
+            Amplitude_t a0 = amplitudes[i0], a1 = amplitudes[i1];
+            amplitudes[i0] = m00 * a0 + m01 * a1;
+            amplitudes[i1] = m10 * a0 + m11 * a1;
+        }
+    }
+} // namespace
+
+void qce::kernels::applyMatrix(Amplitude_t *amplitudes, uint64_t size, const QubitMat_t &matrix, uint32_t bit) {
+    applyMatrixRange(amplitudes, matrix, bit, 0, size >> 1);
+}
+
+void qce::kernels::applyMatrixPart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const QubitMat_t &matrix,
+    uint32_t bit,
+    std::size_t part,
+    std::size_t parts
+) {
+    const uint64_t half = size >> 1;
+    applyMatrixRange(amplitudes, matrix, bit, partBegin(half, part, parts), partBegin(half, part + 1, parts));
+}
+
+void qce::kernels::applyGate(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    GateKind kind,
+    uint32_t targetBit,
+    uint32_t controlBit
+) {
+    applyGatePart(amplitudes, size, kind, targetBit, controlBit, 0, 1);
+}
+
+void qce::kernels::applyGatePart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    GateKind kind,
+    uint32_t targetBit,
+    uint32_t controlBit,
+    std::size_t part,
+    std::size_t parts
+) {
+    using namespace std::complex_literals;
+    const uint64_t targetMask = uint64_t(1) << targetBit;
+    const uint64_t half = size >> 1;
+    const uint64_t begin = partBegin(half, part, parts);
+    const uint64_t end = partBegin(half, part + 1, parts);
+
+    switch (kind) {
+        case GateKind::Hadamard:
+            applyMatrixRange(amplitudes, qubitconsts::hadamard_gate, targetBit, begin, end);
+            return;
+        case GateKind::X:
+            for (uint64_t k = begin; k < end; k++) {
+                uint64_t i0 = insertZeroBit(k, targetBit);
+                std::swap(amplitudes[i0], amplitudes[i0 | targetMask]);
+            }
+            return;
+        case GateKind::Y:
+            for (uint64_t k = begin; k < end; k++) {
+                uint64_t i0 = insertZeroBit(k, targetBit);
+                Amplitude_t a0 = amplitudes[i0];
+                amplitudes[i0] = -1i * amplitudes[i0 | targetMask];
+                amplitudes[i0 | targetMask] = 1i * a0;
+            }
+            return;
+        case GateKind::Z:
+            for (uint64_t k = begin; k < end; k++) {
+                amplitudes[insertZeroBit(k, targetBit) | targetMask] *= -1;
+            }
+            return;
+        case GateKind::S:
+            for (uint64_t k = begin; k < end; k++) {
+                amplitudes[insertZeroBit(k, targetBit) | targetMask] *= 1i;
+            }
+            return;
+        default:
+            break;
+    }
+
+    // two qubit gates iterate over quarter of amplitudes with both bits cleared
+    const uint64_t controlMask = uint64_t(1) << controlBit;
+    const uint32_t lowBit = std::min(targetBit, controlBit);
+    const uint32_t highBit = std::max(targetBit, controlBit);
+    const uint64_t quarter = size >> 2;
+    const uint64_t quarterBegin = partBegin(quarter, part, parts);
+    const uint64_t quarterEnd = partBegin(quarter, part + 1, parts);
+
+    switch (kind) {
+        case GateKind::Cnot:
+            for (uint64_t k = quarterBegin; k < quarterEnd; k++) {
+                uint64_t i = insertZeroBit(insertZeroBit(k, lowBit), highBit) | controlMask;
+                std::swap(amplitudes[i], amplitudes[i | targetMask]);
+            }
+            return;
+        case GateKind::Swap:
+            for (uint64_t k = quarterBegin; k < quarterEnd; k++) {
+                uint64_t i = insertZeroBit(insertZeroBit(k, lowBit), highBit);
+                std::swap(amplitudes[i | controlMask], amplitudes[i | targetMask]);
+            }
+            return;
+        case GateKind::CZ:
+            for (uint64_t k = quarterBegin; k < quarterEnd; k++) {
+                amplitudes[insertZeroBit(insertZeroBit(k, lowBit), highBit) | controlMask | targetMask] *= -1;
+            }
+            return;
+        case GateKind::CPhase:
+            for (uint64_t k = quarterBegin; k < quarterEnd; k++) {
+                amplitudes[insertZeroBit(insertZeroBit(k, lowBit), highBit) | controlMask | targetMask] *= 1i;
+            }
+            return;
+        default:
+            throw std::invalid_argument("Provided gate kind is not supported by kernels");
+    }
+}
+
+void qce::kernels::applyGate(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const GateRecord &record,
+    const BitLayout &layout
+) {
+    if (hasOperands(record.kind)) {
+        throw std::invalid_argument("Multi-controlled gate is applied with operands of its circuit");
+    }
+    uint32_t controlBit = record.hasControl() ? layout.bitOf(record.control) : 0;
+    applyGate(amplitudes, size, record.kind, layout.bitOf(record.target), controlBit);
+}
+
+void qce::kernels::applyGatePart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const GateRecord &record,
+    const BitLayout &layout,
+    std::size_t part,
+    std::size_t parts
+) {
+    if (hasOperands(record.kind)) {
+        throw std::invalid_argument("Multi-controlled gate is applied with operands of its circuit");
+    }
+    uint32_t controlBit = record.hasControl() ? layout.bitOf(record.control) : 0;
+    applyGatePart(amplitudes, size, record.kind, layout.bitOf(record.target), controlBit, part, parts);
+}
+
+void qce::kernels::applyGate(DynamicQubitState &state, const GateRecord &record, const BitLayout &layout) {
+    applyGate(state.data(), (uint64_t)state.size(), record, layout);
+}
+
+void qce::kernels::applyControlledGatePart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    GateKind kind,
+    uint32_t targetBit,
+    uint32_t secondBit,
+    const std::vector<uint32_t> &controlBits,
+    const Amplitude_t *values,
+    std::size_t part,
+    std::size_t parts
+) {
+    // k-th visited index is k with zero bits inserted at every gate bit, then controls are set
+    std::vector<uint32_t> gateBits(controlBits);
+    gateBits.push_back(targetBit);
+    if (kind == GateKind::MCSwap) {
+        gateBits.push_back(secondBit);
+    }
+    std::sort(gateBits.begin(), gateBits.end());
+
+    uint64_t controlMask = 0;
+    for (uint32_t bit: controlBits) {
+        controlMask |= uint64_t(1) << bit;
+    }
+    const uint64_t targetMask = uint64_t(1) << targetBit;
+    const uint64_t count = size >> gateBits.size();
+    const uint64_t begin = partBegin(count, part, parts);
+    const uint64_t end = partBegin(count, part + 1, parts);
+
+    auto indexOf = [&](uint64_t k) {
+        for (uint32_t bit: gateBits) {
+            k = insertZeroBit(k, bit);
+        }
+        return k | controlMask;
+    };
+
+    switch (kind) {
+        case GateKind::MCX:
+            for (uint64_t k = begin; k < end; k++) {
+                uint64_t i = indexOf(k);
+                std::swap(amplitudes[i], amplitudes[i | targetMask]);
+            }
+            return;
+        case GateKind::MCZ:
+            for (uint64_t k = begin; k < end; k++) {
+                amplitudes[indexOf(k) | targetMask] *= -1;
+            }
+            return;
+        case GateKind::MCPhase: {
+            const Amplitude_t phase = values[0];
+            for (uint64_t k = begin; k < end; k++) {
+                amplitudes[indexOf(k) | targetMask] *= phase;
+            }
+            return;
+        }
+        case GateKind::MCSwap: {
+            const uint64_t secondMask = uint64_t(1) << secondBit;
+            for (uint64_t k = begin; k < end; k++) {
+                uint64_t i = indexOf(k);
+                std::swap(amplitudes[i | targetMask], amplitudes[i | secondMask]);
+            }
+            return;
+        }
+        case GateKind::MCU: {
+            const Amplitude_t m00 = values[0], m01 = values[1], m10 = values[2], m11 = values[3];
+            for (uint64_t k = begin; k < end; k++) {
+                uint64_t i0 = indexOf(k);
+                uint64_t i1 = i0 | targetMask;
+                Amplitude_t a0 = amplitudes[i0], a1 = amplitudes[i1];
+                amplitudes[i0] = m00 * a0 + m01 * a1;
+                amplitudes[i1] = m10 * a0 + m11 * a1;
+            }
+            return;
+        }
+        default:
+            throw std::invalid_argument("Provided gate kind is not a multi-controlled gate");
+    }
+}
+
+void qce::kernels::applyUnitaryPart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const std::vector<uint32_t> &qubitBits,
+    const Amplitude_t *matrix,
+    std::size_t part,
+    std::size_t parts
+) {
+    const uint64_t count = size >> qubitBits.size();
+    const uint64_t begin = partBegin(count, part, parts);
+    const uint64_t end = partBegin(count, part + 1, parts);
+    switch (qubitBits.size()) {
+        case 1: applyUnitaryRange<1>(amplitudes, qubitBits, matrix, begin, end); return;
+        case 2: applyUnitaryRange<2>(amplitudes, qubitBits, matrix, begin, end); return;
+        case 3: applyUnitaryRange<3>(amplitudes, qubitBits, matrix, begin, end); return;
+        case 4: applyUnitaryRange<4>(amplitudes, qubitBits, matrix, begin, end); return;
+        case 5: applyUnitaryRange<5>(amplitudes, qubitBits, matrix, begin, end); return;
+        default:
+            throw std::invalid_argument("Unitary gate acts on 1 to 5 qubits");
+    }
+}
+
+void qce::kernels::applyFourierPart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const std::vector<uint32_t> &bits,
+    bool inverse,
+    std::size_t part,
+    std::size_t parts
+) {
+    const std::vector<uint64_t> flips = valueFlips(bits);
+    const std::vector<uint64_t> reversedFlips = valueFlips(bits, true);
+    const std::size_t n = std::size_t(1) << bits.size();
+    std::vector<Amplitude_t> roots(n / 2 + 1);
+    for (std::size_t j = 0; j < roots.size(); j++) {
+        roots[j] = std::polar(1., (inverse ? -2 : 2) * M_PI * (double)j / (double)n);
+    }
+
+    forEachGroup(size, bits, part, parts, [&](uint64_t base) {
+        fourierTransform(amplitudes, base, bits, flips, reversedFlips, roots);
+    });
+}
+
+void qce::kernels::applyDiffusionPart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const std::vector<uint32_t> &bits,
+    std::size_t part,
+    std::size_t parts
+) {
+    const std::vector<uint64_t> flips = valueFlips(bits);
+    const double n = std::ldexp(1., (int)bits.size());
+    forEachGroup(size, bits, part, parts, [&](uint64_t base) {
+        Amplitude_t sum = 0;
+        forEachValue(base, flips, [&](uint64_t, uint64_t index) {
+            sum += amplitudes[index];
+        });
+        const Amplitude_t doubledMean = 2. * sum / n;
+        forEachValue(base, flips, [&](uint64_t, uint64_t index) {
+            amplitudes[index] = doubledMean - amplitudes[index];
+        });
+    });
+}
+
+void qce::kernels::applyPhaseTablePart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const std::vector<uint32_t> &bits,
+    const Amplitude_t *phases,
+    std::size_t part,
+    std::size_t parts
+) {
+    const std::vector<uint64_t> flips = valueFlips(bits);
+    forEachGroup(size, bits, part, parts, [&](uint64_t base) {
+        forEachValue(base, flips, [&](uint64_t value, uint64_t index) {
+            amplitudes[index] *= phases[value];
+        });
+    });
+}
+
+qce::kernels::PauliMasks qce::kernels::pauliMasksOf(
+    const GateRecord &record,
+    const GateOperands &operands,
+    const BitLayout &layout
+) {
+    PauliMasks masks;
+    const Amplitude_t *values = operands.getValues(record);
+    const uint32_t *rest = operands.getControls(record);
+    for (std::size_t j = 0; j <= operands.getControlsCount(record); j++) {
+        PauliCode pauli = (PauliCode)(int)values[j + 1].real();
+        uint64_t bit = uint64_t(1) << layout.bitOf(j == 0 ? record.target : rest[j - 1]);
+        masks.xMask |= pauli == PauliCode::X || pauli == PauliCode::Y ? bit : 0;
+        masks.zMask |= pauli == PauliCode::Z || pauli == PauliCode::Y ? bit : 0;
+        masks.yCount += pauli == PauliCode::Y ? 1 : 0;
+    }
+    return masks;
+}
+
+void qce::kernels::applyPauliRotationPart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    uint64_t xMask,
+    uint64_t zMask,
+    std::size_t yCount,
+    double theta,
+    std::size_t part,
+    std::size_t parts
+) {
+    // P|x> = pauliPhase(x) |x ^ xMask>, so exp(-i theta P) = cos(theta) - i sin(theta) P
+    const Amplitude_t yPhases[4] = {1, Amplitude_t(0, 1), -1, Amplitude_t(0, -1)};
+    const Amplitude_t yPhase = yPhases[yCount % 4];
+    auto pauliPhase = [&](uint64_t index) {
+        return parity(index & zMask) ? -yPhase : yPhase;
+    };
+    const double cosine = std::cos(theta);
+    const Amplitude_t minusISine = Amplitude_t(0, -std::sin(theta));
+
+    if (xMask == 0) {
+        const uint64_t begin = partBegin(size, part, parts);
+        const uint64_t end = partBegin(size, part + 1, parts);
+        for (uint64_t i = begin; i < end; i++) {
+            amplitudes[i] *= cosine + minusISine * pauliPhase(i);
+        }
+        return;
+    }
+
+    // pairs are enumerated by indices with the highest bit of xMask cleared
+    uint32_t pivot = 0;
+    while ((xMask >> pivot) > 1) {
+        pivot++;
+    }
+    const uint64_t half = size >> 1;
+    const uint64_t begin = partBegin(half, part, parts);
+    const uint64_t end = partBegin(half, part + 1, parts);
+    for (uint64_t k = begin; k < end; k++) {
+        uint64_t i0 = insertZeroBit(k, pivot);
+        uint64_t i1 = i0 ^ xMask;
+        Amplitude_t a0 = amplitudes[i0], a1 = amplitudes[i1];
+        amplitudes[i0] = cosine * a0 + minusISine * pauliPhase(i1) * a1;
+        amplitudes[i1] = cosine * a1 + minusISine * pauliPhase(i0) * a0;
+    }
+}
+
+void qce::kernels::applyGate(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const GateRecord &record,
+    const GateOperands &operands,
+    const BitLayout &layout
+) {
+    applyGatePart(amplitudes, size, record, operands, layout, 0, 1);
+}
+
+void qce::kernels::applyGatePart(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const GateRecord &record,
+    const GateOperands &operands,
+    const BitLayout &layout,
+    std::size_t part,
+    std::size_t parts
+) {
+    if (!hasOperands(record.kind)) {
+        applyGatePart(amplitudes, size, record, layout, part, parts);
+        return;
+    }
+    if (!operands.hasEntry(record)) {
+        throw std::invalid_argument("Provided operands have no entry of multi-controlled gate");
+    }
+
+    std::vector<uint32_t> controlBits(operands.getControlsCount(record));
+    const uint32_t *controls = operands.getControls(record);
+    for (std::size_t i = 0; i < controlBits.size(); i++) {
+        controlBits[i] = layout.bitOf(controls[i]);
+    }
+    if (isRegisterGate(record.kind)) {
+        // the rest of qubits of register gate follow its target
+        std::vector<uint32_t> &registerBits = controlBits;
+        registerBits.insert(registerBits.begin(), layout.bitOf(record.target));
+        switch (record.kind) {
+            case GateKind::Unitary:
+                applyUnitaryPart(amplitudes, size, registerBits, operands.getValues(record), part, parts);
+                return;
+            case GateKind::QFT:
+            case GateKind::IQFT:
+                applyFourierPart(amplitudes, size, registerBits, record.kind == GateKind::IQFT, part, parts);
+                return;
+            case GateKind::GroverDiffusion:
+                applyDiffusionPart(amplitudes, size, registerBits, part, parts);
+                return;
+            case GateKind::PauliRotation: {
+                PauliMasks masks = pauliMasksOf(record, operands, layout);
+                double theta = operands.getValues(record)[0].real();
+                applyPauliRotationPart(amplitudes, size, masks.xMask, masks.zMask, masks.yCount, theta, part, parts);
+                return;
+            }
+            default:
+                applyPhaseTablePart(amplitudes, size, registerBits, operands.getValues(record), part, parts);
+                return;
+        }
+    }
+
+    uint32_t second = operands.getSecondTarget(record);
+    applyControlledGatePart(
+        amplitudes, size, record.kind, layout.bitOf(record.target),
+        second == NO_CONTROL_QUBIT ? 0 : layout.bitOf(second),
+        controlBits, operands.getValues(record), part, parts
+    );
+}
+
+void qce::kernels::applyGate(
+    DynamicQubitState &state,
+    const GateRecord &record,
+    const GateOperands &operands,
+    const BitLayout &layout
+) {
+    applyGate(state.data(), (uint64_t)state.size(), record, operands, layout);
+}
+
+void qce::kernels::swapBits(
+    Amplitude_t *amplitudes,
+    uint64_t size,
+    const std::vector<std::pair<uint32_t, uint32_t>> &bitPairs
+) {
+    if (bitPairs.empty()) {
+        return;
+    }
+
+    uint64_t pairsMask = 0;
+    for (const auto &bitPair: bitPairs) {
+        pairsMask |= (uint64_t(1) << bitPair.first) | (uint64_t(1) << bitPair.second);
+    }
+
+    for (uint64_t i = 0; i < size; i++) {
+        uint64_t j = i & ~pairsMask;
+        for (const auto &bitPair: bitPairs) {
+            j |= ((i >> bitPair.first) & 1) << bitPair.second;
+            j |= ((i >> bitPair.second) & 1) << bitPair.first;
+        }
+
+        if (j > i) {
+            std::swap(amplitudes[i], amplitudes[j]);
+        }
+    }
+}
+
+void qce::kernels::changeLayout(Amplitude_t *amplitudes, uint64_t size, BitLayout &from, const BitLayout &to) {
+    while (from != to) {
+        // every misplaced qubit is moved to its bit unless that bit is already taken in this sweep
+        std::vector<std::pair<uint32_t, uint32_t>> bitPairs;
+        uint64_t usedBits = 0;
+
+        for (std::size_t qubit = 0; qubit < from.getQubitsCount(); qubit++) {
+            uint32_t current = from.bitOf(qubit), wanted = to.bitOf(qubit);
+            uint64_t mask = (uint64_t(1) << current) | (uint64_t(1) << wanted);
+            if (current == wanted || (usedBits & mask) != 0) {
+                continue;
+            }
+
+            usedBits |= mask;
+            bitPairs.emplace_back(current, wanted);
+        }
+
+        swapBits(amplitudes, size, bitPairs);
+        for (const auto &bitPair: bitPairs) {
+            from.swapQubits(from.qubitAt(bitPair.first), from.qubitAt(bitPair.second));
+        }
+    }
+}
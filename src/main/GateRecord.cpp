@@ -0,0 +1,85 @@
+#include <cstring>
+
+#include "GateRecord.hpp"
+
+bool qce::operations::isSingleQubitGate(GateKind kind) {
+    switch (kind) {
+        case GateKind::Hadamard:
+        case GateKind::X:
+        case GateKind::Y:
+        case GateKind::Z:
+        case GateKind::S:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string qce::operations::gateName(GateKind kind) {
+    switch (kind) {
+        case GateKind::Hadamard: return "Hadamard gate";
+        case GateKind::X: return "X gate";
+        case GateKind::Y: return "Y gate";
+        case GateKind::Z: return "Z gate";
+        case GateKind::S: return "S gate";
+        case GateKind::Cnot: return "CNOT gate";
+        case GateKind::Swap: return "Swap gate";
+        case GateKind::CZ: return "CZ gate";
+        case GateKind::CPhase: return "CPhase gate";
+        case GateKind::MCX: return "Multi-controlled X gate";
+        case GateKind::MCZ: return "Multi-controlled Z gate";
+        case GateKind::MCPhase: return "Multi-controlled phase gate";
+        case GateKind::MCSwap: return "Multi-controlled swap gate";
+        case GateKind::MCU: return "Multi-controlled U gate";
+        case GateKind::Unitary: return "Unitary gate";
+        case GateKind::QFT: return "Quantum Fourier transform";
+        case GateKind::IQFT: return "Inverse quantum Fourier transform";
+        case GateKind::GroverDiffusion: return "Grover diffusion";
+        case GateKind::PhaseOracle: return "Phase oracle";
+        case GateKind::PauliRotation: return "Pauli rotation";
+    }
+
+    return "QubitOperation";
+}
+
+uint32_t qce::operations::GateOperands::add(
+    const std::vector<uint32_t> &controls,
+    uint32_t secondTarget,
+    const std::vector<std::complex<double>> &values
+) {
+    if (words.size() + controls.size() + 3 > UINT32_MAX) {
+        throw std::length_error("Gate operands don't fit into 32-bit offsets");
+    }
+
+    uint32_t offset = (uint32_t)words.size();
+    words.push_back((uint32_t)controls.size());
+    words.push_back(secondTarget);
+    words.push_back(values.empty() ? NO_OPERAND_VALUES : (uint32_t)this->values.size());
+    words.insert(words.end(), controls.begin(), controls.end());
+    this->values.insert(this->values.end(), values.begin(), values.end());
+    return offset;
+}
+
+void qce::operations::appendGateWords(std::vector<uint64_t> &words, const GateRecord &gate, const GateOperands &operands) {
+    words.push_back((uint64_t)gate.kind);
+    if (!hasOperands(gate.kind)) {
+        words.push_back(((uint64_t)gate.target << 32) | gate.control);
+        return;
+    }
+    if (!operands.hasEntry(gate)) {
+        throw std::invalid_argument("Provided operands have no entry of multi-controlled gate");
+    }
+
+    words.push_back(((uint64_t)gate.target << 32) | operands.getSecondTarget(gate));
+    words.push_back(operands.getControlsCount(gate));
+    const uint32_t *controls = operands.getControls(gate);
+    words.insert(words.end(), controls, controls + operands.getControlsCount(gate));
+
+    const std::complex<double> *values = operands.getValues(gate);
+    for (std::size_t i = 0; i < operandValuesCount(gate.kind, operands.getControlsCount(gate)); i++) {
+        double parts[2] = {values[i].real(), values[i].imag()};
+        uint64_t bits[2];
+        std::memcpy(bits, parts, sizeof(bits));
+        words.insert(words.end(), bits, bits + 2);
+    }
+}
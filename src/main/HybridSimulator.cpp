@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "HybridSimulator.hpp"
+#include "QubitConsts.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    /**
+     * One term of gate across cut: operators on qubits of the first and the second half.
+     * Empty operator is identity.
+    */
+    struct CutTerm {
+        const qce::QubitMat_t *first;
+        const qce::QubitMat_t *second;
+        double weight;
+    };
+
+    /**
+     * Gate of circuit as seen by halves: local gate of one half or index of cut gate.
+    */
+    struct Step {
+        bool isCut;
+        std::size_t half;
+        GateRecord local;
+        std::size_t cut;
+    };
+
+    /**
+     * Cut gate with its qubit in every half, as bit of half state.
+    */
+    struct CutGate {
+        uint32_t firstBit;
+        uint32_t secondBit;
+        std::vector<CutTerm> terms;
+    };
+
+    const qce::QubitMat_t PROJECTOR_0 = (qce::QubitMat_t() << 1, 0, 0, 0).finished();
+    const qce::QubitMat_t PROJECTOR_1 = (qce::QubitMat_t() << 0, 0, 0, 1).finished();
+
+    /**
+     * Terms of gate as (operator on control or first qubit, operator on target or second qubit).
+    */
+    std::vector<std::pair<const qce::QubitMat_t*, const qce::QubitMat_t*>> termsOf(GateKind kind) {
+        using namespace qce::qubitconsts;
+        switch (kind) {
+            case GateKind::Cnot: return {{&PROJECTOR_0, nullptr}, {&PROJECTOR_1, &pauli_x_gate}};
+            case GateKind::CZ: return {{&PROJECTOR_0, nullptr}, {&PROJECTOR_1, &pauli_z_gate}};
+            case GateKind::CPhase: return {{&PROJECTOR_0, nullptr}, {&PROJECTOR_1, &phase_s_gate}};
+            case GateKind::Swap: return {{nullptr, nullptr}, {&pauli_x_gate, &pauli_x_gate}, {&pauli_y_gate, &pauli_y_gate}, {&pauli_z_gate, &pauli_z_gate}};
+            default:
+                throw std::invalid_argument("Provided gate kind can't be cut");
+        }
+    }
+
+    void applyOperator(qce::DynamicQubitState &state, const qce::QubitMat_t *matrix, uint32_t bit) {
+        if (matrix != nullptr) {
+            qce::kernels::applyMatrix(state.data(), (uint64_t)state.size(), *matrix, bit);
+        }
+    }
+} // namespace
+
+qce::simulator::HybridSimulator::HybridSimulator(std::size_t threads, std::size_t cutQubit, uint64_t maxPaths):
+    threads{threads}, cutQubit{cutQubit}, maxPaths{maxPaths} {
+    if (this->threads == 0) {
+        this->threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+}
+
+std::vector<qce::kernels::Amplitude_t> qce::simulator::HybridSimulator::amplitudes(
+    const QubitEnv &env,
+    const std::vector<uint64_t> &basisStates
+) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to cut");
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const std::size_t n = initialStates.size();
+    if (n == 0 || n > 64) {
+        throw std::invalid_argument("Amplitudes can be queried for 1 to 64 qubits");
+    }
+
+    const std::size_t cut = cutQubit == 0 || cutQubit >= n ? std::max<std::size_t>(n / 2, 1) : cutQubit;
+    const std::size_t halfQubits[2] = {cut, n - cut};
+    for (uint64_t basisState: basisStates) {
+        if (n < 64 && basisState >> n != 0) {
+            throw std::invalid_argument("Provided basis state is out of register");
+        }
+    }
+
+    // qubit q of half h is stored at bit halfQubits[h] - 1 - (q - offset of h)
+    auto halfOf = [&](uint32_t qubit) { return qubit < cut ? std::size_t(0) : std::size_t(1); };
+    auto localOf = [&](uint32_t qubit) { return qubit < cut ? qubit : (uint32_t)(qubit - cut); };
+    auto bitOf = [&](uint32_t qubit) { return (uint32_t)(halfQubits[halfOf(qubit)] - 1 - localOf(qubit)); };
+
+    std::vector<Step> steps;
+    std::vector<CutGate> cutGates;
+    GateOperands localOperands;
+    std::size_t firstCutStep = nodes.size();
+    statistics = HybridStatistics();
+    statistics.paths = 1;
+    for (const Node<GateRecord> &node: nodes) {
+        const GateRecord &gate = node.getData();
+        if (hasOperands(gate.kind)) {
+            // multi-controlled gate is applied by its half with qubits remapped into local operands
+            const std::size_t half = halfOf(gate.target);
+            bool isLocal = true;
+            forEachGateQubit(gate, args.getOperands(), [&](uint32_t qubit) { isLocal = isLocal && halfOf(qubit) == half; });
+            if (!isLocal) {
+                throw std::invalid_argument("Gate with operands across cut can't be cut");
+            }
+
+            const GateOperands &operands = args.getOperands();
+            std::vector<uint32_t> controls(operands.getControls(gate), operands.getControls(gate) + operands.getControlsCount(gate));
+            for (uint32_t &control: controls) {
+                control = localOf(control);
+            }
+            uint32_t second = operands.getSecondTarget(gate);
+            const std::complex<double> *values = operands.getValues(gate);
+            uint32_t offset = localOperands.add(
+                controls,
+                second == NO_CONTROL_QUBIT ? NO_CONTROL_QUBIT : localOf(second),
+                std::vector<std::complex<double>>(values, values + operandValuesCount(gate.kind, controls.size()))
+            );
+            steps.push_back(Step{false, half, GateRecord(gate.kind, localOf(gate.target), offset), 0});
+            continue;
+        }
+        if (!gate.hasControl() || halfOf(gate.target) == halfOf(gate.control)) {
+            GateRecord local(gate.kind, localOf(gate.target), gate.hasControl() ? localOf(gate.control) : NO_CONTROL_QUBIT);
+            steps.push_back(Step{false, halfOf(gate.target), local, 0});
+            continue;
+        }
+
+        // first operator of term acts on control (or first qubit of swap)
+        CutGate cutGate;
+        const bool isControlFirst = halfOf(gate.control) == 0;
+        cutGate.firstBit = bitOf(isControlFirst ? gate.control : gate.target);
+        cutGate.secondBit = bitOf(isControlFirst ? gate.target : gate.control);
+        for (const auto &term: termsOf(gate.kind)) {
+            cutGate.terms.push_back(isControlFirst ?
+                CutTerm{term.first, term.second, 1.} : CutTerm{term.second, term.first, 1.});
+        }
+        if (gate.kind == GateKind::Swap) {
+            for (CutTerm &term: cutGate.terms) {
+                term.weight = 0.5;
+            }
+        }
+
+        if (statistics.paths > maxPaths / cutGate.terms.size()) {
+            throw std::invalid_argument("Circuit has too many paths across cut");
+        }
+        statistics.paths *= cutGate.terms.size();
+        firstCutStep = std::min(firstCutStep, steps.size());
+        steps.push_back(Step{true, 0, GateRecord(), cutGates.size()});
+        cutGates.push_back(std::move(cutGate));
+    }
+    statistics.cutGates = cutGates.size();
+
+    // gates before the first cut gate are shared by all paths
+    const kernels::BitLayout layouts[2] = {kernels::BitLayout(halfQubits[0]), kernels::BitLayout(halfQubits[1])};
+    DynamicQubitState prefix[2] = {
+        kernels::productState(std::vector<QubitState>(initialStates.begin(), initialStates.begin() + (std::ptrdiff_t)cut)),
+        kernels::productState(std::vector<QubitState>(initialStates.begin() + (std::ptrdiff_t)cut, initialStates.end()))
+    };
+    for (std::size_t i = 0; i < firstCutStep; i++) {
+        kernels::applyGate(prefix[steps[i].half], steps[i].local, localOperands, layouts[steps[i].half]);
+    }
+
+    const std::size_t workersCount = (std::size_t)std::min<uint64_t>(threads, statistics.paths);
+    std::vector<std::vector<Amplitude_t>> sums(workersCount, std::vector<Amplitude_t>(basisStates.size(), 0));
+    std::vector<std::exception_ptr> errors(workersCount);
+    const uint64_t secondMask = (uint64_t(1) << halfQubits[1]) - 1;
+
+    auto worker = [&](std::size_t part) {
+        try {
+            DynamicQubitState states[2];
+            for (uint64_t path = part; path < statistics.paths; path += workersCount) {
+                states[0] = prefix[0];
+                states[1] = prefix[1];
+                double weight = 1;
+
+                // path is mixed radix number, digit of cut gate picks its term
+                uint64_t digits = path;
+                for (std::size_t i = firstCutStep; i < steps.size(); i++) {
+                    const Step &step = steps[i];
+                    if (!step.isCut) {
+                        kernels::applyGate(states[step.half], step.local, localOperands, layouts[step.half]);
+                        continue;
+                    }
+
+                    const CutGate &cutGate = cutGates[step.cut];
+                    const CutTerm &term = cutGate.terms[digits % cutGate.terms.size()];
+                    digits /= cutGate.terms.size();
+                    applyOperator(states[0], term.first, cutGate.firstBit);
+                    applyOperator(states[1], term.second, cutGate.secondBit);
+                    weight *= term.weight;
+                }
+
+                for (std::size_t j = 0; j < basisStates.size(); j++) {
+                    uint64_t first = basisStates[j] >> halfQubits[1];
+                    uint64_t second = basisStates[j] & secondMask;
+                    sums[part][j] += weight * states[0][(Eigen::Index)first] * states[1][(Eigen::Index)second];
+                }
+            }
+        } catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t part = 1; part < workersCount; part++) {
+        workers.emplace_back(worker, part);
+    }
+    worker(0);
+    for (std::thread &thread: workers) {
+        thread.join();
+    }
+
+    for (const std::exception_ptr &error: errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::vector<Amplitude_t> result(basisStates.size(), 0);
+    for (const std::vector<Amplitude_t> &sum: sums) {
+        for (std::size_t j = 0; j < result.size(); j++) {
+            result[j] += sum[j];
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "InterleavedSimulator.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    // every helper works on rows of batch doubles starting at given offsets
+
+    void swapRows(double *real, double *imag, uint64_t first, uint64_t second, std::size_t batch) {
+        std::swap_ranges(real + first, real + first + batch, real + second);
+        std::swap_ranges(imag + first, imag + first + batch, imag + second);
+    }
+
+    void negateRow(double *real, double *imag, uint64_t row, std::size_t batch) {
+        double *re = real + row, *im = imag + row;
+        for (std::size_t b = 0; b < batch; b++) {
+            re[b] = -re[b];
+            im[b] = -im[b];
+        }
+    }
+
+    // multiplies row by i
+    void rotateRow(double *real, double *imag, uint64_t row, std::size_t batch) {
+        double *re = real + row, *im = imag + row;
+        for (std::size_t b = 0; b < batch; b++) {
+            double value = re[b];
+            re[b] = -im[b];
+            im[b] = value;
+        }
+    }
+
+    void matrixRows(
+        double *real,
+        double *imag,
+        uint64_t first,
+        uint64_t second,
+        std::size_t batch,
+        const qce::QubitMat_t &matrix
+    ) {
+        const double m00r = matrix(0, 0).real(), m00i = matrix(0, 0).imag();
+        const double m01r = matrix(0, 1).real(), m01i = matrix(0, 1).imag();
+        const double m10r = matrix(1, 0).real(), m10i = matrix(1, 0).imag();
+        const double m11r = matrix(1, 1).real(), m11i = matrix(1, 1).imag();
+        double *re0 = real + first, *im0 = imag + first;
+        double *re1 = real + second, *im1 = imag + second;
+
+        for (std::size_t b = 0; b < batch; b++) {
+            double a0r = re0[b], a0i = im0[b], a1r = re1[b], a1i = im1[b];
+            re0[b] = m00r * a0r - m00i * a0i + m01r * a1r - m01i * a1i;
+            im0[b] = m00r * a0i + m00i * a0r + m01r * a1i + m01i * a1r;
+            re1[b] = m10r * a0r - m10i * a0i + m11r * a1r - m11i * a1i;
+            im1[b] = m10r * a0i + m10i * a0r + m11r * a1i + m11i * a1r;
+        }
+    }
+
+    // multiplies element b of row by phase b
+    void phaseRow(double *real, double *imag, uint64_t row, std::size_t batch, const double *phaseRe, const double *phaseIm) {
+        double *re = real + row, *im = imag + row;
+        for (std::size_t b = 0; b < batch; b++) {
+            double value = re[b];
+            re[b] = phaseRe[b] * value - phaseIm[b] * im[b];
+            im[b] = phaseRe[b] * im[b] + phaseIm[b] * value;
+        }
+    }
+
+    // matrices holds component j of matrix of member b at j * batch + b, real and imaginary parts apart
+    void memberMatrixRows(
+        double *real,
+        double *imag,
+        uint64_t first,
+        uint64_t second,
+        std::size_t batch,
+        const double *matrixRe,
+        const double *matrixIm
+    ) {
+        const double *m00r = matrixRe, *m01r = matrixRe + batch, *m10r = matrixRe + 2 * batch, *m11r = matrixRe + 3 * batch;
+        const double *m00i = matrixIm, *m01i = matrixIm + batch, *m10i = matrixIm + 2 * batch, *m11i = matrixIm + 3 * batch;
+        double *re0 = real + first, *im0 = imag + first;
+        double *re1 = real + second, *im1 = imag + second;
+
+        for (std::size_t b = 0; b < batch; b++) {
+            double a0r = re0[b], a0i = im0[b], a1r = re1[b], a1i = im1[b];
+            re0[b] = m00r[b] * a0r - m00i[b] * a0i + m01r[b] * a1r - m01i[b] * a1i;
+            im0[b] = m00r[b] * a0i + m00i[b] * a0r + m01r[b] * a1i + m01i[b] * a1r;
+            re1[b] = m10r[b] * a0r - m10i[b] * a0i + m11r[b] * a1r - m11i[b] * a1i;
+            im1[b] = m10r[b] * a0i + m10i[b] * a0r + m11r[b] * a1i + m11i[b] * a1r;
+        }
+    }
+
+    /**
+     * Multi-controlled gate on whole rows, only rows with every control bit set are visited.
+     * Qubits are the same for every member, values of MCPhase and MCU are taken per member.
+    */
+    void applyControlledInterleaved(
+        double *real,
+        double *imag,
+        uint64_t size,
+        std::size_t batch,
+        const std::vector<GateRecord> &records,
+        const std::vector<const GateOperands*> &operands,
+        const qce::kernels::BitLayout &layout
+    ) {
+        const GateRecord &record = records.front();
+        const GateOperands &shape = *operands.front();
+        const uint32_t targetBit = layout.bitOf(record.target);
+        const uint64_t targetMask = uint64_t(1) << targetBit;
+        std::vector<uint32_t> gateBits{targetBit};
+        uint64_t controlMask = 0;
+        const uint32_t *controls = shape.getControls(record);
+        for (uint32_t i = 0; i < shape.getControlsCount(record); i++) {
+            gateBits.push_back(layout.bitOf(controls[i]));
+            controlMask |= uint64_t(1) << gateBits.back();
+        }
+        uint64_t secondMask = 0;
+        if (record.kind == GateKind::MCSwap) {
+            gateBits.push_back(layout.bitOf(shape.getSecondTarget(record)));
+            secondMask = uint64_t(1) << gateBits.back();
+        }
+        std::sort(gateBits.begin(), gateBits.end());
+
+        const std::size_t valuesCount = record.kind == GateKind::MCU ? 4 : record.kind == GateKind::MCPhase ? 1 : 0;
+        std::vector<double> valuesRe(valuesCount * batch), valuesIm(valuesCount * batch);
+        for (std::size_t b = 0; b < batch; b++) {
+            const std::complex<double> *values = operands[b]->getValues(records[b]);
+            for (std::size_t j = 0; j < valuesCount; j++) {
+                valuesRe[j * batch + b] = values[j].real();
+                valuesIm[j * batch + b] = values[j].imag();
+            }
+        }
+
+        for (uint64_t k = 0; k < size >> gateBits.size(); k++) {
+            uint64_t i = k;
+            for (uint32_t bit: gateBits) {
+                i = qce::kernels::insertZeroBit(i, bit);
+            }
+            i |= controlMask;
+
+            switch (record.kind) {
+                case GateKind::MCX: swapRows(real, imag, i * batch, (i | targetMask) * batch, batch); break;
+                case GateKind::MCZ: negateRow(real, imag, (i | targetMask) * batch, batch); break;
+                case GateKind::MCSwap: swapRows(real, imag, (i | targetMask) * batch, (i | secondMask) * batch, batch); break;
+                case GateKind::MCPhase:
+                    phaseRow(real, imag, (i | targetMask) * batch, batch, valuesRe.data(), valuesIm.data());
+                    break;
+                default:
+                    memberMatrixRows(real, imag, i * batch, (i | targetMask) * batch, batch, valuesRe.data(), valuesIm.data());
+                    break;
+            }
+        }
+    }
+
+    /**
+     * Returns true if gates act on the same qubits in the same way, values of operands may differ.
+    */
+    bool isSameShape(
+        const GateRecord &first,
+        const GateOperands &firstOperands,
+        const GateRecord &second,
+        const GateOperands &secondOperands
+    ) {
+        if (!hasOperands(first.kind) || first.kind != second.kind) {
+            return first == second;
+        }
+        if (first.target != second.target ||
+            firstOperands.getControlsCount(first) != secondOperands.getControlsCount(second) ||
+            firstOperands.getSecondTarget(first) != secondOperands.getSecondTarget(second)) {
+            return false;
+        }
+
+        return std::equal(
+            firstOperands.getControls(first),
+            firstOperands.getControls(first) + firstOperands.getControlsCount(first),
+            secondOperands.getControls(second)
+        );
+    }
+} // namespace
+
+void qce::kernels::applyGateInterleaved(
+    double *real,
+    double *imag,
+    uint64_t size,
+    std::size_t batch,
+    const GateRecord &record,
+    const BitLayout &layout
+) {
+    if (hasOperands(record.kind)) {
+        throw std::invalid_argument("Multi-controlled gate needs operands of every member of batch");
+    }
+
+    const uint32_t targetBit = layout.bitOf(record.target);
+    const uint64_t targetMask = uint64_t(1) << targetBit;
+
+    if (isSingleQubitGate(record.kind)) {
+        const QubitMat_t matrix = gateMatrix(record.kind);
+        for (uint64_t k = 0; k < size >> 1; k++) {
+            uint64_t i0 = insertZeroBit(k, targetBit);
+            uint64_t i1 = i0 | targetMask;
+            switch (record.kind) {
+                case GateKind::X: swapRows(real, imag, i0 * batch, i1 * batch, batch); break;
+                case GateKind::Z: negateRow(real, imag, i1 * batch, batch); break;
+                case GateKind::S: rotateRow(real, imag, i1 * batch, batch); break;
+                default: matrixRows(real, imag, i0 * batch, i1 * batch, batch, matrix); break;
+            }
+        }
+        return;
+    }
+
+    // two qubit gates iterate over quarter of rows with both bits cleared
+    const uint32_t controlBit = layout.bitOf(record.control);
+    const uint64_t controlMask = uint64_t(1) << controlBit;
+    const uint32_t lowBit = std::min(targetBit, controlBit);
+    const uint32_t highBit = std::max(targetBit, controlBit);
+
+    for (uint64_t k = 0; k < size >> 2; k++) {
+        uint64_t i = insertZeroBit(insertZeroBit(k, lowBit), highBit);
+        switch (record.kind) {
+            case GateKind::Cnot:
+                swapRows(real, imag, (i | controlMask) * batch, (i | controlMask | targetMask) * batch, batch);
+                break;
+            case GateKind::Swap:
+                swapRows(real, imag, (i | controlMask) * batch, (i | targetMask) * batch, batch);
+                break;
+            case GateKind::CZ:
+                negateRow(real, imag, (i | controlMask | targetMask) * batch, batch);
+                break;
+            case GateKind::CPhase:
+                rotateRow(real, imag, (i | controlMask | targetMask) * batch, batch);
+                break;
+            default:
+                throw std::invalid_argument("Provided gate kind is not supported by interleaved kernel");
+        }
+    }
+}
+
+void qce::kernels::applyGateInterleaved(
+    double *real,
+    double *imag,
+    uint64_t size,
+    std::size_t batch,
+    const std::vector<GateRecord> &records,
+    const std::vector<const GateOperands*> &operands,
+    const BitLayout &layout
+) {
+    if (records.size() != batch || operands.size() != batch) {
+        throw std::invalid_argument("Provided gates don't match batch");
+    }
+
+    const GateKind kind = records.front().kind;
+    if (!hasOperands(kind)) {
+        applyGateInterleaved(real, imag, size, batch, records.front(), layout);
+        return;
+    }
+    if (!isRegisterGate(kind)) {
+        applyControlledInterleaved(real, imag, size, batch, records, operands, layout);
+        return;
+    }
+
+    // register gates mix whole groups, every member is gathered and run by scalar kernel
+    std::vector<Amplitude_t> amplitudes(size);
+    for (std::size_t b = 0; b < batch; b++) {
+        for (uint64_t i = 0; i < size; i++) {
+            amplitudes[i] = Amplitude_t(real[i * batch + b], imag[i * batch + b]);
+        }
+        applyGate(amplitudes.data(), size, records[b], *operands[b], layout);
+        for (uint64_t i = 0; i < size; i++) {
+            real[i * batch + b] = amplitudes[i].real();
+            imag[i * batch + b] = amplitudes[i].imag();
+        }
+    }
+}
+
+qce::simulator::InterleavedState::InterleavedState(std::size_t qubitsCount, std::size_t batch):
+    qubitsCount{qubitsCount}, batch{batch},
+    real((uint64_t(1) << qubitsCount) * batch), imag((uint64_t(1) << qubitsCount) * batch) {}
+
+void qce::simulator::InterleavedState::setProductState(std::size_t member, const std::vector<QubitState> &states) {
+    if (states.size() != qubitsCount || member >= batch) {
+        throw std::invalid_argument("Provided states don't match interleaved state");
+    }
+
+    DynamicQubitState state = kernels::productState(states);
+    for (uint64_t i = 0; i < size(); i++) {
+        real[i * batch + member] = state[(Eigen::Index)i].real();
+        imag[i * batch + member] = state[(Eigen::Index)i].imag();
+    }
+}
+
+qce::DynamicQubitState qce::simulator::InterleavedState::extract(std::size_t member) const {
+    DynamicQubitState state(size());
+    for (uint64_t i = 0; i < size(); i++) {
+        state[(Eigen::Index)i] = amplitude(member, i);
+    }
+
+    return state;
+}
+
+qce::simulator::InterleavedSimulator::InterleavedSimulator(std::size_t batchWidth): batchWidth{batchWidth} {
+    if (batchWidth == 0) {
+        throw std::invalid_argument("Batch width must be positive");
+    }
+}
+
+qce::simulator::InterleavedState qce::simulator::InterleavedSimulator::run(
+    const QubitEnv &circuit,
+    const std::vector<std::vector<QubitState>> &initialStates
+) {
+    if (circuit.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to run");
+    }
+
+    qce::OperGraphState args = circuit.provideExecutionArgs();
+    const std::size_t n = args.getInitialStates().size();
+    const kernels::BitLayout layout(n);
+
+    InterleavedState state(n, initialStates.size());
+    for (std::size_t member = 0; member < initialStates.size(); member++) {
+        state.setProductState(member, initialStates[member]);
+    }
+    const std::vector<const GateOperands*> operands(state.getBatch(), &args.getOperands());
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        const std::vector<GateRecord> records(state.getBatch(), node.getData());
+        kernels::applyGateInterleaved(state.realData(), state.imagData(), state.size(), state.getBatch(), records, operands, layout);
+    }
+
+    return state;
+}
+
+std::vector<qce::simulator::Solution> qce::simulator::InterleavedSimulator::constructSolutions(const std::vector<QubitEnv> &envs) {
+    std::vector<Solution> solutions;
+    if (envs.empty()) {
+        return solutions;
+    }
+
+    std::vector<qce::OperGraphState> args;
+    args.reserve(envs.size());
+    for (const QubitEnv &env: envs) {
+        if (env.getExecutionMode() == ExecutionMode::Eager) {
+            throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to run");
+        }
+        args.push_back(env.provideExecutionArgs());
+    }
+
+    const std::vector<Node<GateRecord>> &nodes = args.front().getNodes();
+    for (const qce::OperGraphState &other: args) {
+        const std::vector<Node<GateRecord>> &otherNodes = other.getNodes();
+        bool isSame = other.getInitialStates().size() == args.front().getInitialStates().size() &&
+            otherNodes.size() == nodes.size();
+        for (std::size_t i = 0; isSame && i < nodes.size(); i++) {
+            isSame = isSameShape(otherNodes[i].getData(), other.getOperands(), nodes[i].getData(), args.front().getOperands());
+        }
+        if (!isSame) {
+            throw std::invalid_argument("Provided environments differ in gates");
+        }
+    }
+
+    const std::size_t n = args.front().getInitialStates().size();
+    const kernels::BitLayout layout(n);
+    solutions.reserve(envs.size());
+    for (std::size_t first = 0; first < envs.size(); first += batchWidth) {
+        const std::size_t width = std::min(batchWidth, envs.size() - first);
+        InterleavedState state(n, width);
+        std::vector<const GateOperands*> operands(width);
+        for (std::size_t member = 0; member < width; member++) {
+            state.setProductState(member, args[first + member].getInitialStates());
+            operands[member] = &args[first + member].getOperands();
+        }
+
+        // records of members differ only in offsets of their operands
+        std::vector<GateRecord> records(width);
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            for (std::size_t member = 0; member < width; member++) {
+                records[member] = args[first + member].getNodes()[i].getData();
+            }
+            kernels::applyGateInterleaved(state.realData(), state.imagData(), state.size(), width, records, operands, layout);
+        }
+
+        for (std::size_t member = 0; member < width; member++) {
+            solutions.emplace_back(state.extract(member));
+        }
+    }
+
+    return solutions;
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+namespace {
+    std::runtime_error mappingError(const std::string &message, const std::string &path) {
+        return std::runtime_error(message + " " + path + ": " + std::strerror(errno));
+    }
+
+    void* mapDescriptor(int descriptor, uint64_t length, bool writable, bool isPrivate = false) {
+        if (length == 0) {
+            return nullptr;
+        }
+
+        int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void *address = mmap(nullptr, length, protection, isPrivate ? MAP_PRIVATE : MAP_SHARED, descriptor, 0);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+} // namespace
+
+qce::utils::MappedFile::MappedFile(const std::string &path, MappingMode mode, uint64_t size):
+    writable{mode != MappingMode::ReadOnly}, isPrivate{mode == MappingMode::Private} {
+    int flags = mode == MappingMode::ReadOnly || mode == MappingMode::Private ? O_RDONLY : O_RDWR;
+    if (mode == MappingMode::Create) {
+        flags |= O_CREAT | O_TRUNC;
+    }
+
+    descriptor = open(path.c_str(), flags | O_CLOEXEC, 0644);
+    if (descriptor < 0) {
+        throw mappingError("Failed to open", path);
+    }
+
+    if (mode == MappingMode::Create) {
+        if (ftruncate(descriptor, (off_t)size) != 0) {
+            release();
+            throw mappingError("Failed to resize", path);
+        }
+        length = size;
+    } else {
+        struct stat info;
+        if (fstat(descriptor, &info) != 0) {
+            release();
+            throw mappingError("Failed to stat", path);
+        }
+        length = (uint64_t)info.st_size;
+    }
+
+    address = mapDescriptor(descriptor, length, writable, isPrivate);
+    if (length != 0 && address == nullptr) {
+        release();
+        throw mappingError("Failed to map", path);
+    }
+}
+
+qce::utils::MappedFile qce::utils::MappedFile::temporary(const std::string &directory, uint64_t size) {
+    std::string base = directory;
+    if (base.empty()) {
+        const char *environment = std::getenv("TMPDIR");
+        base = environment != nullptr && *environment != '\0' ? environment : "/tmp";
+    }
+
+    std::string pattern = base + "/qce-XXXXXX";
+    std::vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+
+    MappedFile result;
+    result.writable = true;
+    result.descriptor = mkstemp(path.data());
+    if (result.descriptor < 0) {
+        throw mappingError("Failed to create temporary file in", base);
+    }
+    unlink(path.data());
+
+    if (ftruncate(result.descriptor, (off_t)size) != 0) {
+        throw mappingError("Failed to resize", path.data());
+    }
+    result.length = size;
+
+    result.address = mapDescriptor(result.descriptor, size, true);
+    if (size != 0 && result.address == nullptr) {
+        throw mappingError("Failed to map", path.data());
+    }
+
+    return result;
+}
+
+void qce::utils::MappedFile::release() {
+    if (address != nullptr) {
+        munmap(address, length);
+        address = nullptr;
+    }
+    if (descriptor >= 0) {
+        close(descriptor);
+        descriptor = -1;
+    }
+    length = 0;
+}
+
+qce::utils::MappedFile::~MappedFile() {
+    release();
+}
+
+qce::utils::MappedFile::MappedFile(MappedFile &&other) noexcept:
+    descriptor{other.descriptor}, address{other.address}, length{other.length},
+    writable{other.writable}, isPrivate{other.isPrivate} {
+    other.descriptor = -1;
+    other.address = nullptr;
+    other.length = 0;
+}
+
+qce::utils::MappedFile& qce::utils::MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        release();
+        std::swap(descriptor, other.descriptor);
+        std::swap(address, other.address);
+        std::swap(length, other.length);
+        writable = other.writable;
+        isPrivate = other.isPrivate;
+    }
+
+    return *this;
+}
+
+void qce::utils::MappedFile::advise(uint64_t offset, uint64_t bytes, int advice) const {
+    if (address == nullptr || offset >= length) {
+        return;
+    }
+
+    const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t begin = offset / pageSize * pageSize;
+    uint64_t end = std::min(length, offset + bytes);
+    madvise(static_cast<char*>(address) + begin, end - begin, advice);
+}
+
+void qce::utils::MappedFile::sync(bool synchronous) const {
+    if (address == nullptr || !writable || isPrivate) {
+        return;
+    }
+
+    if (msync(address, length, synchronous ? MS_SYNC : MS_ASYNC) != 0) {
+        throw std::runtime_error(std::string("Failed to sync mapped file: ") + std::strerror(errno));
+    }
+}
@@ -4,16 +4,16 @@ qce::operations::OperationArgs::OperationArgs(): qstate{(DynamicQubitState(1) <<
 
 qce::operations::OperationArgs::OperationArgs(const DynamicQubitState &state): qstate{DynamicQubitState(state)} {}
 
-qce::operations::OperationArgs::OperationArgs(DynamicQubitState &&state): qstate{DynamicQubitState(state)} {}
+qce::operations::OperationArgs::OperationArgs(DynamicQubitState &&state): qstate{std::move(state)} {}
 
-qce::operations::OperationArgs::OperationArgs(const std::vector<unsigned> &qubitIndices):
-    qubitIndices{std::vector<unsigned>(qubitIndices)} {}
+qce::operations::OperationArgs::OperationArgs(const std::vector<std::size_t> &qubitIndices):
+    qubitIndices{std::vector<std::size_t>(qubitIndices)} {}
 
-qce::operations::OperationArgs::OperationArgs(const DynamicQubitState &state, const std::vector<unsigned> &qubitIndices):
+qce::operations::OperationArgs::OperationArgs(const DynamicQubitState &state, const std::vector<std::size_t> &qubitIndices):
     qstate{DynamicQubitState(state)},
-    qubitIndices{std::vector<unsigned>(qubitIndices)} {}
+    qubitIndices{std::vector<std::size_t>(qubitIndices)} {}
 
 
-qce::operations::OperationArgs::OperationArgs(DynamicQubitState &&state, std::vector<unsigned> &&qubitIndices):
-    qstate{DynamicQubitState(state)},
-    qubitIndices{std::vector<unsigned>(qubitIndices)} {}
\ No newline at end of file
+qce::operations::OperationArgs::OperationArgs(DynamicQubitState &&state, std::vector<std::size_t> &&qubitIndices):
+    qstate{std::move(state)},
+    qubitIndices{std::move(qubitIndices)} {}
\ No newline at end of file
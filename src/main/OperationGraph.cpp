@@ -1,3 +1,36 @@
 #include "OperationGraph.hpp"
 
 using namespace qce::operations;
+
+QubitOperationPtr_t qce::operations::makeGateOperation(const GateRecord &record, std::size_t qubitCount) {
+    if (hasOperands(record.kind)) {
+        // facades build dense matrices, multi-controlled gates are applied only by kernels
+        throw std::invalid_argument("Multi-controlled gate has no facade");
+    }
+
+    std::vector<std::size_t> order(qubitCount);
+    for (std::size_t i = 0; i < qubitCount; i++) {
+        order[i] = i;
+    }
+
+    std::vector<std::size_t> controls;
+    if (record.hasControl()) {
+        controls.push_back(record.control);
+    }
+
+    switch (record.kind) {
+        case GateKind::Hadamard: return std::make_shared<HadamardGate>(record.target, std::move(order));
+        case GateKind::X: return std::make_shared<XGate>(record.target, std::move(order));
+        case GateKind::Y: return std::make_shared<YGate>(record.target, std::move(order));
+        case GateKind::Z: return std::make_shared<ZGate>(record.target, std::move(order));
+        case GateKind::S: return std::make_shared<PhaseGate>(record.target, std::move(order));
+        case GateKind::Cnot: return std::make_shared<CnotGate>(controls, record.target, order);
+        case GateKind::Swap: return std::make_shared<SwapGate>(controls, record.target, order);
+        case GateKind::CZ: return std::make_shared<CZGate>(controls, record.target, order);
+        case GateKind::CPhase: return std::make_shared<CPhaseGate>(controls, record.target, order);
+        default:
+            break;
+    }
+
+    throw std::invalid_argument("Provided record of unknown gate kind");
+}
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cctype>
+#include <dirent.h>
+#include <exception>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+#include "ParallelSimulator.hpp"
+
+using namespace qce::operations;
+
+bool qce::simulator::ThreadBarrier::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (isCancelled) {
+        return false;
+    }
+    std::size_t currentGeneration = generation;
+
+    if (++waiting == threads) {
+        waiting = 0;
+        generation++;
+        condition.notify_all();
+        return true;
+    }
+
+    condition.wait(lock, [&]() { return generation != currentGeneration || isCancelled; });
+    return generation != currentGeneration;
+}
+
+void qce::simulator::ThreadBarrier::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    isCancelled = true;
+    condition.notify_all();
+}
+
+std::size_t qce::simulator::numaNodeOfCpu(std::size_t cpu) {
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *directory = opendir(path.c_str());
+    if (directory == nullptr) {
+        return 0;
+    }
+
+    std::size_t node = 0;
+    while (dirent *entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::isdigit((unsigned char)name[4])) {
+            node = std::stoul(name.substr(4));
+            break;
+        }
+    }
+
+    closedir(directory);
+    return node;
+}
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    std::size_t countNumaNodes() {
+        DIR *directory = opendir("/sys/devices/system/node");
+        if (directory == nullptr) {
+            return 1;
+        }
+
+        std::size_t count = 0;
+        while (dirent *entry = readdir(directory)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::isdigit((unsigned char)name[4])) {
+                count++;
+            }
+        }
+
+        closedir(directory);
+        return std::max<std::size_t>(count, 1);
+    }
+
+    std::vector<std::size_t> allowedCpus() {
+        std::vector<std::size_t> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (std::size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+
+        return cpus;
+    }
+
+    void pinCurrentThread(std::size_t cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    /**
+     * Checks nodes of sampled pages of amplitudes[begin, end) against node of current thread.
+    */
+    void samplePlacement(
+        const Amplitude_t *amplitudes,
+        uint64_t begin,
+        uint64_t end,
+        qce::simulator::PlacementStatistics &placement
+    ) {
+        const std::size_t SAMPLED_PAGES = 64;
+        if (begin >= end) {
+            return;
+        }
+
+        const uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t first = (uintptr_t)(amplitudes + begin) / pageSize;
+        uintptr_t last = ((uintptr_t)(amplitudes + end) - 1) / pageSize;
+        std::size_t count = std::min<std::size_t>(SAMPLED_PAGES, last - first + 1);
+
+        std::vector<void*> pages(count);
+        std::vector<int> status(count, -1);
+        for (std::size_t i = 0; i < count; i++) {
+            pages[i] = (void*)((first + (last - first) * i / std::max<std::size_t>(count - 1, 1)) * pageSize);
+        }
+
+        #ifdef SYS_move_pages
+            // with null nodes move_pages only reports node of every page
+            if (syscall(SYS_move_pages, 0, count, pages.data(), nullptr, status.data(), 0) != 0) {
+                std::fill(status.begin(), status.end(), -1);
+            }
+        #endif
+
+        int cpu = sched_getcpu();
+        int node = cpu < 0 ? -1 : (int)qce::simulator::numaNodeOfCpu((std::size_t)cpu);
+        for (int pageNode: status) {
+            if (pageNode < 0 || node < 0) {
+                placement.unknownPages++;
+            } else if (pageNode == node) {
+                placement.localPages++;
+            } else {
+                placement.remotePages++;
+            }
+        }
+    }
+} // namespace
+
+qce::simulator::ParallelSimulator::ParallelSimulator(std::size_t threads, bool pinThreads):
+    threads{threads}, pinThreads{pinThreads} {
+    if (this->threads == 0) {
+        this->threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    }
+}
+
+qce::simulator::Solution qce::simulator::ParallelSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const std::size_t n = initialStates.size();
+    const kernels::BitLayout layout(n);
+
+    // amplitudes are left untouched until workers initialize their own pieces
+    const uint64_t size = uint64_t(1) << n;
+    DynamicQubitState state(size);
+    Amplitude_t *amplitudes = state.data();
+
+    // amplitude i = high[i >> lowBits] * low[i & lowMask]
+    const std::size_t lowBits = std::min<std::size_t>(n, 10);
+    const DynamicQubitState low = kernels::productState(
+        std::vector<QubitState>(initialStates.end() - (std::ptrdiff_t)lowBits, initialStates.end())
+    );
+    const std::vector<QubitState> highStates(initialStates.begin(), initialStates.end() - (std::ptrdiff_t)lowBits);
+
+    const std::vector<std::size_t> cpus = allowedCpus();
+    std::vector<PlacementStatistics> workerPlacement(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    ThreadBarrier barrier(threads);
+
+    auto worker = [&](std::size_t part) {
+        try {
+            if (pinThreads && !cpus.empty()) {
+                pinCurrentThread(cpus[part % cpus.size()]);
+            }
+
+            uint64_t begin = size / threads * part + std::min<uint64_t>(part, size % threads);
+            uint64_t end = size / threads * (part + 1) + std::min<uint64_t>(part + 1, size % threads);
+            const uint64_t lowMask = (uint64_t(1) << lowBits) - 1;
+            Amplitude_t factor = 1;
+            for (uint64_t i = begin; i < end; i++) {
+                if (i == begin || (i & lowMask) == 0) {
+                    uint64_t high = i >> lowBits;
+                    factor = 1;
+                    for (std::size_t q = 0; q < highStates.size(); q++) {
+                        factor *= highStates[q][(high >> (highStates.size() - q - 1)) & 1];
+                    }
+                }
+                amplitudes[i] = factor * low[(Eigen::Index)(i & lowMask)];
+            }
+            samplePlacement(amplitudes, begin, end, workerPlacement[part]);
+            if (!barrier.wait()) {
+                return;
+            }
+
+            for (const Node<GateRecord> &node: nodes) {
+                kernels::applyGatePart(amplitudes, size, node.getData(), args.getOperands(), layout, part, threads);
+                if (!barrier.wait()) {
+                    return;
+                }
+            }
+        } catch (...) {
+            // the rest of workers would wait for this one at the next barrier forever
+            errors[part] = std::current_exception();
+            barrier.cancel();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    std::exception_ptr startError;
+    try {
+        for (std::size_t part = 0; part < threads; part++) {
+            workers.emplace_back(worker, part);
+        }
+    } catch (...) {
+        startError = std::current_exception();
+        barrier.cancel();
+    }
+    for (std::thread &thread: workers) {
+        thread.join();
+    }
+
+    if (startError) {
+        std::rethrow_exception(startError);
+    }
+
+    for (const std::exception_ptr &error: errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    placement = PlacementStatistics();
+    placement.numaNodes = countNumaNodes();
+    for (const PlacementStatistics &statistics: workerPlacement) {
+        placement.localPages += statistics.localPages;
+        placement.remotePages += statistics.remotePages;
+        placement.unknownPages += statistics.unknownPages;
+    }
+
+    return Solution(std::move(state));
+}
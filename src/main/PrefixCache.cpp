@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "PrefixCache.hpp"
+#include "MappedFile.hpp"
+
+using namespace qce::operations;
+
+qce::simulator::PrefixStateCache::PrefixStateCache(
+    std::size_t memoryBytes,
+    const std::string &spillDirectory,
+    std::size_t diskBytes
+): memoryBytes{memoryBytes}, spillDirectory{spillDirectory}, diskBytes{diskBytes} {}
+
+qce::simulator::PrefixStateCache::~PrefixStateCache() {
+    for (const SpilledEntry &entry: spilled) {
+        std::remove(entry.path.c_str());
+    }
+}
+
+void qce::simulator::PrefixStateCache::removeSpilled(std::list<SpilledEntry>::iterator entry) {
+    std::remove(entry->path.c_str());
+    usedDisk -= entry->bytes;
+    spilledIndex.erase(entry->key);
+    spilled.erase(entry);
+}
+
+void qce::simulator::PrefixStateCache::spill(Entry &&entry) {
+    const uint64_t bytes = (uint64_t)entry.state.size() * sizeof(kernels::Amplitude_t);
+    if (spillDirectory.empty() || bytes > diskBytes) {
+        return;
+    }
+
+    while (usedDisk + bytes > diskBytes) {
+        removeSpilled(std::prev(spilled.end()));
+    }
+
+    std::string path = spillDirectory + "/qce-prefix-" + std::to_string(getpid()) + "-" + std::to_string(entry.key) + ".state";
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(entry.state.data()), (std::streamsize)bytes);
+    file.close();
+    if (file.fail()) {
+        // cache is best effort, state which can't be written is dropped
+        std::remove(path.c_str());
+        return;
+    }
+
+    spilled.push_front(SpilledEntry{entry.key, bytes, path});
+    spilledIndex[entry.key] = spilled.begin();
+    usedDisk += bytes;
+    statistics.spills++;
+}
+
+bool qce::simulator::PrefixStateCache::lookup(uint64_t key, DynamicQubitState &state) {
+    auto found = index.find(key);
+    if (found != index.end()) {
+        entries.splice(entries.begin(), entries, found->second);
+        state = found->second->state;
+        statistics.memoryHits++;
+        return true;
+    }
+
+    auto foundSpilled = spilledIndex.find(key);
+    if (foundSpilled == spilledIndex.end()) {
+        statistics.misses++;
+        return false;
+    }
+
+    std::list<SpilledEntry>::iterator entry = foundSpilled->second;
+    try {
+        utils::MappedFile file(entry->path, utils::MappingMode::ReadOnly);
+        if (file.size() != entry->bytes) {
+            throw std::runtime_error("Spilled state " + entry->path + " is truncated");
+        }
+        state.resize((Eigen::Index)(entry->bytes / sizeof(kernels::Amplitude_t)));
+        std::copy(file.data(), file.data() + file.size(), reinterpret_cast<unsigned char*>(state.data()));
+    } catch (const std::runtime_error &) {
+        removeSpilled(entry);
+        statistics.misses++;
+        return false;
+    }
+
+    removeSpilled(entry);
+    statistics.diskHits++;
+    insert(key, state);
+    return true;
+}
+
+void qce::simulator::PrefixStateCache::insert(uint64_t key, const DynamicQubitState &state) {
+    if (contains(key)) {
+        return;
+    }
+
+    const std::size_t bytes = (std::size_t)state.size() * sizeof(kernels::Amplitude_t);
+    if (bytes > memoryBytes) {
+        spill(Entry{key, state});
+        return;
+    }
+
+    while (usedMemory + bytes > memoryBytes) {
+        Entry &last = entries.back();
+        usedMemory -= (std::size_t)last.state.size() * sizeof(kernels::Amplitude_t);
+        index.erase(last.key);
+        statistics.evictions++;
+        spill(std::move(last));
+        entries.pop_back();
+    }
+
+    entries.push_front(Entry{key, state});
+    index[key] = entries.begin();
+    usedMemory += bytes;
+}
+
+std::vector<uint64_t> qce::simulator::prefixKeysOf(
+    const std::vector<QubitState> &initialStates,
+    const std::vector<Node<GateRecord>> &gates,
+    const GateOperands &operands
+) {
+    std::vector<uint64_t> keys;
+    keys.reserve(gates.size() + 1);
+
+    std::vector<uint64_t> words;
+    utils::appendStateWords(words, initialStates);
+    keys.push_back(utils::hashBytes(words.data(), words.size() * sizeof(uint64_t)));
+    for (const Node<GateRecord> &node: gates) {
+        words.clear();
+        appendGateWords(words, node.getData(), operands);
+        keys.push_back(utils::hashBytes(words.data(), words.size() * sizeof(uint64_t), keys.back()));
+    }
+
+    return keys;
+}
+
+qce::simulator::PrefixCacheSimulator::PrefixCacheSimulator(
+    std::size_t memoryBytes,
+    std::size_t checkpointInterval,
+    const std::string &spillDirectory,
+    std::size_t diskBytes
+): checkpointInterval{checkpointInterval}, cache{memoryBytes, spillDirectory, diskBytes} {
+    if (checkpointInterval == 0) {
+        throw std::invalid_argument("Checkpoint interval must be positive");
+    }
+}
+
+qce::simulator::Solution qce::simulator::PrefixCacheSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const std::vector<uint64_t> keys = prefixKeysOf(initialStates, nodes, args.getOperands());
+    const kernels::BitLayout layout(initialStates.size());
+
+    // only checkpoints and the final state can be cached, so only they are looked up
+    DynamicQubitState state;
+    std::size_t position = 0;
+    for (std::size_t length = nodes.size(); length > 0; length = (length - 1) / checkpointInterval * checkpointInterval) {
+        if (cache.lookup(keys[length], state)) {
+            position = length;
+            break;
+        }
+    }
+    if (position == 0) {
+        state = kernels::productState(initialStates);
+    }
+    skippedGates += position;
+
+    for (; position < nodes.size(); position++) {
+        kernels::applyGate(state, nodes[position].getData(), args.getOperands(), layout);
+        if ((position + 1) % checkpointInterval == 0 || position + 1 == nodes.size()) {
+            cache.insert(keys[position + 1], state);
+        }
+    }
+
+    return Solution(std::move(state));
+}
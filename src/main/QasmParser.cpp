@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <sys/mman.h>
+
+#include "QasmParser.hpp"
+#include "MappedFile.hpp"
+
+using namespace qce::operations;
+
+void qce::qasm::QasmVisitor::toffoli(uint32_t firstControl, uint32_t secondControl, uint32_t target) {
+    gate(GateRecord(GateKind::Hadamard, target));
+    gate(GateRecord(GateKind::CPhase, target, secondControl));
+    gate(GateRecord(GateKind::Cnot, secondControl, firstControl));
+    gate(GateRecord(GateKind::CZ, target, secondControl));
+    gate(GateRecord(GateKind::CPhase, target, secondControl));
+    gate(GateRecord(GateKind::Cnot, secondControl, firstControl));
+    gate(GateRecord(GateKind::CPhase, target, firstControl));
+    gate(GateRecord(GateKind::Hadamard, target));
+}
+
+qce::qasm::QasmEnvBuilder::QasmEnvBuilder(bool streaming, std::size_t fusionWindow):
+    streaming{streaming}, fusionWindow{fusionWindow} {}
+
+void qce::qasm::QasmEnvBuilder::declareQubits(std::size_t count) {
+    env = std::make_unique<QubitEnv>(count, qubitconsts::zero_basis_state);
+    if (streaming) {
+        env->enableEagerExecution(fusionWindow);
+    }
+}
+
+void qce::qasm::QasmEnvBuilder::gate(const GateRecord &gate) {
+    switch (gate.kind) {
+        case GateKind::Hadamard: env->hadamard(gate.target); return;
+        case GateKind::X: env->x(gate.target); return;
+        case GateKind::Y: env->y(gate.target); return;
+        case GateKind::Z: env->z(gate.target); return;
+        case GateKind::S: env->s(gate.target); return;
+        case GateKind::Cnot: env->cnot(gate.target, gate.control); return;
+        case GateKind::Swap: env->swap(gate.target, gate.control); return;
+        case GateKind::CZ: env->cz(gate.target, gate.control); return;
+        case GateKind::CPhase: env->cs(gate.target, gate.control); return;
+        default:
+            throw std::invalid_argument("Provided gate kind is not supported by environment");
+    }
+}
+
+void qce::qasm::QasmEnvBuilder::toffoli(uint32_t firstControl, uint32_t secondControl, uint32_t target) {
+    env->toffoli(target, firstControl, secondControl);
+}
+
+void qce::qasm::QasmEnvBuilder::measure(std::size_t qubit, std::size_t bit) {
+    measurements.emplace_back(qubit, bit);
+}
+
+qce::QubitEnv& qce::qasm::QasmEnvBuilder::getEnv() {
+    if (env == nullptr) {
+        throw std::logic_error("Parsed program declared no qubits");
+    }
+
+    // the last gates of streamed program may still wait in fusion window
+    env->flush();
+    return *env;
+}
+
+namespace {
+    using qce::qasm::QasmError;
+    using qce::qasm::QasmVisitor;
+
+    enum class TokenKind {
+        Identifier,
+        Number,
+        String,
+        Symbol,
+        Arrow,
+        End
+    };
+
+    struct Token {
+        TokenKind kind;
+        std::string_view text;
+    };
+
+    /**
+     * Splits text into tokens which point into text. Token which touches end of non-final text
+     * may be cut, so End is returned instead of it.
+    */
+    class Tokenizer {
+        const char *position;
+        const char *end;
+        bool isFinal;
+        std::size_t line;
+
+        public:
+        Tokenizer(const char *begin, const char *end, bool isFinal, std::size_t line):
+            position{begin}, end{end}, isFinal{isFinal}, line{line} {}
+
+        const char* getPosition() const {
+            return position;
+        }
+
+        std::size_t getLine() const {
+            return line;
+        }
+
+        Token next() {
+            // whitespace and comments
+            while (position != end) {
+                if (*position == '\n') {
+                    line++;
+                    position++;
+                } else if (std::isspace((unsigned char)*position)) {
+                    position++;
+                } else if (*position == '/' && position + 1 != end && position[1] == '/') {
+                    const char *newline = static_cast<const char*>(std::memchr(position, '\n', (std::size_t)(end - position)));
+                    if (newline == nullptr && !isFinal) {
+                        return Token{TokenKind::End, {}};
+                    }
+                    position = newline == nullptr ? end : newline;
+                } else {
+                    break;
+                }
+            }
+
+            if (position == end || (!isFinal && position + 1 == end && *position == '/')) {
+                return Token{TokenKind::End, {}};
+            }
+
+            const char *begin = position;
+            TokenKind kind;
+            char first = *position;
+            if (std::isalpha((unsigned char)first) || first == '_') {
+                kind = TokenKind::Identifier;
+                while (position != end && (std::isalnum((unsigned char)*position) || *position == '_')) {
+                    position++;
+                }
+            } else if (std::isdigit((unsigned char)first)) {
+                kind = TokenKind::Number;
+                while (position != end && (std::isdigit((unsigned char)*position) || *position == '.')) {
+                    position++;
+                }
+            } else if (first == '"') {
+                kind = TokenKind::String;
+                const char *closing = static_cast<const char*>(std::memchr(position + 1, '"', (std::size_t)(end - position - 1)));
+                if (closing == nullptr) {
+                    if (!isFinal) {
+                        position = begin;
+                        return Token{TokenKind::End, {}};
+                    }
+                    throw QasmError("unterminated string", line);
+                }
+                position = closing + 1;
+                return Token{kind, std::string_view(begin + 1, (std::size_t)(closing - begin - 1))};
+            } else if (first == '-' && position + 1 != end && position[1] == '>') {
+                kind = TokenKind::Arrow;
+                position += 2;
+            } else {
+                kind = TokenKind::Symbol;
+                position++;
+            }
+
+            if (position == end && !isFinal) {
+                position = begin;
+                return Token{TokenKind::End, {}};
+            }
+
+            return Token{kind, std::string_view(begin, (std::size_t)(position - begin))};
+        }
+    };
+
+    // thrown when statement is cut by the end of non-final text
+    struct IncompleteStatement {};
+
+    struct Register {
+        std::string name;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    // register slice: one element or the whole register
+    struct Operand {
+        std::size_t offset;
+        std::size_t size;
+        bool isWhole;
+    };
+
+    class Parser {
+        QasmVisitor &visitor;
+        std::vector<Register> quantumRegisters, classicalRegisters;
+        std::size_t qubitsCount = 0;
+        std::size_t bitsCount = 0;
+        bool isDeclared = false;
+        std::size_t line = 1;
+
+        Token expect(Tokenizer &tokens, TokenKind kind, const char *symbol = nullptr) {
+            Token token = tokens.next();
+            if (token.kind == TokenKind::End) {
+                throw IncompleteStatement();
+            }
+            if (token.kind != kind || (symbol != nullptr && token.text != symbol)) {
+                throw QasmError("expected " + std::string(symbol != nullptr ? symbol : "token") +
+                    " near '" + std::string(token.text) + "'", tokens.getLine());
+            }
+
+            return token;
+        }
+
+        std::size_t expectNumber(Tokenizer &tokens) {
+            Token token = expect(tokens, TokenKind::Number);
+            std::size_t value = 0;
+            auto result = std::from_chars(token.text.data(), token.text.data() + token.text.size(), value);
+            if (result.ec != std::errc() || result.ptr != token.text.data() + token.text.size()) {
+                throw QasmError("expected integer near '" + std::string(token.text) + "'", tokens.getLine());
+            }
+
+            return value;
+        }
+
+        Operand expectOperand(Tokenizer &tokens, const std::vector<Register> &registers) {
+            Token name = expect(tokens, TokenKind::Identifier);
+            auto found = std::find_if(registers.begin(), registers.end(), [&](const Register &reg) {
+                return reg.name == name.text;
+            });
+            if (found == registers.end()) {
+                throw QasmError("unknown register '" + std::string(name.text) + "'", tokens.getLine());
+            }
+
+            Tokenizer lookahead = tokens;
+            Token bracket = lookahead.next();
+            if (bracket.kind == TokenKind::End) {
+                throw IncompleteStatement();
+            }
+            if (bracket.kind != TokenKind::Symbol || bracket.text != "[") {
+                return Operand{found->offset, found->size, true};
+            }
+
+            tokens = lookahead;
+            std::size_t index = expectNumber(tokens);
+            expect(tokens, TokenKind::Symbol, "]");
+            if (index >= found->size) {
+                throw QasmError("index " + std::to_string(index) + " is out of register '" + found->name + "'", tokens.getLine());
+            }
+
+            return Operand{found->offset + index, 1, false};
+        }
+
+        /**
+         * Operands separated by commas up to semicolon.
+        */
+        std::vector<Operand> expectOperands(Tokenizer &tokens) {
+            std::vector<Operand> operands;
+            while (true) {
+                operands.push_back(expectOperand(tokens, quantumRegisters));
+                Token separator = expect(tokens, TokenKind::Symbol);
+                if (separator.text == ";") {
+                    return operands;
+                }
+                if (separator.text != ",") {
+                    throw QasmError("expected , or ; near '" + std::string(separator.text) + "'", tokens.getLine());
+                }
+            }
+        }
+
+        /**
+         * Size of broadcast over operands, whole registers must be of the same size.
+        */
+        std::size_t broadcastSize(const std::vector<Operand> &operands, std::size_t statementLine) {
+            std::size_t size = 1;
+            for (const Operand &operand: operands) {
+                if (!operand.isWhole) {
+                    continue;
+                }
+                if (size != 1 && operand.size != size) {
+                    throw QasmError("registers of different sizes in one statement", statementLine);
+                }
+                size = operand.size;
+            }
+
+            return size;
+        }
+
+        void declare(std::size_t statementLine) {
+            if (isDeclared) {
+                return;
+            }
+            if (qubitsCount == 0) {
+                throw QasmError("gate before any qreg", statementLine);
+            }
+
+            visitor.declareQubits(qubitsCount);
+            isDeclared = true;
+        }
+
+        void parseRegister(Tokenizer &tokens, bool isQuantum, std::size_t statementLine) {
+            Token name = expect(tokens, TokenKind::Identifier);
+            expect(tokens, TokenKind::Symbol, "[");
+            std::size_t size = expectNumber(tokens);
+            expect(tokens, TokenKind::Symbol, "]");
+            expect(tokens, TokenKind::Symbol, ";");
+
+            std::vector<Register> &registers = isQuantum ? quantumRegisters : classicalRegisters;
+            std::size_t &count = isQuantum ? qubitsCount : bitsCount;
+            if (isQuantum && isDeclared) {
+                throw QasmError("qreg after the first gate is not supported", statementLine);
+            }
+            registers.push_back(Register{std::string(name.text), count, size});
+            count += size;
+        }
+
+        void parseGate(Tokenizer &tokens, std::string_view name, std::size_t statementLine) {
+            static const std::pair<const char*, GateKind> SINGLE_QUBIT_GATES[] = {
+                {"h", GateKind::Hadamard}, {"x", GateKind::X}, {"y", GateKind::Y}, {"z", GateKind::Z}, {"s", GateKind::S}
+            };
+
+            std::size_t arity = 0;
+            GateKind kind = GateKind::Hadamard;
+            for (const auto &single: SINGLE_QUBIT_GATES) {
+                if (name == single.first) {
+                    arity = 1;
+                    kind = single.second;
+                }
+            }
+            if (name == "cx" || name == "cz" || name == "swap") {
+                arity = 2;
+                kind = name == "cx" ? GateKind::Cnot : name == "cz" ? GateKind::CZ : GateKind::Swap;
+            } else if (name == "ccx") {
+                arity = 3;
+            }
+            if (arity == 0) {
+                throw QasmError("unsupported statement '" + std::string(name) + "'", statementLine);
+            }
+
+            std::vector<Operand> operands = expectOperands(tokens);
+            if (operands.size() != arity) {
+                throw QasmError("gate '" + std::string(name) + "' expects " + std::to_string(arity) + " operands", statementLine);
+            }
+
+            std::size_t size = broadcastSize(operands, statementLine);
+            declare(statementLine);
+            for (std::size_t i = 0; i < size; i++) {
+                std::vector<uint32_t> qubits;
+                for (const Operand &operand: operands) {
+                    uint32_t qubit = (uint32_t)(operand.offset + (operand.isWhole ? i : 0));
+                    if (std::find(qubits.begin(), qubits.end(), qubit) != qubits.end()) {
+                        throw QasmError("gate '" + std::string(name) + "' uses qubit twice", statementLine);
+                    }
+                    qubits.push_back(qubit);
+                }
+
+                if (arity == 1) {
+                    visitor.gate(GateRecord(kind, qubits[0]));
+                } else if (arity == 3) {
+                    visitor.toffoli(qubits[0], qubits[1], qubits[2]);
+                } else if (kind == GateKind::Swap) {
+                    visitor.gate(GateRecord(kind, qubits[0], qubits[1]));
+                } else {
+                    // cx and cz list control first
+                    visitor.gate(GateRecord(kind, qubits[1], qubits[0]));
+                }
+            }
+        }
+
+        void parseMeasure(Tokenizer &tokens, std::size_t statementLine) {
+            Operand qubits = expectOperand(tokens, quantumRegisters);
+            expect(tokens, TokenKind::Arrow);
+            Operand bits = expectOperand(tokens, classicalRegisters);
+            expect(tokens, TokenKind::Symbol, ";");
+
+            if (qubits.isWhole != bits.isWhole || qubits.size != bits.size) {
+                throw QasmError("measure of different sizes", statementLine);
+            }
+
+            declare(statementLine);
+            for (std::size_t i = 0; i < qubits.size; i++) {
+                visitor.measure(qubits.offset + i, bits.offset + i);
+            }
+        }
+
+        void parseStatement(Tokenizer &tokens, const Token &first, std::size_t statementLine) {
+            if (first.kind != TokenKind::Identifier) {
+                throw QasmError("unexpected '" + std::string(first.text) + "'", statementLine);
+            }
+
+            if (first.text == "OPENQASM") {
+                Token version = expect(tokens, TokenKind::Number);
+                expect(tokens, TokenKind::Symbol, ";");
+                if (version.text.substr(0, 1) != "2") {
+                    throw QasmError("unsupported version " + std::string(version.text), statementLine);
+                }
+            } else if (first.text == "include") {
+                Token file = expect(tokens, TokenKind::String);
+                expect(tokens, TokenKind::Symbol, ";");
+                if (file.text != "qelib1.inc") {
+                    throw QasmError("include of '" + std::string(file.text) + "' is not supported", statementLine);
+                }
+            } else if (first.text == "qreg" || first.text == "creg") {
+                parseRegister(tokens, first.text == "qreg", statementLine);
+            } else if (first.text == "barrier") {
+                expectOperands(tokens);
+            } else if (first.text == "measure") {
+                parseMeasure(tokens, statementLine);
+            } else {
+                parseGate(tokens, first.text, statementLine);
+            }
+        }
+
+        public:
+        Parser(QasmVisitor &visitor): visitor{visitor} {}
+
+        /**
+         * Parses complete statements of text and returns the beginning of the first incomplete one.
+         * Statement is complete once its semicolon is read, visitor is called only for complete
+         * statements, so incomplete one can be parsed again when more text is available.
+        */
+        const char* parse(const char *begin, const char *end, bool isFinal) {
+            const char *position = begin;
+            while (true) {
+                Tokenizer tokens(position, end, isFinal, line);
+                Token first = tokens.next();
+                if (first.kind == TokenKind::End) {
+                    if (!isFinal) {
+                        return position;
+                    }
+                    // program may declare qregs without any gate or measure
+                    if (qubitsCount > 0) {
+                        declare(tokens.getLine());
+                    }
+                    return end;
+                }
+
+                try {
+                    parseStatement(tokens, first, tokens.getLine());
+                } catch (const IncompleteStatement &) {
+                    if (isFinal) {
+                        throw QasmError("unexpected end of program", tokens.getLine());
+                    }
+                    return position;
+                }
+
+                position = tokens.getPosition();
+                line = tokens.getLine();
+            }
+        }
+    };
+} // namespace
+
+void qce::qasm::parseQasm(std::istream &input, QasmVisitor &visitor, std::size_t bufferBytes) {
+    Parser parser(visitor);
+    std::vector<char> buffer(std::max<std::size_t>(bufferBytes, 1));
+    std::size_t filled = 0;
+
+    while (true) {
+        input.read(buffer.data() + filled, (std::streamsize)(buffer.size() - filled));
+        filled += (std::size_t)input.gcount();
+        bool isFinal = !input;
+
+        const char *consumed = parser.parse(buffer.data(), buffer.data() + filled, isFinal);
+        if (isFinal) {
+            return;
+        }
+
+        // unfinished statement is moved to the front, buffer grows if statement doesn't fit
+        std::size_t rest = filled - (std::size_t)(consumed - buffer.data());
+        std::memmove(buffer.data(), consumed, rest);
+        filled = rest;
+        if (filled == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+}
+
+void qce::qasm::parseQasmFile(const std::string &path, QasmVisitor &visitor) {
+    utils::MappedFile file(path, utils::MappingMode::ReadOnly);
+    file.advise(0, file.size(), MADV_SEQUENTIAL);
+
+    Parser parser(visitor);
+    parser.parse(file.data(), file.data() + file.size(), true);
+}
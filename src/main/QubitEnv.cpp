@@ -1,11 +1,34 @@
 #include <algorithm>
+#include <complex>
 #include <memory>
+#include <optional>
+#include <stdexcept>
 
 #include "QubitEnv.hpp"
 #include "Exceptions.h"
 #include "QubitConsts.hpp"
 #include "OperationGraph.hpp"
 
+namespace {
+    // constants like hadamard_gate are single precision, so they are unitary up to ~1e-7
+    const double UNITARITY_PRECISION = 1e-6;
+
+    qce::operations::PauliCode pauliCodeOf(char pauli) {
+        switch (pauli) {
+            case 'I': return qce::operations::PauliCode::I;
+            case 'X': return qce::operations::PauliCode::X;
+            case 'Y': return qce::operations::PauliCode::Y;
+            case 'Z': return qce::operations::PauliCode::Z;
+            default:
+                throw std::invalid_argument(std::string("Provided Pauli string has unknown factor ") + pauli);
+        }
+    }
+
+    bool isDiagonalTerm(const qce::PauliTerm &term) {
+        return term.paulis.find_first_of("XY") == std::string::npos;
+    }
+} // namespace
+
 qce::QubitEnv::QubitEnv() {}
 
 qce::QubitEnv::QubitEnv(const std::vector<qce::Qubit>& qubits) {
@@ -14,6 +37,7 @@ qce::QubitEnv::QubitEnv(const std::vector<qce::Qubit>& qubits) {
     for (std::size_t i = 0; i < qubits.size(); i++) {
         graph.changeState(i, std::move(qubits[i].ketState()));
     }
+    invalidateComputedState();
 }
 
 qce::QubitEnv::QubitEnv(const Qubit& qubit) {
@@ -28,78 +52,488 @@ qce::OperGraphState qce::QubitEnv::provideExecutionArgs() const {
     return graph.compileState();
 }
 
-std::vector<std::size_t> GENERATE_INDICES_BASE(const qce::QubitOperationGraph &g) {
-    std::size_t cap = g.getQubitsCount();
-    std::vector<std::size_t> currentIndices(cap);
-    for (std::size_t i = 0; i < cap; i++) {
-        currentIndices[i] = i;
+void qce::QubitEnv::addGate(const operations::GateRecord &record) {
+    if (mode == ExecutionMode::Deferred) {
+        graph.add(record);
+        return;
+    }
+
+    pendingGates.push_back(record);
+    if (pendingGates.size() > fusionWindow) {
+        flushPendingGates();
+    }
+}
+
+void qce::QubitEnv::addGate(operations::GateKind kind, std::size_t targetQubitIndex, std::size_t controlQubitIndex) {
+    const bool hasControl = controlQubitIndex != NO_CONTROL_QUBIT;
+    if (targetQubitIndex >= getQubitCount() || (hasControl && controlQubitIndex >= getQubitCount())) {
+        throw std::invalid_argument("Provided qubits of " + operations::gateName(kind) + " are out of environment");
+    }
+    if (hasControl && targetQubitIndex == controlQubitIndex) {
+        throw std::invalid_argument("Provided qubits of " + operations::gateName(kind) + " are repeated");
+    }
+
+    addGate(operations::GateRecord(kind, (uint32_t)targetQubitIndex, (uint32_t)controlQubitIndex));
+}
+
+void qce::QubitEnv::flushPendingGates() {
+    // single qubit gates are accumulated per qubit until multiqubit gate touches that qubit
+    std::vector<QubitMat_t> fused;
+    std::vector<bool> hasFused;
+    if (fusionWindow > 0) {
+        fused.resize(getQubitCount());
+        hasFused.assign(getQubitCount(), false);
+    }
+
+    auto applyFused = [&](std::size_t qubit) {
+        if (hasFused[qubit]) {
+            kernels::applyMatrix(liveState.data(), (uint64_t)liveState.size(), fused[qubit], layout.bitOf(qubit));
+            hasFused[qubit] = false;
+        }
+    };
+
+    for (const operations::GateRecord &record: pendingGates) {
+        if (fusionWindow == 0) {
+            kernels::applyGate(liveState, record, pendingOperands, layout);
+            continue;
+        }
+
+        if (operations::isSingleQubitGate(record.kind)) {
+            QubitMat_t matrix = kernels::gateMatrix(record.kind);
+            fused[record.target] = hasFused[record.target] ? (matrix * fused[record.target]).eval() : matrix;
+            hasFused[record.target] = true;
+            continue;
+        }
+
+        operations::forEachGateQubit(record, pendingOperands, applyFused);
+        kernels::applyGate(liveState, record, pendingOperands, layout);
+    }
+
+    for (std::size_t qubit = 0; qubit < hasFused.size(); qubit++) {
+        applyFused(qubit);
+    }
+
+    pendingGates.clear();
+    pendingOperands.clear();
+}
+
+void qce::QubitEnv::enableEagerExecution(std::size_t fusionWindow) {
+    if (mode == ExecutionMode::Eager) {
+        flushPendingGates();
+        this->fusionWindow = fusionWindow;
+        return;
     }
 
-    return currentIndices;
+    OperGraphState compiled = graph.compileState();
+    layout = kernels::BitLayout(getQubitCount());
+    // gates applied by previous incremental computations are not applied again
+    if (hasComputedState) {
+        computeStateIncrementally();
+        liveState = std::move(computedState);
+        releaseComputedState();
+    } else {
+        liveState = computeState();
+    }
+
+    graph = QubitOperationGraph(compiled.getInitialStates());
+    mode = ExecutionMode::Eager;
+    this->fusionWindow = fusionWindow;
+    pendingGates.reserve(fusionWindow + 1);
+}
+
+qce::ExecutionMode qce::QubitEnv::getExecutionMode() const {
+    return mode;
 }
 
-#ifndef _INDICES_GENERATOR_
-    #define GENERATE_INDICES_FUNC GENERATE_INDICES_BASE
-#endif
+void qce::QubitEnv::flush() {
+    if (mode == ExecutionMode::Eager) {
+        flushPendingGates();
+    }
+}
+
+const qce::DynamicQubitState& qce::QubitEnv::getLiveState() const {
+    if (mode != ExecutionMode::Eager) {
+        throw std::logic_error("Live state is available only in eager execution mode");
+    }
+    if (!pendingGates.empty()) {
+        throw std::logic_error("Eager environment has buffered gates, flush() must apply them first");
+    }
+
+    return liveState;
+}
 
 void qce::QubitEnv::hadamard(std::size_t qubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    BaseOperationPtr_t hGate = std::make_shared<operations::HadamardGate>(qubitIndex, indices);
-    graph.add(hGate);
+    addGate(operations::GateKind::Hadamard, qubitIndex);
 }
 
 void qce::QubitEnv::x(std::size_t qubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    BaseOperationPtr_t xGate = std::make_shared<operations::XGate>(qubitIndex, indices);
-    graph.add(xGate);
+    addGate(operations::GateKind::X, qubitIndex);
 }
 
 void qce::QubitEnv::y(std::size_t qubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    BaseOperationPtr_t yGate = std::make_shared<operations::YGate>(qubitIndex, indices);
-    graph.add(yGate);
+    addGate(operations::GateKind::Y, qubitIndex);
 }
 
 void qce::QubitEnv::z(std::size_t qubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    BaseOperationPtr_t zGate = std::make_shared<operations::ZGate>(qubitIndex, indices);
-    graph.add(zGate);
+    addGate(operations::GateKind::Z, qubitIndex);
 }
 
 void qce::QubitEnv::s(std::size_t qubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    BaseOperationPtr_t sGate = std::make_shared<operations::PhaseGate>(qubitIndex, indices);
-    graph.add(sGate);
+    addGate(operations::GateKind::S, qubitIndex);
 }
 
 void qce::QubitEnv::cnot(std::size_t inverseQubitIndex, std::size_t controlQubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    std::vector<std::size_t> controls = {controlQubitIndex};
-    BaseOperationPtr_t cnotGate =
-        std::make_shared<operations::CnotGate>(controls, inverseQubitIndex, indices);
-    graph.add(cnotGate);
+    addGate(operations::GateKind::Cnot, inverseQubitIndex, controlQubitIndex);
 }
 
 void qce::QubitEnv::swap(std::size_t firstQubitIndex, std::size_t secondQubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    std::vector<std::size_t> controls = {secondQubitIndex};
-    BaseOperationPtr_t swapGate =
-        std::make_shared<operations::SwapGate>(controls, firstQubitIndex, indices);
-    graph.add(swapGate);
+    addGate(operations::GateKind::Swap, firstQubitIndex, secondQubitIndex);
 }
 
 void qce::QubitEnv::cz(std::size_t zQubitIndex, std::size_t controlQubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    std::vector<std::size_t> controls = {controlQubitIndex};
-    BaseOperationPtr_t czGate = std::make_shared<operations::CZGate>(controls, zQubitIndex, indices);
-    graph.add(czGate);
+    addGate(operations::GateKind::CZ, zQubitIndex, controlQubitIndex);
 }
 
 void qce::QubitEnv::cs(std::size_t qubitIndex, std::size_t controlQubitIndex) {
-    std::vector<std::size_t> indices = GENERATE_INDICES_FUNC(graph);
-    std::vector<std::size_t> controls = {controlQubitIndex};
-    BaseOperationPtr_t csGate = std::make_shared<operations::CPhaseGate>(controls, qubitIndex, indices);
-    graph.add(csGate);
+    addGate(operations::GateKind::CPhase, qubitIndex, controlQubitIndex);
+}
+
+void qce::QubitEnv::toffoli(std::size_t inverseQubitIndex, std::size_t firstControlIndex, std::size_t secondControlIndex) {
+    mcx(inverseQubitIndex, {firstControlIndex, secondControlIndex});
+}
+
+void qce::QubitEnv::cfredkin(std::size_t firstQubitIndex, std::size_t secondQubitIndex, std::size_t controlQubitIndex) {
+    mcswap(firstQubitIndex, secondQubitIndex, {controlQubitIndex});
+}
+
+void qce::QubitEnv::mcx(std::size_t inverseQubitIndex, const std::vector<std::size_t> &controlQubitIndices) {
+    addControlledGate(operations::GateKind::MCX, inverseQubitIndex, NO_CONTROL_QUBIT, controlQubitIndices);
+}
+
+void qce::QubitEnv::mcz(std::size_t zQubitIndex, const std::vector<std::size_t> &controlQubitIndices) {
+    addControlledGate(operations::GateKind::MCZ, zQubitIndex, NO_CONTROL_QUBIT, controlQubitIndices);
+}
+
+void qce::QubitEnv::mcphase(std::size_t qubitIndex, const std::vector<std::size_t> &controlQubitIndices, double angle) {
+    addControlledGate(operations::GateKind::MCPhase, qubitIndex, NO_CONTROL_QUBIT, controlQubitIndices, {std::polar(1., angle)});
+}
+
+void qce::QubitEnv::mcswap(
+    std::size_t firstQubitIndex,
+    std::size_t secondQubitIndex,
+    const std::vector<std::size_t> &controlQubitIndices
+) {
+    addControlledGate(operations::GateKind::MCSwap, firstQubitIndex, secondQubitIndex, controlQubitIndices);
+}
+
+void qce::QubitEnv::mcu(std::size_t qubitIndex, const std::vector<std::size_t> &controlQubitIndices, const QubitMat_t &matrix) {
+    addControlledGate(
+        operations::GateKind::MCU, qubitIndex, NO_CONTROL_QUBIT, controlQubitIndices,
+        {matrix(0, 0), matrix(0, 1), matrix(1, 0), matrix(1, 1)}
+    );
+}
+
+void qce::QubitEnv::unitary(const DynamicQubitMat_t &matrix, const std::vector<std::size_t> &qubitIndices, bool checkUnitarity) {
+    const std::size_t k = qubitIndices.size();
+    if (k == 0 || k > operations::MAX_UNITARY_QUBITS) {
+        throw std::invalid_argument("Unitary gate acts on 1 to 5 qubits");
+    }
+    const Eigen::Index dimension = Eigen::Index(1) << k;
+    if (matrix.rows() != dimension || matrix.cols() != dimension) {
+        throw std::invalid_argument("Provided matrix doesn't match qubits count of unitary gate");
+    }
+    if (checkUnitarity) {
+        DynamicQubitMat_t product = matrix.adjoint() * matrix - DynamicQubitMat_t::Identity(dimension, dimension);
+        if (product.cwiseAbs().maxCoeff() > UNITARITY_PRECISION) {
+            throw std::invalid_argument("Provided matrix isn't unitary");
+        }
+    }
+
+    std::vector<std::complex<double>> values;
+    values.reserve((std::size_t)(dimension * dimension));
+    for (Eigen::Index row = 0; row < dimension; row++) {
+        for (Eigen::Index column = 0; column < dimension; column++) {
+            values.push_back(matrix(row, column));
+        }
+    }
+    addRegisterGate(operations::GateKind::Unitary, qubitIndices, values);
+}
+
+void qce::QubitEnv::qft(const std::vector<std::size_t> &qubitIndices) {
+    addRegisterGate(operations::GateKind::QFT, qubitIndices);
+}
+
+void qce::QubitEnv::iqft(const std::vector<std::size_t> &qubitIndices) {
+    addRegisterGate(operations::GateKind::IQFT, qubitIndices);
+}
+
+void qce::QubitEnv::groverDiffusion(const std::vector<std::size_t> &qubitIndices) {
+    addRegisterGate(operations::GateKind::GroverDiffusion, qubitIndices);
+}
+
+void qce::QubitEnv::phaseOracle(const std::function<bool(uint64_t)> &predicate, const std::vector<std::size_t> &qubitIndices) {
+    if (qubitIndices.size() > operations::MAX_ORACLE_QUBITS) {
+        throw std::invalid_argument("Phase oracle acts on at most 24 qubits");
+    }
+
+    std::vector<std::complex<double>> phases(std::size_t(1) << qubitIndices.size());
+    for (std::size_t value = 0; value < phases.size(); value++) {
+        phases[value] = predicate(value) ? -1 : 1;
+    }
+    addRegisterGate(operations::GateKind::PhaseOracle, qubitIndices, phases);
+}
+
+void qce::QubitEnv::phaseOracle(const std::function<bool(uint64_t)> &predicate) {
+    std::vector<std::size_t> qubitIndices(getQubitCount());
+    for (std::size_t qubit = 0; qubit < qubitIndices.size(); qubit++) {
+        qubitIndices[qubit] = qubit;
+    }
+    phaseOracle(predicate, qubitIndices);
+}
+
+void qce::QubitEnv::pauliExp(const std::string &paulis, const std::vector<std::size_t> &qubitIndices, double theta) {
+    if (paulis.size() != qubitIndices.size()) {
+        throw std::invalid_argument("Provided Pauli string doesn't match qubits count");
+    }
+
+    std::vector<std::size_t> qubits;
+    std::vector<std::complex<double>> values = {theta};
+    for (std::size_t j = 0; j < paulis.size(); j++) {
+        operations::PauliCode pauli = pauliCodeOf(paulis[j]);
+        if (qubitIndices[j] >= getQubitCount()) {
+            throw std::invalid_argument("Provided qubits of Pauli rotation are out of environment");
+        }
+        if (pauli != operations::PauliCode::I) {
+            qubits.push_back(qubitIndices[j]);
+            values.push_back((double)pauli);
+        }
+    }
+
+    if (qubits.empty()) {
+        // exp(-i theta I) is global phase
+        std::complex<double> phase = std::polar(1., -theta);
+        addRegisterGate(operations::GateKind::PhaseOracle, {0}, {phase, phase});
+        return;
+    }
+    addRegisterGate(operations::GateKind::PauliRotation, qubits, values);
+}
+
+void qce::QubitEnv::trotterStep(const std::vector<PauliTerm> &hamiltonian, double time, TrotterOrder order) {
+    std::vector<const PauliTerm*> diagonalTerms;
+    std::vector<const PauliTerm*> otherTerms;
+    std::vector<std::size_t> diagonalQubits;
+    for (const PauliTerm &term: hamiltonian) {
+        if (term.paulis.size() != term.qubits.size()) {
+            throw std::invalid_argument("Provided Pauli string doesn't match qubits count");
+        }
+        for (std::size_t j = 0; j < term.paulis.size(); j++) {
+            pauliCodeOf(term.paulis[j]);
+            if (term.qubits[j] >= getQubitCount()) {
+                throw std::invalid_argument("Provided qubits of Pauli term are out of environment");
+            }
+        }
+
+        if (!isDiagonalTerm(term)) {
+            otherTerms.push_back(&term);
+            continue;
+        }
+        diagonalTerms.push_back(&term);
+        for (std::size_t j = 0; j < term.paulis.size(); j++) {
+            bool isNew = std::find(diagonalQubits.begin(), diagonalQubits.end(), term.qubits[j]) == diagonalQubits.end();
+            if (term.paulis[j] == 'Z' && isNew) {
+                diagonalQubits.push_back(term.qubits[j]);
+            }
+        }
+    }
+    if (diagonalQubits.empty() && !diagonalTerms.empty()) {
+        diagonalQubits.push_back(0);
+    }
+
+    // Z factors of diagonal term as bits of value of diagonal qubits, diagonalQubits[0] is the most significant
+    std::vector<uint64_t> diagonalMasks;
+    for (const PauliTerm *term: diagonalTerms) {
+        uint64_t mask = 0;
+        for (std::size_t j = 0; j < term->paulis.size(); j++) {
+            if (term->paulis[j] == 'Z') {
+                auto position = std::find(diagonalQubits.begin(), diagonalQubits.end(), term->qubits[j]) - diagonalQubits.begin();
+                mask ^= uint64_t(1) << (diagonalQubits.size() - 1 - (std::size_t)position);
+            }
+        }
+        diagonalMasks.push_back(mask);
+    }
+
+    // group 0 is all diagonal terms if there are any, then every other term is its own group
+    const std::size_t diagonalGroups = diagonalTerms.empty() ? 0 : 1;
+    const std::size_t groupsCount = diagonalGroups + otherTerms.size();
+    auto applyGroup = [&](std::size_t group, double duration) {
+        if (group >= diagonalGroups) {
+            const PauliTerm *term = otherTerms[group - diagonalGroups];
+            pauliExp(term->paulis, term->qubits, term->weight * duration);
+            return;
+        }
+        if (diagonalQubits.size() > operations::MAX_ORACLE_QUBITS) {
+            for (const PauliTerm *term: diagonalTerms) {
+                pauliExp(term->paulis, term->qubits, term->weight * duration);
+            }
+            return;
+        }
+
+        std::vector<std::complex<double>> phases(std::size_t(1) << diagonalQubits.size());
+        for (std::size_t value = 0; value < phases.size(); value++) {
+            double angle = 0;
+            for (std::size_t i = 0; i < diagonalTerms.size(); i++) {
+                bool isOdd = false;
+                for (uint64_t bits = value & diagonalMasks[i]; bits != 0; bits &= bits - 1) {
+                    isOdd = !isOdd;
+                }
+                angle += isOdd ? -diagonalTerms[i]->weight : diagonalTerms[i]->weight;
+            }
+            phases[value] = std::polar(1., -angle * duration);
+        }
+        addRegisterGate(operations::GateKind::PhaseOracle, diagonalQubits, phases);
+    };
+
+    if (order == TrotterOrder::First || groupsCount < 2) {
+        for (std::size_t group = 0; group < groupsCount; group++) {
+            applyGroup(group, time);
+        }
+        return;
+    }
+    for (std::size_t group = 0; group + 1 < groupsCount; group++) {
+        applyGroup(group, time / 2);
+    }
+    applyGroup(groupsCount - 1, time);
+    for (std::size_t group = groupsCount - 1; group-- > 0;) {
+        applyGroup(group, time / 2);
+    }
+}
+
+void qce::QubitEnv::addRegisterGate(
+    operations::GateKind kind,
+    const std::vector<std::size_t> &qubitIndices,
+    const std::vector<std::complex<double>> &values
+) {
+    if (qubitIndices.empty()) {
+        throw std::invalid_argument("Provided qubits of " + operations::gateName(kind) + " are empty");
+    }
+
+    std::vector<std::size_t> rest(qubitIndices.begin() + 1, qubitIndices.end());
+    addControlledGate(kind, qubitIndices[0], NO_CONTROL_QUBIT, rest, values);
+}
+
+void qce::QubitEnv::addControlledGate(
+    operations::GateKind kind,
+    std::size_t targetQubitIndex,
+    std::size_t secondQubitIndex,
+    const std::vector<std::size_t> &controlQubitIndices,
+    const std::vector<std::complex<double>> &values
+) {
+    std::vector<std::size_t> qubits(controlQubitIndices);
+    qubits.push_back(targetQubitIndex);
+    if (secondQubitIndex != NO_CONTROL_QUBIT) {
+        qubits.push_back(secondQubitIndex);
+    }
+    std::sort(qubits.begin(), qubits.end());
+    if (qubits.back() >= getQubitCount() || std::adjacent_find(qubits.begin(), qubits.end()) != qubits.end()) {
+        throw std::invalid_argument("Provided qubits of " + operations::gateName(kind) + " are out of environment or repeated");
+    }
+
+    std::vector<uint32_t> controls(controlQubitIndices.begin(), controlQubitIndices.end());
+    uint32_t offset = mode == ExecutionMode::Deferred ?
+        graph.addOperands(controls, (uint32_t)secondQubitIndex, values) :
+        pendingOperands.add(controls, (uint32_t)secondQubitIndex, values);
+    addGate(operations::GateRecord(kind, (uint32_t)targetQubitIndex, offset));
+}
+
+void qce::QubitEnv::invalidateComputedState() {
+    std::optional<std::size_t> unchangedPrefix = graph.takeUnchangedPrefix();
+    if (!unchangedPrefix || *unchangedPrefix < computedGates) {
+        releaseComputedState();
+    }
+}
+
+void qce::QubitEnv::releaseComputedState() {
+    computedState = DynamicQubitState();
+    computedGates = 0;
+    hasComputedState = false;
+}
+
+qce::DynamicQubitState qce::QubitEnv::computeState() const {
+    if (mode == ExecutionMode::Eager) {
+        return getLiveState();
+    }
+
+    OperGraphState compiled = graph.compileState();
+    const kernels::BitLayout natural(getQubitCount());
+    DynamicQubitState state = kernels::productState(compiled.getInitialStates());
+    for (const operations::Node<operations::GateRecord> &node: compiled.getNodes()) {
+        kernels::applyGate(state, node.getData(), compiled.getOperands(), natural);
+    }
+
+    return state;
+}
+
+const qce::DynamicQubitState& qce::QubitEnv::computeStateIncrementally() {
+    if (mode == ExecutionMode::Eager) {
+        flushPendingGates();
+        return getLiveState();
+    }
+
+    OperGraphState compiled = graph.compileState();
+    const kernels::BitLayout natural(getQubitCount());
+    if (!hasComputedState) {
+        computedState = kernels::productState(compiled.getInitialStates());
+        computedGates = 0;
+        hasComputedState = true;
+    }
+
+    const std::vector<operations::Node<operations::GateRecord>> &nodes = compiled.getNodes();
+    for (; computedGates < nodes.size(); computedGates++) {
+        kernels::applyGate(computedState, nodes[computedGates].getData(), compiled.getOperands(), natural);
+    }
+
+    return computedState;
+}
+
+void qce::QubitEnv::removeGate(std::size_t index) {
+    graph.remove(index);
+    invalidateComputedState();
+}
+
+void qce::QubitEnv::changeState(std::size_t qubitIndex, const QubitState &state) {
+    if (mode == ExecutionMode::Eager) {
+        throw std::logic_error("Initial state of eager environment is already applied");
+    }
+    if (qubitIndex >= getQubitCount()) {
+        throw std::invalid_argument("Provided qubit index is out of environment");
+    }
+
+    graph.changeState(qubitIndex, state);
+    invalidateComputedState();
+}
+
+qce::operations::OptimizationReport qce::QubitEnv::optimize(std::size_t lookahead) {
+    OperGraphState compiled = graph.compileState();
+    std::vector<operations::GateRecord> gates;
+    gates.reserve(compiled.getNodes().size());
+    for (const operations::Node<operations::GateRecord> &node: compiled.getNodes()) {
+        gates.push_back(node.getData());
+    }
+
+    operations::OptimizationReport report = operations::optimizeGates(gates, compiled.getOperands(), lookahead);
+    if (report.removedGates() == 0) {
+        return report;
+    }
+
+    std::vector<operations::Node<operations::GateRecord>> nodes(gates.begin(), gates.end());
+    graph.setNodes(std::move(nodes));
+    invalidateComputedState();
+    return report;
+}
+
+qce::operations::DependencyGraph qce::QubitEnv::getDependencyGraph() const {
+    OperGraphState compiled = graph.compileState();
+    return operations::DependencyGraph(compiled.getNodes(), compiled.getOperands(), getQubitCount());
 }
 
 std::size_t qce::QubitEnv::getQubitCount() const {
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "QubitRemapping.hpp"
+
+using namespace qce::operations;
+
+std::vector<std::pair<std::size_t, std::size_t>> qce::simulator::planRemap(
+    const std::vector<Node<GateRecord>> &nodes,
+    const GateOperands &operands,
+    std::size_t position,
+    const kernels::BitLayout &layout,
+    uint32_t localBits,
+    std::size_t lookahead
+) {
+    std::size_t n = layout.getQubitsCount();
+    const std::size_t NOT_USED = SIZE_MAX;
+
+    // distance to first use of every qubit in lookahead window
+    std::vector<std::size_t> firstUse(n, NOT_USED);
+    std::vector<std::size_t> hot;
+    std::size_t end = std::min(nodes.size(), position + lookahead);
+    for (std::size_t i = position; i < end; i++) {
+        forEachGateQubit(nodes[i].getData(), operands, [&](uint32_t qubit) {
+            if (firstUse[qubit] == NOT_USED) {
+                firstUse[qubit] = i - position;
+                hot.push_back(qubit);
+            }
+        });
+    }
+
+    // gate at position must fit entirely, the rest of window as much as possible
+    if (hot.size() > localBits) {
+        hot.resize(localBits);
+    }
+    std::vector<bool> isHot(n, false);
+    for (std::size_t qubit: hot) {
+        isHot[qubit] = true;
+    }
+
+    std::vector<std::size_t> evictable;
+    for (uint32_t bit = 0; bit < localBits; bit++) {
+        std::size_t qubit = layout.qubitAt(bit);
+        if (!isHot[qubit]) {
+            evictable.push_back(qubit);
+        }
+    }
+    // qubits used soonest are evicted last
+    std::sort(evictable.begin(), evictable.end(), [&](std::size_t a, std::size_t b) {
+        return firstUse[a] < firstUse[b];
+    });
+
+    std::vector<std::pair<std::size_t, std::size_t>> swaps;
+    for (std::size_t qubit: hot) {
+        if (layout.bitOf(qubit) < localBits) {
+            continue;
+        }
+
+        swaps.emplace_back(qubit, evictable.back());
+        evictable.pop_back();
+    }
+
+    return swaps;
+}
+
+qce::simulator::RemappingSimulator::RemappingSimulator(uint32_t localBits, std::size_t lookahead):
+    localBits{localBits}, lookahead{lookahead} {
+    if (localBits < 2) {
+        throw std::invalid_argument("Provided localBits can't hold two qubit gate");
+    }
+}
+
+qce::simulator::Solution qce::simulator::RemappingSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    statistics = RemapStatistics();
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    std::size_t n = args.getInitialStates().size();
+
+    DynamicQubitState state = kernels::productState(args.getInitialStates());
+    const kernels::BitLayout natural(n);
+    kernels::BitLayout layout = natural;
+
+    for (std::size_t position = 0; position < nodes.size(); position++) {
+        const GateRecord &gate = nodes[position].getData();
+
+        bool isLocal = true;
+        forEachGateQubit(gate, args.getOperands(), [&](uint32_t qubit) { isLocal = isLocal && layout.bitOf(qubit) < localBits; });
+
+        if (!isLocal) {
+            std::vector<std::pair<uint32_t, uint32_t>> bitPairs;
+            for (const auto &swap: planRemap(nodes, args.getOperands(), position, layout, localBits, lookahead)) {
+                bitPairs.emplace_back(layout.bitOf(swap.first), layout.bitOf(swap.second));
+                layout.swapQubits(swap.first, swap.second);
+            }
+
+            kernels::swapBits(state.data(), (uint64_t)state.size(), bitPairs);
+            statistics.remaps++;
+            statistics.movedQubits += bitPairs.size();
+        }
+
+        kernels::applyGate(state, gate, args.getOperands(), layout);
+    }
+
+    kernels::changeLayout(state.data(), (uint64_t)state.size(), layout, natural);
+    return Solution(std::move(state));
+}
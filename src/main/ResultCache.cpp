@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ResultCache.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    const char INDEX_MAGIC[8] = {'Q', 'C', 'E', 'I', 'N', 'D', 'X', '\0'};
+    const char RESULT_MAGIC[8] = {'Q', 'C', 'E', 'R', 'S', 'L', 'T', '\0'};
+    const char RESULT_SUFFIX[] = ".result";
+
+    bool hasSuffix(const std::string &name, const std::string &suffix) {
+        return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    /**
+     * Removes result files and unfinished writes left by previous index.
+    */
+    void removeResultFiles(const std::string &directory) {
+        DIR *entries = opendir(directory.c_str());
+        if (entries == nullptr) {
+            return;
+        }
+
+        while (dirent *entry = readdir(entries)) {
+            std::string name = entry->d_name;
+            if (hasSuffix(name, RESULT_SUFFIX) || hasSuffix(name, std::string(RESULT_SUFFIX) + ".tmp")) {
+                std::remove((directory + "/" + name).c_str());
+            }
+        }
+
+        closedir(entries);
+    }
+
+    void appendString(std::vector<uint64_t> &words, const std::string &value) {
+        words.push_back(value.size());
+        for (std::size_t offset = 0; offset < value.size(); offset += 8) {
+            uint64_t word = 0;
+            std::memcpy(&word, value.data() + offset, std::min<std::size_t>(8, value.size() - offset));
+            words.push_back(word);
+        }
+    }
+
+    /**
+     * Second hash of words for ResultKey, every word is mixed by splitmix64 finalizer, so it's
+     * unrelated to multiply and shift steps of hashBytes.
+    */
+    uint64_t checkOf(const std::vector<uint64_t> &words) {
+        uint64_t check = words.size();
+        for (uint64_t word: words) {
+            uint64_t z = (check ^ word) + 0x9e3779b97f4a7c15ull;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            check = z ^ (z >> 31);
+        }
+        return check;
+    }
+} // namespace
+
+qce::simulator::ResultKey qce::simulator::resultKeyOf(
+    const QubitEnv &env,
+    const std::string &backend,
+    const std::string &precision,
+    ResultKind kind,
+    uint64_t shots
+) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to hash");
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    std::vector<uint64_t> words;
+    words.reserve(2 + 4 * args.getInitialStates().size() + 2 * args.getNodes().size() + 8);
+
+    utils::appendStateWords(words, args.getInitialStates());
+
+    words.push_back(args.getNodes().size());
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        appendGateWords(words, node.getData(), args.getOperands());
+    }
+
+    appendString(words, backend);
+    appendString(words, precision);
+    words.push_back((uint64_t)kind);
+    words.push_back(shots);
+
+    uint64_t key = utils::hashBytes(words.data(), words.size() * sizeof(uint64_t));
+    return ResultKey{key == 0 ? 1 : key, checkOf(words)};
+}
+
+qce::simulator::ResultCache::ResultCache(const std::string &directory, uint64_t maxBytes, uint32_t slotsCount):
+    directory{directory}, maxBytes{maxBytes} {
+    uint32_t roundedSlots = 8;
+    while (roundedSlots < slotsCount && roundedSlots < (1u << 31)) {
+        roundedSlots <<= 1;
+    }
+
+    // lock lives on inode of index, recreating index truncates it in place and keeps lock
+    const std::string indexPath = directory + "/index";
+    lockDescriptor = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockDescriptor < 0) {
+        throw std::runtime_error("Unable to open index of result cache");
+    }
+    if (flock(lockDescriptor, LOCK_EX | LOCK_NB) != 0) {
+        const bool isHeld = errno == EWOULDBLOCK;
+        close(lockDescriptor);
+        throw std::runtime_error(isHeld ? "Result cache directory is used by another cache" : "Unable to lock index of result cache");
+    }
+
+    struct stat info;
+    bool isValid = false;
+    if (fstat(lockDescriptor, &info) == 0 && info.st_size > 0) {
+        try {
+            index = utils::MappedFile(indexPath, utils::MappingMode::ReadWrite);
+            header = reinterpret_cast<ResultIndexHeader*>(index.data());
+            isValid = index.size() >= sizeof(ResultIndexHeader) &&
+                std::memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == RESULT_CACHE_VERSION &&
+                header->slotsCount >= 8 && (header->slotsCount & (header->slotsCount - 1)) == 0 &&
+                index.size() == sizeof(ResultIndexHeader) + (uint64_t)header->slotsCount * sizeof(ResultIndexSlot);
+        } catch (const std::runtime_error &) {
+            isValid = false;
+        }
+    }
+
+    try {
+        if (!isValid) {
+            removeResultFiles(directory);
+            createIndex(indexPath, roundedSlots);
+        }
+    } catch (...) {
+        close(lockDescriptor);
+        throw;
+    }
+
+    header = reinterpret_cast<ResultIndexHeader*>(index.data());
+    slots = reinterpret_cast<ResultIndexSlot*>(index.data() + sizeof(ResultIndexHeader));
+}
+
+qce::simulator::ResultCache::~ResultCache() {
+    // index is unmapped before lock is released
+    index = utils::MappedFile();
+    close(lockDescriptor);
+}
+
+void qce::simulator::ResultCache::createIndex(const std::string &path, uint32_t slotsCount) {
+    index = utils::MappedFile(path, utils::MappingMode::Create,
+        sizeof(ResultIndexHeader) + (uint64_t)slotsCount * sizeof(ResultIndexSlot));
+
+    // new file is zero filled, so every slot is empty
+    header = reinterpret_cast<ResultIndexHeader*>(index.data());
+    std::memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+    header->version = RESULT_CACHE_VERSION;
+    header->slotsCount = slotsCount;
+}
+
+std::string qce::simulator::ResultCache::pathOf(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return directory + "/" + name + RESULT_SUFFIX;
+}
+
+qce::simulator::ResultIndexSlot* qce::simulator::ResultCache::find(uint64_t key) const {
+    const uint64_t mask = header->slotsCount - 1;
+    for (uint64_t i = key & mask; slots[i].key != 0; i = (i + 1) & mask) {
+        if (slots[i].key == key) {
+            return &slots[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void qce::simulator::ResultCache::erase(ResultIndexSlot *slot) {
+    std::remove(pathOf(slot->key).c_str());
+    header->entriesCount--;
+    header->usedBytes -= slot->bytes;
+
+    // backward shift deletion keeps probe sequences of following keys unbroken
+    const uint64_t mask = header->slotsCount - 1;
+    uint64_t hole = (uint64_t)(slot - slots);
+    uint64_t next = hole;
+    while (true) {
+        slots[hole] = ResultIndexSlot{0, 0, 0, 0};
+        uint64_t home;
+        do {
+            next = (next + 1) & mask;
+            if (slots[next].key == 0) {
+                return;
+            }
+            home = slots[next].key & mask;
+        } while (hole <= next ? (hole < home && home <= next) : (hole < home || home <= next));
+
+        slots[hole] = slots[next];
+        hole = next;
+    }
+}
+
+void qce::simulator::ResultCache::evictFor(uint64_t bytes) {
+    const uint64_t maxEntries = header->slotsCount / 4 * 3;
+    while (header->entriesCount > 0 && (header->usedBytes + bytes > maxBytes || header->entriesCount + 1 > maxEntries)) {
+        ResultIndexSlot *oldest = nullptr;
+        for (uint64_t i = 0; i < header->slotsCount; i++) {
+            if (slots[i].key != 0 && (oldest == nullptr || slots[i].lastUse < oldest->lastUse)) {
+                oldest = &slots[i];
+            }
+        }
+
+        erase(oldest);
+        statistics.evictions++;
+    }
+}
+
+void qce::simulator::ResultCache::store(const ResultKey &key, ResultKind kind, const void *data, uint64_t count, uint64_t itemBytes) {
+    if (key.key == 0) {
+        throw std::invalid_argument("Result key must not be zero");
+    }
+
+    if (ResultIndexSlot *slot = find(key.key)) {
+        if (slot->check == key.check) {
+            slot->lastUse = ++header->clock;
+            return;
+        }
+        // result of circuit with colliding key gives way to the newer one
+        erase(slot);
+    }
+
+    const uint64_t dataBytes = count * itemBytes;
+    const uint64_t bytes = sizeof(ResultFileHeader) + dataBytes;
+    if (bytes > maxBytes) {
+        return;
+    }
+    evictFor(bytes);
+
+    ResultFileHeader fileHeader{};
+    std::memcpy(fileHeader.magic, RESULT_MAGIC, sizeof(fileHeader.magic));
+    fileHeader.version = RESULT_CACHE_VERSION;
+    fileHeader.kind = kind;
+    fileHeader.key = key.key;
+    fileHeader.check = key.check;
+    fileHeader.count = count;
+    fileHeader.checksum = utils::hashBytes(data, dataBytes);
+
+    const std::string path = pathOf(key.key);
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(static_cast<const char*>(data), (std::streamsize)dataBytes);
+    file.close();
+    if (file.fail() || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        // full or read-only directory must not lose result which is already computed
+        std::remove(temporaryPath.c_str());
+        statistics.failedStores++;
+        return;
+    }
+
+    const uint64_t mask = header->slotsCount - 1;
+    uint64_t i = key.key & mask;
+    while (slots[i].key != 0) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = ResultIndexSlot{key.key, key.check, bytes, ++header->clock};
+    header->entriesCount++;
+    header->usedBytes += bytes;
+    statistics.stores++;
+}
+
+qce::utils::MappedFile qce::simulator::ResultCache::open(const ResultKey &key, ResultKind kind, uint64_t itemBytes, uint64_t &count) {
+    ResultIndexSlot *slot = find(key.key);
+    if (slot == nullptr || slot->check != key.check) {
+        statistics.misses++;
+        return utils::MappedFile();
+    }
+
+    utils::MappedFile file;
+    bool isValid = false;
+    try {
+        file = utils::MappedFile(pathOf(key.key), utils::MappingMode::ReadOnly);
+        ResultFileHeader fileHeader;
+        if (file.size() >= sizeof(fileHeader)) {
+            std::memcpy(&fileHeader, file.data(), sizeof(fileHeader));
+            isValid = std::memcmp(fileHeader.magic, RESULT_MAGIC, sizeof(fileHeader.magic)) == 0 &&
+                fileHeader.version == RESULT_CACHE_VERSION && fileHeader.kind == kind &&
+                fileHeader.key == key.key && fileHeader.check == key.check &&
+                file.size() - sizeof(fileHeader) == fileHeader.count * itemBytes &&
+                utils::hashBytes(file.data() + sizeof(fileHeader), file.size() - sizeof(fileHeader)) == fileHeader.checksum;
+            count = fileHeader.count;
+        }
+    } catch (const std::runtime_error &) {
+        isValid = false;
+    }
+
+    if (!isValid) {
+        erase(slot);
+        statistics.damaged++;
+        statistics.misses++;
+        return utils::MappedFile();
+    }
+
+    slot->lastUse = ++header->clock;
+    statistics.hits++;
+    return file;
+}
+
+bool qce::simulator::ResultCache::loadState(const ResultKey &key, DynamicQubitState &state) {
+    uint64_t count = 0;
+    utils::MappedFile file = open(key, ResultKind::State, sizeof(kernels::Amplitude_t), count);
+    if (file.size() == 0) {
+        return false;
+    }
+
+    state.resize((Eigen::Index)count);
+    std::memcpy(state.data(), file.data() + sizeof(ResultFileHeader), count * sizeof(kernels::Amplitude_t));
+    return true;
+}
+
+void qce::simulator::ResultCache::storeState(const ResultKey &key, const DynamicQubitState &state) {
+    store(key, ResultKind::State, state.data(), (uint64_t)state.size(), sizeof(kernels::Amplitude_t));
+}
+
+bool qce::simulator::ResultCache::loadHistogram(const ResultKey &key, Histogram &histogram) {
+    uint64_t count = 0;
+    utils::MappedFile file = open(key, ResultKind::Histogram, 2 * sizeof(uint64_t), count);
+    if (file.size() == 0) {
+        return false;
+    }
+
+    const char *data = file.data() + sizeof(ResultFileHeader);
+    histogram.resize(count);
+    for (uint64_t i = 0; i < count; i++) {
+        std::memcpy(&histogram[i].first, data + 16 * i, sizeof(uint64_t));
+        std::memcpy(&histogram[i].second, data + 16 * i + 8, sizeof(uint64_t));
+    }
+    return true;
+}
+
+void qce::simulator::ResultCache::storeHistogram(const ResultKey &key, const Histogram &histogram) {
+    std::vector<uint64_t> words;
+    words.reserve(2 * histogram.size());
+    for (const std::pair<uint64_t, uint64_t> &entry: histogram) {
+        words.push_back(entry.first);
+        words.push_back(entry.second);
+    }
+
+    store(key, ResultKind::Histogram, words.data(), histogram.size(), 2 * sizeof(uint64_t));
+}
+
+void qce::simulator::ResultCache::remove(const ResultKey &key) {
+    ResultIndexSlot *slot = find(key.key);
+    if (slot != nullptr && slot->check == key.check) {
+        erase(slot);
+    }
+}
+
+qce::simulator::CachedSimulator::CachedSimulator(
+    Simulator<QubitEnv> &backend,
+    const std::string &backendName,
+    ResultCache &cache,
+    const std::string &precision
+): backend{backend}, backendName{backendName}, precision{precision}, cache{cache} {}
+
+qce::simulator::Solution qce::simulator::CachedSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return backend.constructSolution(env);
+    }
+
+    const ResultKey key = resultKeyOf(env, backendName, precision, ResultKind::State);
+    DynamicQubitState state;
+    if (cache.loadState(key, state)) {
+        return Solution(std::move(state));
+    }
+
+    Solution solution = backend.constructSolution(env);
+    cache.storeState(key, solution.getResult());
+    return solution;
+}
+
+qce::simulator::Histogram qce::simulator::CachedSimulator::sample(const QubitEnv &env, uint64_t shots) {
+    const bool isCached = env.getExecutionMode() == ExecutionMode::Deferred;
+    const ResultKey key = isCached ? resultKeyOf(env, backendName, precision, ResultKind::Histogram, shots) : ResultKey{0, 0};
+    Histogram histogram;
+    if (isCached && cache.loadHistogram(key, histogram)) {
+        return histogram;
+    }
+
+    const DynamicQubitState state = constructSolution(env).getResult();
+    std::vector<double> cumulative((std::size_t)state.size());
+    double sum = 0;
+    for (Eigen::Index i = 0; i < state.size(); i++) {
+        sum += std::norm(state[i]);
+        cumulative[(std::size_t)i] = sum;
+    }
+
+    std::random_device randDevice;
+    std::mt19937_64 engine{randDevice()};
+    std::uniform_real_distribution<double> distribution(0, sum);
+    std::map<uint64_t, uint64_t> counts;
+    for (uint64_t shot = 0; shot < shots; shot++) {
+        auto found = std::upper_bound(cumulative.begin(), cumulative.end(), distribution(engine));
+        counts[(uint64_t)std::min<std::ptrdiff_t>(found - cumulative.begin(), (std::ptrdiff_t)cumulative.size() - 1)]++;
+    }
+
+    histogram.assign(counts.begin(), counts.end());
+    if (isCached) {
+        cache.storeHistogram(key, histogram);
+    }
+    return histogram;
+}
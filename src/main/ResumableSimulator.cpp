@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ResumableSimulator.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    const char CHECKPOINT_MAGIC[8] = {'Q', 'C', 'E', 'C', 'K', 'P', 'T', '\0'};
+    // amplitudes are written and hashed by pieces of this size
+    const uint64_t WRITE_PIECE_BYTES = uint64_t(64) << 20;
+
+    uint64_t headerChecksumOf(qce::simulator::CheckpointHeader header, const char *rngState) {
+        header.headerChecksum = 0;
+        uint64_t hash = qce::utils::hashBytes(&header, sizeof(header));
+        return qce::utils::hashBytes(rngState, header.rngStateBytes, hash);
+    }
+
+    void writeAll(int descriptor, const char *data, uint64_t bytes, const std::string &path) {
+        while (bytes > 0) {
+            ssize_t written = ::write(descriptor, data, std::min<uint64_t>(bytes, WRITE_PIECE_BYTES));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error("Failed to write checkpoint " + path + ": " + std::strerror(errno));
+            }
+
+            data += written;
+            bytes -= (uint64_t)written;
+        }
+    }
+} // namespace
+
+uint64_t qce::simulator::circuitHashOf(const std::vector<QubitState> &initialStates, const std::vector<GateRecord> &gates) {
+    return circuitHashOf(initialStates, gates, GateOperands());
+}
+
+uint64_t qce::simulator::circuitHashOf(
+    const std::vector<QubitState> &initialStates,
+    const std::vector<GateRecord> &gates,
+    const GateOperands &operands
+) {
+    std::vector<uint64_t> words;
+    utils::appendStateWords(words, initialStates);
+    uint64_t hash = utils::hashBytes(words.data(), words.size() * sizeof(uint64_t));
+    for (const GateRecord &gate: gates) {
+        words.clear();
+        appendGateWords(words, gate, operands);
+        hash = utils::hashBytes(words.data(), words.size() * sizeof(uint64_t), hash);
+    }
+
+    return hash;
+}
+
+qce::simulator::ResumableSimulator::ResumableSimulator(
+    const std::string &checkpointPath,
+    std::size_t checkpointInterval
+): checkpointPath{checkpointPath}, checkpointInterval{checkpointInterval} {}
+
+void qce::simulator::ResumableSimulator::prepare(const QubitEnv &env) {
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+
+    std::vector<GateRecord> compiled;
+    compiled.reserve(args.getNodes().size());
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        compiled.push_back(node.getData());
+    }
+
+    uint64_t hash = circuitHashOf(initialStates, compiled, args.getOperands());
+    if (amplitudes != nullptr && hash == circuitHash && initialStates.size() == qubitsCount) {
+        isRestored = false;
+        gates = std::move(compiled);
+        operands = args.getOperands();
+        return;
+    }
+
+    if (isRestored) {
+        throw std::invalid_argument("Restored checkpoint belongs to another circuit");
+    }
+
+    qubitsCount = initialStates.size();
+    gates = std::move(compiled);
+    operands = args.getOperands();
+    circuitHash = hash;
+    position = 0;
+    mappedState = utils::MappedFile();
+    ownedState = kernels::productState(initialStates);
+    amplitudes = ownedState.data();
+    size = (uint64_t)ownedState.size();
+}
+
+bool qce::simulator::ResumableSimulator::advance(const QubitEnv &env, std::size_t count) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to advance");
+    }
+
+    prepare(env);
+    return applyGates(count);
+}
+
+bool qce::simulator::ResumableSimulator::applyGates(std::size_t count) {
+    const kernels::BitLayout layout(qubitsCount);
+    std::size_t end = position + std::min(count, gates.size() - position);
+    for (; position < end; position++) {
+        kernels::applyGate(amplitudes, size, gates[position], operands, layout);
+    }
+
+    return position == gates.size();
+}
+
+qce::simulator::Solution qce::simulator::ResumableSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    // circuit is compiled and hashed once, not on every checkpoint interval
+    prepare(env);
+    bool isCheckpointed = !checkpointPath.empty() && checkpointInterval != 0;
+    while (!applyGates(isCheckpointed ? checkpointInterval : SIZE_MAX)) {
+        checkpoint(checkpointPath);
+    }
+
+    DynamicQubitState result((Eigen::Index)size);
+    std::copy(amplitudes, amplitudes + size, result.data());
+    return Solution(std::move(result));
+}
+
+void qce::simulator::ResumableSimulator::checkpoint(const std::string &path) const {
+    if (amplitudes == nullptr) {
+        throw std::logic_error("Simulator has no state to checkpoint");
+    }
+
+    std::ostringstream rngStream;
+    rngStream << engine;
+    const std::string rngState = rngStream.str();
+
+    const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.qubitsCount = (uint32_t)qubitsCount;
+    header.position = position;
+    header.gatesCount = gates.size();
+    header.circuitHash = circuitHash;
+    header.rngStateBytes = rngState.size();
+    header.dataOffset = (sizeof(header) + rngState.size() + pageSize - 1) / pageSize * pageSize;
+
+    const char *data = reinterpret_cast<const char*>(amplitudes);
+    const uint64_t dataBytes = size * sizeof(Amplitude_t);
+    uint64_t stateChecksum = utils::HASH_SEED;
+    for (uint64_t offset = 0; offset < dataBytes; offset += WRITE_PIECE_BYTES) {
+        stateChecksum = utils::hashBytes(data + offset, std::min(WRITE_PIECE_BYTES, dataBytes - offset), stateChecksum);
+    }
+    header.stateChecksum = stateChecksum;
+    header.headerChecksum = headerChecksumOf(header, rngState.data());
+
+    std::vector<char> prefix(header.dataOffset, 0);
+    std::memcpy(prefix.data(), &header, sizeof(header));
+    std::memcpy(prefix.data() + sizeof(header), rngState.data(), rngState.size());
+
+    const std::string temporaryPath = path + ".tmp";
+    int descriptor = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (descriptor < 0) {
+        throw std::runtime_error("Failed to create checkpoint " + temporaryPath + ": " + std::strerror(errno));
+    }
+
+    try {
+        writeAll(descriptor, prefix.data(), prefix.size(), temporaryPath);
+        writeAll(descriptor, data, dataBytes, temporaryPath);
+        if (fsync(descriptor) != 0) {
+            throw std::runtime_error("Failed to sync checkpoint " + temporaryPath + ": " + std::strerror(errno));
+        }
+    } catch (...) {
+        close(descriptor);
+        unlink(temporaryPath.c_str());
+        throw;
+    }
+
+    close(descriptor);
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        unlink(temporaryPath.c_str());
+        throw std::runtime_error("Failed to replace checkpoint " + path + ": " + std::strerror(errno));
+    }
+}
+
+void qce::simulator::ResumableSimulator::restore(const std::string &path, bool verifyState) {
+    utils::MappedFile file(path, utils::MappingMode::Private);
+
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("Checkpoint " + path + " is truncated");
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File " + path + " is not a checkpoint");
+    }
+    if (header.version != CHECKPOINT_VERSION) {
+        throw std::runtime_error("Checkpoint " + path + " has unsupported version " + std::to_string(header.version));
+    }
+    if (header.qubitsCount >= 64 || sizeof(header) + header.rngStateBytes > header.dataOffset ||
+        header.dataOffset > file.size() ||
+        (file.size() - header.dataOffset) >> 4 != uint64_t(1) << header.qubitsCount) {
+        throw std::runtime_error("Checkpoint " + path + " is truncated");
+    }
+
+    const char *rngState = file.data() + sizeof(header);
+    if (headerChecksumOf(header, rngState) != header.headerChecksum || header.position > header.gatesCount) {
+        throw std::runtime_error("Checkpoint " + path + " has damaged header");
+    }
+
+    Amplitude_t *mappedAmplitudes = reinterpret_cast<Amplitude_t*>(file.data() + header.dataOffset);
+    const uint64_t dataBytes = (uint64_t(1) << header.qubitsCount) * sizeof(Amplitude_t);
+    if (verifyState) {
+        file.advise(header.dataOffset, dataBytes, MADV_SEQUENTIAL);
+        const char *data = reinterpret_cast<const char*>(mappedAmplitudes);
+        uint64_t stateChecksum = utils::HASH_SEED;
+        for (uint64_t offset = 0; offset < dataBytes; offset += WRITE_PIECE_BYTES) {
+            stateChecksum = utils::hashBytes(data + offset, std::min(WRITE_PIECE_BYTES, dataBytes - offset), stateChecksum);
+        }
+        if (stateChecksum != header.stateChecksum) {
+            throw std::runtime_error("Checkpoint " + path + " has damaged state");
+        }
+        file.advise(header.dataOffset, dataBytes, MADV_NORMAL);
+    }
+
+    std::istringstream rngStream(std::string(rngState, header.rngStateBytes));
+    std::mt19937_64 restoredEngine;
+    if (!(rngStream >> restoredEngine)) {
+        throw std::runtime_error("Checkpoint " + path + " has damaged RNG state");
+    }
+
+    engine = restoredEngine;
+    qubitsCount = header.qubitsCount;
+    gates.clear();
+    operands.clear();
+    circuitHash = header.circuitHash;
+    position = header.position;
+    ownedState = DynamicQubitState();
+    mappedState = std::move(file);
+    amplitudes = mappedAmplitudes;
+    size = uint64_t(1) << qubitsCount;
+    isRestored = true;
+}
+
+std::size_t qce::simulator::ResumableSimulator::measure() {
+    if (amplitudes == nullptr) {
+        throw std::logic_error("Simulator has no state to measure");
+    }
+
+    double total = 0;
+    for (uint64_t i = 0; i < size; i++) {
+        total += std::norm(amplitudes[i]);
+    }
+
+    std::uniform_real_distribution<double> distribution(0, total);
+    double target = distribution(engine);
+    double sum = 0;
+    uint64_t last = 0;
+    for (uint64_t i = 0; i < size; i++) {
+        double probability = std::norm(amplitudes[i]);
+        if (probability <= 0) {
+            continue;
+        }
+
+        sum += probability;
+        last = i;
+        if (target < sum) {
+            return (std::size_t)i;
+        }
+    }
+
+    return (std::size_t)last;
+}
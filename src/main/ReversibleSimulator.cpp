@@ -0,0 +1,202 @@
+#include <stdexcept>
+#include <utility>
+
+#include "ReversibleSimulator.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    inline bool bitOf(const std::vector<uint64_t> &bits, uint32_t qubit) {
+        return (bits[qubit / 64] >> (qubit % 64)) & 1;
+    }
+
+    inline void flipBit(std::vector<uint64_t> &bits, uint32_t qubit) {
+        bits[qubit / 64] ^= uint64_t(1) << (qubit % 64);
+    }
+
+    /**
+     * Returns true if every control of multi-controlled gate is set.
+    */
+    bool areControlsSet(const std::vector<uint64_t> &bits, const GateRecord &gate, const GateOperands &operands) {
+        const uint32_t *controls = operands.getControls(gate);
+        for (uint32_t i = 0; i < operands.getControlsCount(gate); i++) {
+            if (!bitOf(bits, controls[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Lanes where every control of multi-controlled gate is set.
+    */
+    uint64_t controlLanes(const std::vector<uint64_t> &lanes, const GateRecord &gate, const GateOperands &operands) {
+        const uint32_t *controls = operands.getControls(gate);
+        uint64_t mask = ~uint64_t(0);
+        for (uint32_t i = 0; i < operands.getControlsCount(gate); i++) {
+            mask &= lanes[controls[i]];
+        }
+        return mask;
+    }
+
+    bool isBasisState(const qce::QubitState &state) {
+        return state[0] == qce::kernels::Amplitude_t(0) || state[1] == qce::kernels::Amplitude_t(0);
+    }
+} // namespace
+
+bool qce::simulator::isReversibleCircuit(const std::vector<Node<GateRecord>> &gates) {
+    for (const Node<GateRecord> &node: gates) {
+        GateKind kind = node.getData().kind;
+        if (kind != GateKind::X && kind != GateKind::Cnot && kind != GateKind::Swap &&
+            kind != GateKind::MCX && kind != GateKind::MCSwap) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool qce::simulator::isClassicalCircuit(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return false;
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    for (const QubitState &state: args.getInitialStates()) {
+        if (!isBasisState(state)) {
+            return false;
+        }
+    }
+
+    return isReversibleCircuit(args.getNodes());
+}
+
+std::vector<uint64_t> qce::simulator::ReversibleSimulator::evaluate(const QubitEnv &env) const {
+    if (!isClassicalCircuit(env)) {
+        throw std::invalid_argument("Provided environment is not a classical reversible circuit");
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const GateOperands &operands = args.getOperands();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    std::vector<uint64_t> bits((initialStates.size() + 63) / 64, 0);
+    for (std::size_t qubit = 0; qubit < initialStates.size(); qubit++) {
+        if (initialStates[qubit][0] == kernels::Amplitude_t(0)) {
+            flipBit(bits, (uint32_t)qubit);
+        }
+    }
+
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        const GateRecord &gate = node.getData();
+        switch (gate.kind) {
+            case GateKind::X:
+                flipBit(bits, gate.target);
+                break;
+            case GateKind::Cnot:
+                if (bitOf(bits, gate.control)) {
+                    flipBit(bits, gate.target);
+                }
+                break;
+            case GateKind::Swap:
+                if (bitOf(bits, gate.target) != bitOf(bits, gate.control)) {
+                    flipBit(bits, gate.target);
+                    flipBit(bits, gate.control);
+                }
+                break;
+            case GateKind::MCX:
+                if (areControlsSet(bits, gate, operands)) {
+                    flipBit(bits, gate.target);
+                }
+                break;
+            case GateKind::MCSwap: {
+                uint32_t second = operands.getSecondTarget(gate);
+                if (bitOf(bits, gate.target) != bitOf(bits, second) && areControlsSet(bits, gate, operands)) {
+                    flipBit(bits, gate.target);
+                    flipBit(bits, second);
+                }
+                break;
+            }
+            default:
+                throw std::logic_error("Reversible circuit has non-permutation gate");
+        }
+    }
+
+    return bits;
+}
+
+std::vector<uint64_t> qce::simulator::ReversibleSimulator::evaluateBatch(
+    const QubitEnv &env,
+    const std::vector<uint64_t> &lanes
+) const {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to evaluate");
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    if (lanes.size() != args.getInitialStates().size()) {
+        throw std::invalid_argument("Lanes count must be equal to qubits count");
+    }
+    if (!isReversibleCircuit(args.getNodes())) {
+        throw std::invalid_argument("Provided environment is not a reversible circuit");
+    }
+
+    const GateOperands &operands = args.getOperands();
+    std::vector<uint64_t> result = lanes;
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        const GateRecord &gate = node.getData();
+        switch (gate.kind) {
+            case GateKind::X:
+                result[gate.target] = ~result[gate.target];
+                break;
+            case GateKind::Cnot:
+                result[gate.target] ^= result[gate.control];
+                break;
+            case GateKind::Swap:
+                std::swap(result[gate.target], result[gate.control]);
+                break;
+            case GateKind::MCX:
+                result[gate.target] ^= controlLanes(result, gate, operands);
+                break;
+            case GateKind::MCSwap: {
+                // lanes where controls are set and qubits differ flip both qubits
+                uint32_t second = operands.getSecondTarget(gate);
+                uint64_t flips = (result[gate.target] ^ result[second]) & controlLanes(result, gate, operands);
+                result[gate.target] ^= flips;
+                result[second] ^= flips;
+                break;
+            }
+            default:
+                throw std::logic_error("Reversible circuit has non-permutation gate");
+        }
+    }
+
+    return result;
+}
+
+qce::simulator::Solution qce::simulator::ReversibleSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+    if (!isClassicalCircuit(env)) {
+        return Solution(env.computeState());
+    }
+
+    // permutation moves the only amplitude of initial basis state, qubit 0 is the most significant
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    const std::size_t n = initialStates.size();
+    kernels::Amplitude_t amplitude = 1;
+    for (const QubitState &state: initialStates) {
+        amplitude *= state[0] == kernels::Amplitude_t(0) ? state[1] : state[0];
+    }
+
+    std::vector<uint64_t> bits = evaluate(env);
+    uint64_t index = 0;
+    for (std::size_t qubit = 0; qubit < n; qubit++) {
+        index |= (uint64_t)bitOf(bits, (uint32_t)qubit) << (n - qubit - 1);
+    }
+
+    DynamicQubitState result = DynamicQubitState::Zero((Eigen::Index)(uint64_t(1) << n));
+    result[(Eigen::Index)index] = amplitude;
+    return Solution(std::move(result));
+}
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ShardedSimulator.hpp"
+
+using namespace qce::operations;
+
+void qce::simulator::ShardTransport::exchange(
+    std::size_t peer,
+    const void *sendBuffer,
+    void *receiveBuffer,
+    std::size_t bytes
+) {
+    if (getRank() < peer) {
+        send(peer, sendBuffer, bytes);
+        receive(peer, receiveBuffer, bytes);
+    } else {
+        receive(peer, receiveBuffer, bytes);
+        send(peer, sendBuffer, bytes);
+    }
+}
+
+qce::simulator::SocketTransport::SocketTransport(std::size_t rank, const std::vector<int> &sockets):
+    rank{rank}, sockets{sockets} {}
+
+qce::simulator::SocketTransport::~SocketTransport() {
+    for (std::size_t peer = 0; peer < sockets.size(); peer++) {
+        if (peer != rank && sockets[peer] >= 0) {
+            close(sockets[peer]);
+        }
+    }
+}
+
+void qce::simulator::SocketTransport::send(std::size_t peer, const void *buffer, std::size_t bytes) {
+    const char *data = static_cast<const char*>(buffer);
+    while (bytes > 0) {
+        ssize_t written = ::send(sockets[peer], data, bytes, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Shard transport send failed: ") + std::strerror(errno));
+        }
+
+        data += written;
+        bytes -= (std::size_t)written;
+    }
+}
+
+void qce::simulator::SocketTransport::receive(std::size_t peer, void *buffer, std::size_t bytes) {
+    char *data = static_cast<char*>(buffer);
+    while (bytes > 0) {
+        ssize_t received = ::recv(sockets[peer], data, bytes, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            throw std::runtime_error("Shard transport receive failed");
+        }
+
+        data += received;
+        bytes -= (std::size_t)received;
+    }
+}
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    /**
+     * Swaps global qubit with local one, rank keeps half of its amplitudes
+     * and exchanges the other half with partner.
+    */
+    void swapGlobalQubit(
+        std::vector<Amplitude_t> &local,
+        uint32_t localBits,
+        std::size_t globalQubit,
+        std::size_t localQubit,
+        qce::kernels::BitLayout &layout,
+        qce::simulator::ShardTransport &transport,
+        qce::simulator::ShardStatistics &statistics
+    ) {
+        uint32_t rankBit = layout.bitOf(globalQubit) - localBits;
+        uint32_t localBit = layout.bitOf(localQubit);
+        std::size_t rank = transport.getRank();
+        std::size_t partner = rank ^ (std::size_t(1) << rankBit);
+        uint64_t value = (rank >> rankBit) & 1;
+
+        // amplitudes with local bit different from rank bit belong to partner after swap
+        uint64_t half = local.size() >> 1;
+        std::vector<Amplitude_t> outgoing(half), incoming(half);
+        for (uint64_t k = 0; k < half; k++) {
+            outgoing[k] = local[qce::kernels::insertZeroBit(k, localBit) | ((1 - value) << localBit)];
+        }
+
+        transport.exchange(partner, outgoing.data(), incoming.data(), half * sizeof(Amplitude_t));
+
+        for (uint64_t k = 0; k < half; k++) {
+            local[qce::kernels::insertZeroBit(k, localBit) | ((1 - value) << localBit)] = incoming[k];
+        }
+
+        layout.swapQubits(globalQubit, localQubit);
+        statistics.globalSwaps++;
+        statistics.exchangedBytes += half * sizeof(Amplitude_t);
+    }
+
+    /**
+     * Full mesh of socket pairs, sockets[a][b] is end of rank a connected to rank b.
+     * Sockets still owned by mesh are closed when it is destroyed.
+    */
+    struct SocketMesh {
+        std::vector<std::vector<int>> sockets;
+
+        explicit SocketMesh(std::size_t ranks): sockets(ranks, std::vector<int>(ranks, -1)) {}
+
+        SocketMesh(const SocketMesh&) = delete;
+        SocketMesh& operator=(const SocketMesh&) = delete;
+
+        ~SocketMesh() {
+            for (std::size_t rank = 0; rank < sockets.size(); rank++) {
+                closeRank(rank);
+            }
+        }
+
+        void closeRank(std::size_t rank) {
+            for (int &socket: sockets[rank]) {
+                if (socket >= 0) {
+                    close(socket);
+                    socket = -1;
+                }
+            }
+        }
+
+        /**
+         * Hands sockets of rank over to its transport, mesh no longer closes them.
+        */
+        std::vector<int> release(std::size_t rank) {
+            std::vector<int> released = sockets[rank];
+            std::fill(sockets[rank].begin(), sockets[rank].end(), -1);
+            return released;
+        }
+    };
+
+    /**
+     * Forked shard processes. Children which weren't waited for are killed and reaped when it is
+     * destroyed, so failed setup doesn't leave them blocked on their sockets.
+    */
+    struct ShardChildren {
+        std::vector<pid_t> pids;
+
+        ShardChildren() = default;
+        ShardChildren(const ShardChildren&) = delete;
+        ShardChildren& operator=(const ShardChildren&) = delete;
+
+        ~ShardChildren() {
+            for (pid_t pid: pids) {
+                kill(pid, SIGKILL);
+            }
+            wait();
+        }
+
+        /**
+         * Waits for every child, returns true if all of them exited successfully.
+        */
+        bool wait() {
+            bool isSuccessful = true;
+            for (pid_t pid: pids) {
+                int status = 0;
+                while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+                isSuccessful = isSuccessful && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            }
+            pids.clear();
+            return isSuccessful;
+        }
+    };
+} // namespace
+
+qce::DynamicQubitState qce::simulator::runShard(
+    const OperGraphState &args,
+    ShardTransport &transport,
+    ShardStatistics &statistics
+) {
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    std::size_t n = initialStates.size();
+    std::size_t ranks = transport.getRanksCount();
+    std::size_t rank = transport.getRank();
+    uint32_t globalBits = (uint32_t)utils::integerLog(ranks) - 1;
+    uint32_t localBits = (uint32_t)n - globalBits;
+
+    // every rank checks the whole circuit before exchanging anything, so all of them fail together
+    const GateOperands &operands = args.getOperands();
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        std::size_t gateQubits = 0;
+        forEachGateQubit(node.getData(), operands, [&](uint32_t) { gateQubits++; });
+        if (gateQubits > localBits) {
+            throw std::invalid_argument("Provided shards can't hold qubits of " + gateName(node.getData().kind));
+        }
+    }
+
+    // qubits 0..g-1 are global in natural layout, their values are fixed by rank
+    std::vector<QubitState> localStates(initialStates.begin() + globalBits, initialStates.end());
+    DynamicQubitState localProduct = kernels::productState(localStates);
+    Amplitude_t factor = 1;
+    for (uint32_t qubit = 0; qubit < globalBits; qubit++) {
+        factor *= initialStates[qubit][(rank >> (globalBits - qubit - 1)) & 1];
+    }
+
+    std::vector<Amplitude_t> local(localProduct.size());
+    for (Eigen::Index i = 0; i < localProduct.size(); i++) {
+        local[i] = factor * localProduct[i];
+    }
+
+    kernels::BitLayout layout(n);
+    const uint64_t localSize = local.size();
+
+    for (const Node<GateRecord> &node: args.getNodes()) {
+        const GateRecord &gate = node.getData();
+
+        std::vector<std::size_t> gateQubits;
+        forEachGateQubit(gate, operands, [&](uint32_t qubit) { gateQubits.push_back(qubit); });
+
+        for (std::size_t qubit: gateQubits) {
+            if (layout.bitOf(qubit) < localBits) {
+                continue;
+            }
+
+            // the highest local qubit not used by gate is moved out
+            for (uint32_t bit = localBits; bit-- > 0;) {
+                std::size_t candidate = layout.qubitAt(bit);
+                if (std::find(gateQubits.begin(), gateQubits.end(), candidate) == gateQubits.end()) {
+                    swapGlobalQubit(local, localBits, qubit, candidate, layout, transport, statistics);
+                    break;
+                }
+            }
+        }
+
+        kernels::applyGate(local.data(), localSize, gate, operands, layout);
+    }
+
+    if (rank != 0) {
+        transport.send(0, local.data(), localSize * sizeof(Amplitude_t));
+        return DynamicQubitState();
+    }
+
+    DynamicQubitState result(localSize * ranks);
+    std::copy(local.begin(), local.end(), result.data());
+    for (std::size_t peer = 1; peer < ranks; peer++) {
+        transport.receive(peer, result.data() + peer * localSize, localSize * sizeof(Amplitude_t));
+    }
+
+    kernels::changeLayout(result.data(), (uint64_t)result.size(), layout, kernels::BitLayout(n));
+    return result;
+}
+
+qce::simulator::ShardedSimulator::ShardedSimulator(std::size_t ranks): ranks{ranks} {
+    if (ranks == 0 || (ranks & (ranks - 1)) != 0) {
+        throw std::invalid_argument("Provided ranks count is not a power of two");
+    }
+}
+
+qce::simulator::Solution qce::simulator::ShardedSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    statistics = ShardStatistics();
+    qce::OperGraphState args = env.provideExecutionArgs();
+    if (args.getInitialStates().size() < utils::integerLog(ranks) + 1) {
+        throw std::invalid_argument("Provided environment is too small to be split between ranks");
+    }
+
+    // on error path mesh is destroyed first, then children see closed peers, are killed and reaped
+    ShardChildren children;
+    SocketMesh mesh(ranks);
+    for (std::size_t a = 0; a < ranks; a++) {
+        for (std::size_t b = a + 1; b < ranks; b++) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                throw std::runtime_error("Failed to create socket pair for shard transport");
+            }
+            mesh.sockets[a][b] = pair[0];
+            mesh.sockets[b][a] = pair[1];
+        }
+    }
+
+    auto closeForeignSockets = [&](std::size_t rank) {
+        for (std::size_t other = 0; other < ranks; other++) {
+            if (other != rank) {
+                mesh.closeRank(other);
+            }
+        }
+    };
+
+    for (std::size_t rank = 1; rank < ranks; rank++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("Failed to fork shard process");
+        }
+
+        if (pid == 0) {
+            int status = 0;
+            closeForeignSockets(rank);
+            try {
+                SocketTransport transport(rank, mesh.release(rank));
+                ShardStatistics shardStatistics;
+                runShard(args, transport, shardStatistics);
+            } catch (...) {
+                status = 1;
+            }
+            _exit(status);
+        }
+
+        children.pids.push_back(pid);
+    }
+
+    closeForeignSockets(0);
+    DynamicQubitState result;
+    bool failed = false;
+    try {
+        SocketTransport transport(0, mesh.release(0));
+        result = runShard(args, transport, statistics);
+    } catch (...) {
+        failed = true;
+    }
+
+    failed = !children.wait() || failed;
+    if (failed) {
+        throw std::runtime_error("Sharded simulation failed");
+    }
+
+    return Solution(std::move(result));
+}
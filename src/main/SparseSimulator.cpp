@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "SparseSimulator.hpp"
+
+using namespace qce::operations;
+
+namespace {
+    using qce::kernels::Amplitude_t;
+
+    const std::size_t MAX_SPARSE_QUBITS = 63;
+    // register gate spreads entry over all 2^k values of its qubits
+    const std::size_t MAX_SPREAD_QUBITS = 24;
+
+    /**
+     * Phase diagonal gate multiplies amplitude with, or 0 if gate isn't diagonal.
+    */
+    Amplitude_t diagonalPhase(GateKind kind) {
+        switch (kind) {
+            case GateKind::Z: return -1;
+            case GateKind::S: return Amplitude_t(0, 1);
+            case GateKind::CZ: return -1;
+            case GateKind::CPhase: return Amplitude_t(0, 1);
+            case GateKind::MCZ: return -1;
+            default: return 0;
+        }
+    }
+} // namespace
+
+qce::simulator::SparseState::SparseState(std::size_t qubitsCount, std::size_t capacity): qubitsCount{qubitsCount} {
+    if (qubitsCount > MAX_SPARSE_QUBITS) {
+        throw std::invalid_argument("Sparse state supports at most 63 qubits");
+    }
+
+    std::size_t slots = 16;
+    while (slots < 2 * capacity) {
+        slots <<= 1;
+    }
+    table.assign(slots, Entry{EMPTY_KEY, 0});
+}
+
+qce::simulator::SparseState qce::simulator::SparseState::productState(const std::vector<QubitState> &states) {
+    SparseState result(states.size());
+    result.add(0, 1);
+
+    // like kernels::productState, current qubit becomes the least significant bit
+    for (const QubitState &state: states) {
+        SparseState next(states.size(), result.size() * 2);
+        result.forEach([&](uint64_t key, Amplitude_t value) {
+            for (uint64_t bit = 0; bit < 2; bit++) {
+                if (state[(Eigen::Index)bit] != Amplitude_t(0)) {
+                    next.add((key << 1) | bit, value * state[(Eigen::Index)bit]);
+                }
+            }
+        });
+        result = std::move(next);
+    }
+
+    return result;
+}
+
+std::size_t qce::simulator::SparseState::slotOf(uint64_t key) const {
+    uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+    return (std::size_t)((hash ^ (hash >> 32)) & (table.size() - 1));
+}
+
+void qce::simulator::SparseState::grow() {
+    std::vector<Entry> old(table.size() * 2, Entry{EMPTY_KEY, 0});
+    old.swap(table);
+    entriesCount = 0;
+    for (const Entry &entry: old) {
+        if (entry.key != EMPTY_KEY) {
+            add(entry.key, entry.value);
+        }
+    }
+}
+
+void qce::simulator::SparseState::add(uint64_t key, kernels::Amplitude_t value) {
+    if (2 * (entriesCount + 1) > table.size()) {
+        grow();
+    }
+
+    std::size_t mask = table.size() - 1;
+    for (std::size_t slot = slotOf(key);; slot = (slot + 1) & mask) {
+        Entry &entry = table[slot];
+        if (entry.key == key) {
+            entry.value += value;
+            return;
+        }
+        if (entry.key == EMPTY_KEY) {
+            entry = Entry{key, value};
+            entriesCount++;
+            return;
+        }
+    }
+}
+
+qce::kernels::Amplitude_t qce::simulator::SparseState::amplitude(uint64_t key) const {
+    std::size_t mask = table.size() - 1;
+    for (std::size_t slot = slotOf(key);; slot = (slot + 1) & mask) {
+        const Entry &entry = table[slot];
+        if (entry.key == key) {
+            return entry.value;
+        }
+        if (entry.key == EMPTY_KEY) {
+            return 0;
+        }
+    }
+}
+
+std::size_t qce::simulator::SparseState::applyGate(
+    const GateRecord &record,
+    const GateOperands &operands,
+    const kernels::BitLayout &layout,
+    double threshold
+) {
+    const uint64_t targetMask = uint64_t(1) << layout.bitOf(record.target);
+    uint64_t controlMask = record.hasControl() ? uint64_t(1) << layout.bitOf(record.control) : 0;
+    uint64_t secondMask = 0;
+    QubitMat_t matrix;
+    // bits of qubits of register gate, the first one is target and the most significant bit of value
+    std::vector<uint64_t> registerMasks;
+    Amplitude_t phase = diagonalPhase(record.kind);
+    if (hasOperands(record.kind)) {
+        if (!operands.hasEntry(record)) {
+            throw std::invalid_argument("Multi-controlled gate has no operands entry");
+        }
+        const uint32_t *controls = operands.getControls(record);
+        for (uint32_t i = 0; i < operands.getControlsCount(record); i++) {
+            controlMask |= uint64_t(1) << layout.bitOf(controls[i]);
+        }
+        if (isRegisterGate(record.kind)) {
+            registerMasks.push_back(targetMask);
+            for (uint32_t i = 0; i < operands.getControlsCount(record); i++) {
+                registerMasks.push_back(uint64_t(1) << layout.bitOf(controls[i]));
+            }
+            controlMask = 0;
+        }
+        if (operands.getSecondTarget(record) != NO_CONTROL_QUBIT) {
+            secondMask = uint64_t(1) << layout.bitOf(operands.getSecondTarget(record));
+        }
+        const Amplitude_t *values = operands.getValues(record);
+        if (record.kind == GateKind::MCPhase) {
+            phase = values[0];
+        }
+        if (record.kind == GateKind::MCU) {
+            matrix << values[0], values[1], values[2], values[3];
+        }
+    } else if (record.kind == GateKind::Swap) {
+        // second qubit of swap isn't a control
+        secondMask = controlMask;
+        controlMask = 0;
+    } else if (isSingleQubitGate(record.kind)) {
+        matrix = kernels::gateMatrix(record.kind);
+    }
+
+    auto valueOf = [&](uint64_t key) {
+        std::size_t value = 0;
+        for (uint64_t mask: registerMasks) {
+            value = (value << 1) | ((key & mask) != 0 ? 1 : 0);
+        }
+        return value;
+    };
+
+    if (record.kind == GateKind::PhaseOracle) {
+        const Amplitude_t *phases = operands.getValues(record);
+        for (Entry &entry: table) {
+            if (entry.key != EMPTY_KEY) {
+                entry.value *= phases[valueOf(entry.key)];
+            }
+        }
+        return 0;
+    }
+    if (phase != Amplitude_t(0)) {
+        // keys stay, so entries are scaled in place
+        const uint64_t mask = targetMask | controlMask;
+        for (Entry &entry: table) {
+            if (entry.key != EMPTY_KEY && (entry.key & mask) == mask) {
+                entry.value *= phase;
+            }
+        }
+        return 0;
+    }
+
+    // entries with some control unset are copied unchanged
+    const bool isSpreading = isSingleQubitGate(record.kind) || record.kind == GateKind::MCU || isRegisterGate(record.kind);
+    SparseState next(qubitsCount, entriesCount * (isSpreading ? 2 : 1));
+    switch (record.kind) {
+        case GateKind::Cnot:
+        case GateKind::MCX:
+            forEach([&](uint64_t key, Amplitude_t value) {
+                next.add((key & controlMask) == controlMask ? key ^ targetMask : key, value);
+            });
+            break;
+        case GateKind::Swap:
+        case GateKind::MCSwap:
+            forEach([&](uint64_t key, Amplitude_t value) {
+                bool differ = ((key & targetMask) != 0) != ((key & secondMask) != 0);
+                bool isSwapped = differ && (key & controlMask) == controlMask;
+                next.add(isSwapped ? key ^ (targetMask | secondMask) : key, value);
+            });
+            break;
+        case GateKind::PauliRotation: {
+            // entry keeps cos(theta) of itself and moves -i sin(theta) P of itself to its pair
+            const kernels::PauliMasks masks = kernels::pauliMasksOf(record, operands, layout);
+            const double theta = operands.getValues(record)[0].real();
+            const Amplitude_t yPhases[4] = {1, Amplitude_t(0, 1), -1, Amplitude_t(0, -1)};
+            const Amplitude_t moved = Amplitude_t(0, -std::sin(theta)) * yPhases[masks.yCount % 4];
+            forEach([&](uint64_t key, Amplitude_t value) {
+                bool isOdd = false;
+                for (uint64_t bits = key & masks.zMask; bits != 0; bits &= bits - 1) {
+                    isOdd = !isOdd;
+                }
+                next.add(key, std::cos(theta) * value);
+                next.add(key ^ masks.xMask, (isOdd ? -moved : moved) * value);
+            });
+            break;
+        }
+        case GateKind::Unitary:
+        case GateKind::QFT:
+        case GateKind::IQFT:
+        case GateKind::GroverDiffusion: {
+            // like single qubit gate below, but column is picked by bits of all gate qubits
+            if (registerMasks.size() > MAX_SPREAD_QUBITS) {
+                throw std::invalid_argument("Sparse state supports register gates of at most 24 qubits");
+            }
+            const std::size_t dimension = std::size_t(1) << registerMasks.size();
+            std::vector<uint64_t> rowBits(dimension, 0);
+            for (std::size_t row = 0; row < dimension; row++) {
+                for (std::size_t j = 0; j < registerMasks.size(); j++) {
+                    if ((row >> (registerMasks.size() - 1 - j)) & 1) {
+                        rowBits[row] |= registerMasks[j];
+                    }
+                }
+            }
+
+            // Fourier matrix is row * column power of root of unity, diffusion is 2/N - I
+            const Amplitude_t *values = operands.getValues(record);
+            std::vector<Amplitude_t> roots;
+            if (record.kind == GateKind::QFT || record.kind == GateKind::IQFT) {
+                const double sign = record.kind == GateKind::IQFT ? -1 : 1;
+                for (std::size_t j = 0; j < dimension; j++) {
+                    roots.push_back(std::polar(1 / std::sqrt((double)dimension), sign * 2 * M_PI * (double)j / (double)dimension));
+                }
+            }
+            auto element = [&](std::size_t row, std::size_t column) -> Amplitude_t {
+                switch (record.kind) {
+                    case GateKind::Unitary: return values[row * dimension + column];
+                    case GateKind::GroverDiffusion: return 2. / (double)dimension - (row == column ? 1. : 0.);
+                    default: return roots[(row * column) % dimension];
+                }
+            };
+
+            forEach([&](uint64_t key, Amplitude_t value) {
+                std::size_t column = valueOf(key);
+                uint64_t cleared = key & ~rowBits[dimension - 1];
+                for (std::size_t row = 0; row < dimension; row++) {
+                    const Amplitude_t factor = element(row, column);
+                    if (factor != Amplitude_t(0)) {
+                        next.add(cleared | rowBits[row], factor * value);
+                    }
+                }
+            });
+            break;
+        }
+        default: {
+            // column of matrix picked by target bit spreads entry over both values of the bit,
+            // zero elements of matrix are skipped, so X and Y only move entries
+            forEach([&](uint64_t key, Amplitude_t value) {
+                if ((key & controlMask) != controlMask) {
+                    next.add(key, value);
+                    return;
+                }
+                Eigen::Index column = (key & targetMask) != 0 ? 1 : 0;
+                uint64_t cleared = key & ~targetMask;
+                if (matrix(0, column) != Amplitude_t(0)) {
+                    next.add(cleared, matrix(0, column) * value);
+                }
+                if (matrix(1, column) != Amplitude_t(0)) {
+                    next.add(cleared | targetMask, matrix(1, column) * value);
+                }
+            });
+        }
+    }
+
+    std::size_t pruned = 0;
+    next.forEach([&](uint64_t, Amplitude_t value) {
+        if (std::abs(value) < threshold) {
+            pruned++;
+        }
+    });
+    if (pruned == 0) {
+        *this = std::move(next);
+        return 0;
+    }
+
+    // interfering entries cancelled, table is rebuilt without them
+    SparseState kept(qubitsCount, next.size() - pruned);
+    next.forEach([&](uint64_t key, Amplitude_t value) {
+        if (std::abs(value) >= threshold) {
+            kept.add(key, value);
+        }
+    });
+    *this = std::move(kept);
+    return pruned;
+}
+
+qce::DynamicQubitState qce::simulator::SparseState::toDense() const {
+    DynamicQubitState result = DynamicQubitState::Zero((Eigen::Index)(uint64_t(1) << qubitsCount));
+    forEach([&](uint64_t key, Amplitude_t value) {
+        result[(Eigen::Index)key] = value;
+    });
+    return result;
+}
+
+qce::simulator::SparseSimulator::SparseSimulator(double pruneThreshold, double densityCutoff):
+    pruneThreshold{pruneThreshold}, densityCutoff{densityCutoff} {}
+
+qce::simulator::Solution qce::simulator::SparseSimulator::constructSolution(const QubitEnv &env) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        return Solution(DynamicQubitState(env.getLiveState()));
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<QubitState> &initialStates = args.getInitialStates();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const kernels::BitLayout layout(initialStates.size());
+    const double cutoff = densityCutoff * (double)(uint64_t(1) << initialStates.size());
+    statistics = SparseStatistics();
+
+    SparseState state = SparseState::productState(initialStates);
+    std::size_t position = 0;
+    for (; position < nodes.size() && (double)state.size() <= cutoff; position++) {
+        statistics.maxEntries = std::max(statistics.maxEntries, state.size());
+        statistics.prunedEntries += state.applyGate(nodes[position].getData(), args.getOperands(), layout, pruneThreshold);
+    }
+    statistics.maxEntries = std::max(statistics.maxEntries, state.size());
+
+    DynamicQubitState result = state.toDense();
+    if (position < nodes.size()) {
+        statistics.denseFallbacks++;
+    }
+    for (; position < nodes.size(); position++) {
+        kernels::applyGate(result, nodes[position].getData(), args.getOperands(), layout);
+    }
+
+    return Solution(std::move(result));
+}
+
+qce::simulator::SparseState qce::simulator::SparseSimulator::sparseState(const QubitEnv &env, std::size_t maxEntries) {
+    if (env.getExecutionMode() == ExecutionMode::Eager) {
+        throw std::invalid_argument("Provided environment is executed eagerly, it has no gates to apply");
+    }
+
+    qce::OperGraphState args = env.provideExecutionArgs();
+    const std::vector<Node<GateRecord>> &nodes = args.getNodes();
+    const kernels::BitLayout layout(args.getInitialStates().size());
+    statistics = SparseStatistics();
+
+    SparseState state = SparseState::productState(args.getInitialStates());
+    for (const Node<GateRecord> &node: nodes) {
+        if (state.size() > maxEntries) {
+            throw std::runtime_error("Sparse state exceeded " + std::to_string(maxEntries) + " entries");
+        }
+        statistics.maxEntries = std::max(statistics.maxEntries, state.size());
+        statistics.prunedEntries += state.applyGate(node.getData(), args.getOperands(), layout, pruneThreshold);
+    }
+    if (state.size() > maxEntries) {
+        throw std::runtime_error("Sparse state exceeded " + std::to_string(maxEntries) + " entries");
+    }
+    statistics.maxEntries = std::max(statistics.maxEntries, state.size());
+
+    return state;
+}
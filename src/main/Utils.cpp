@@ -2,6 +2,7 @@
 #include <cassert>
 #include <Eigen/Dense>
 #include <cstdint>
+#include <cstring>
 
 #include "Utils.hpp"
 #include "Qubit.h"
@@ -23,21 +24,58 @@ Eigen::MatrixXcd qce::utils::kroneckerProduct(
     return result;
 }
 
+uint64_t qce::utils::hashBytes(const void *data, std::size_t bytes, uint64_t seed) {
+    const unsigned char *begin = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+
+    auto mix = [&](uint64_t word) {
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    };
+
+    std::size_t offset = 0;
+    for (; offset + 8 <= bytes; offset += 8) {
+        uint64_t word;
+        std::memcpy(&word, begin + offset, 8);
+        mix(word);
+    }
+
+    if (offset < bytes) {
+        uint64_t word = 0;
+        std::memcpy(&word, begin + offset, bytes - offset);
+        mix(word ^ ((uint64_t)(bytes - offset) << 56));
+    }
+
+    return hash;
+}
+
+void qce::utils::appendStateWords(std::vector<uint64_t> &words, const std::vector<QubitState> &states) {
+    words.push_back(states.size());
+    for (const QubitState &state: states) {
+        for (double part: {state[0].real(), state[0].imag(), state[1].real(), state[1].imag()}) {
+            // -0.0 and 0.0 describe the same state
+            part += 0.0;
+            uint64_t word;
+            std::memcpy(&word, &part, sizeof(word));
+            words.push_back(word);
+        }
+    }
+}
+
 int qce::utils::rrandom32() {
     return (_rrand32u_func() - (RAND_MAX >> 1) - 1) * 2;
 }
 
-long qce::utils::rrandom64() {
-    long _rand32 = rrandom32();
-    return ((_rand32 << 16) + _rand32);
+int64_t qce::utils::rrandom64() {
+    return (int64_t)rrandom64u();
 }
 
 unsigned qce::utils::rrandom32u() {
     return _rrand32u_func();
 }
 
-unsigned long qce::utils::rrandom64u() {
-    return ((_rrand32u_func() << 16) + _rrand32u_func());
+uint64_t qce::utils::rrandom64u() {
+    return ((uint64_t)rrandom32u() << 32) | rrandom32u();
 }
 
 qce::DynamicQubitState qce::utils::combineStates(
@@ -49,7 +87,7 @@ qce::DynamicQubitState qce::utils::combineStates(
     
     for (Eigen::Index i = 0; i < first.size(); i++) {
         for (Eigen::Index j = 0; j < second.size(); j++) {
-            result[(i<<1)+j] = first[i] * second[j];
+            result[i * second.size() + j] = first[i] * second[j];
         }
     }
 
@@ -68,7 +106,7 @@ qce::DynamicQubitState qce::utils::combineStates(
     return result;
 }
 
-unsigned qce::utils::probabilityRandomChoice(Eigen::Matrix<double, -1, 1> probabilities) {
+std::size_t qce::utils::probabilityRandomChoice(const Eigen::Matrix<double, -1, 1> &probabilities) {
 
     assert(probabilities.size()!=0);
 
@@ -78,27 +116,31 @@ unsigned qce::utils::probabilityRandomChoice(Eigen::Matrix<double, -1, 1> probab
     }
     assert(abs(probSum - 1.) <= _probability_precision);
 
-    uint32_t elementCount = (uint32_t)(1 / _probability_precision);
+    // probabilities of 2^n outcomes are far below any fixed grid, so target is drawn as real number
     std::random_device randDevice;
-    std::mt19937 engine{randDevice()};
-    std::uniform_int_distribution<uint32_t> dist(0, elementCount);
-    double randTarget = (double)dist(engine);
+    std::mt19937_64 engine{randDevice()};
+    std::uniform_real_distribution<double> dist(0, probSum);
+    double randTarget = dist(engine);
 
-    uint32_t sum = 0;
+    double sum = 0;
     for (Eigen::Index i = 0; i < probabilities.size(); i++) {
         double p = probabilities[i];
-        double cur = sum + elementCount * p;
-        if (sum <= randTarget && randTarget < cur) {
-            return i;
+        if (p > 0 && randTarget < sum + p) {
+            return (std::size_t)i;
         }
 
-        sum = cur;
+        sum += p;
     }
 
-    return probabilities.size()-1;
+    // rounding may leave target above the last sum, the last possible outcome is taken then
+    Eigen::Index last = probabilities.size() - 1;
+    while (last > 0 && probabilities[last] <= 0) {
+        last--;
+    }
+    return (std::size_t)last;
 }
 
-Eigen::Matrix<double, -1, 1> qce::utils::convertAmplitudes2Probs(qce::DynamicQubitState qState) {
+Eigen::Matrix<double, -1, 1> qce::utils::convertAmplitudes2Probs(const qce::DynamicQubitState &qState) {
     Eigen::Matrix<double, -1, 1> probs(qState.size());
 
     for (Eigen::Index i = 0; i < qState.size(); i++) {
@@ -0,0 +1,231 @@
+#include <cassert>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "QubitEnv.hpp"
+#include "Simulator.hpp"
+#include "BatchSimulator.hpp"
+#include "InterleavedSimulator.hpp"
+#include "QubitConsts.hpp"
+
+const double GATE_EQ_PRECISION = 1e-5;
+
+qce::QubitEnv make_job(std::size_t qubits, std::size_t seed) {
+    qce::QubitEnv env(qubits, seed % 2 == 0 ? qce::qubitconsts::zero_basis_state : qce::qubitconsts::plus_basis_state);
+    for (std::size_t i = 0; i < qubits; i++) {
+        env.hadamard(i);
+    }
+    for (std::size_t step = 0; step < 3 * qubits; step++) {
+        std::size_t target = (seed + 5 * step) % qubits;
+        std::size_t control = (target + 1 + step % (qubits - 1)) % qubits;
+        switch ((seed + step) % 6) {
+            case 0: env.cnot(target, control); break;
+            case 1: env.y(target); break;
+            case 2: env.cz(target, control); break;
+            case 3: env.swap(target, control); break;
+            case 4: env.cs(target, control); break;
+            default: env.s(target); env.hadamard(control); break;
+        }
+    }
+
+    return env;
+}
+
+std::vector<qce::QubitEnv> mixed_batch() {
+    // many tiny circuits with a few big ones among them
+    std::vector<qce::QubitEnv> jobs;
+    for (std::size_t i = 0; i < 60; i++) {
+        jobs.push_back(make_job(i % 10 == 7 ? 13 : 2 + i % 6, i));
+    }
+
+    return jobs;
+}
+
+void batch_futures_test() {
+    std::vector<qce::QubitEnv> jobs = mixed_batch();
+    qce::simulator::SimpleSimulator sim;
+
+    qce::simulator::BatchSimulator batch(4, 10);
+    assert(batch.threadsFor(6) == 1);
+    assert(batch.threadsFor(11) == 2);
+    assert(batch.threadsFor(13) == 4);
+
+    auto futures = batch.submit(jobs);
+    assert(futures.size() == jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        auto expected = sim.constructSolution(jobs[i]).getResult();
+        assert(futures[i].get().getResult().isApprox(expected, GATE_EQ_PRECISION));
+    }
+
+    // second batch runs on the same warmed-up workers
+    auto solutions = batch.run(jobs);
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        auto expected = sim.constructSolution(jobs[i]).getResult();
+        assert(solutions[i].getResult().isApprox(expected, GATE_EQ_PRECISION));
+    }
+
+    auto statistics = batch.getStatistics();
+    assert(statistics.completedJobs == 2 * jobs.size());
+    assert(statistics.parallelJobs == 12);
+}
+
+void batch_callback_test() {
+    std::vector<qce::QubitEnv> jobs = mixed_batch();
+    qce::simulator::SimpleSimulator sim;
+
+    std::mutex mutex;
+    std::vector<std::size_t> finished;
+    std::vector<bool> isCorrect(jobs.size(), false);
+
+    qce::simulator::BatchSimulator batch(3, 10);
+    batch.submit(jobs, [&](std::size_t job, qce::simulator::Solution &&solution) {
+        bool correct = solution.getResult().isApprox(sim.constructSolution(jobs[job]).getResult(), GATE_EQ_PRECISION);
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(job);
+        isCorrect[job] = correct;
+    }).get();
+
+    assert(finished.size() == jobs.size());
+    for (bool correct: isCorrect) {
+        assert(correct);
+    }
+
+    // empty batch is done at once
+    batch.submit({}, [](std::size_t, qce::simulator::Solution &&) {}).get();
+
+    // the first error is passed to future, the rest of batch still runs
+    std::size_t calls = 0;
+    bool isThrown = false;
+    try {
+        batch.submit(mixed_batch(), [&](std::size_t job, qce::simulator::Solution &&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            calls++;
+            if (job == 3) {
+                throw std::runtime_error("callback failed");
+            }
+        }).get();
+    } catch (const std::runtime_error &) {
+        isThrown = true;
+    }
+    assert(isThrown);
+    assert(calls == jobs.size());
+}
+
+void batch_single_job_test() {
+    qce::simulator::SimpleSimulator sim;
+    qce::simulator::BatchSimulator batch(2, 4);
+
+    qce::QubitEnv env = make_job(9, 1);
+    assert(batch.constructSolution(env).getResult().isApprox(sim.constructSolution(env).getResult(), GATE_EQ_PRECISION));
+    assert(batch.getStatistics().parallelJobs == 1);
+
+    qce::QubitEnv eager = make_job(5, 2);
+    eager.enableEagerExecution();
+    assert(batch.constructSolution(eager).getResult().isApprox(eager.getLiveState(), GATE_EQ_PRECISION));
+}
+
+void interleaved_simulator_test() {
+    // the same gates over different initial states
+    const std::vector<qce::QubitState> basis = {
+        qce::qubitconsts::zero_basis_state, qce::qubitconsts::one_basis_state,
+        qce::qubitconsts::plus_basis_state, qce::qubitconsts::minus_basis_state
+    };
+    std::vector<qce::QubitEnv> envs;
+    for (std::size_t i = 0; i < 37; i++) {
+        std::vector<qce::Qubit> qubits;
+        for (std::size_t q = 0; q < 6; q++) {
+            qubits.emplace_back(basis[(i + q * q) % basis.size()]);
+        }
+        qce::QubitEnv env(qubits);
+        env.hadamard(0); env.cnot(3, 0); env.y(5); env.cz(1, 4); env.swap(2, 5); env.cs(4, 0);
+        env.x(3); env.z(1); env.s(2); env.cnot(0, 5); env.hadamard(4); env.swap(0, 3);
+        envs.push_back(env);
+    }
+
+    qce::simulator::SimpleSimulator sim;
+    for (std::size_t width: {1, 8, 64}) {
+        qce::simulator::InterleavedSimulator interleaved(width);
+        auto solutions = interleaved.constructSolutions(envs);
+        assert(solutions.size() == envs.size());
+        for (std::size_t i = 0; i < envs.size(); i++) {
+            assert(solutions[i].getResult().isApprox(sim.constructSolution(envs[i]).getResult(), GATE_EQ_PRECISION));
+        }
+    }
+
+    // whole batch as one interleaved state
+    std::vector<std::vector<qce::QubitState>> initialStates;
+    for (const qce::QubitEnv &env: envs) {
+        initialStates.push_back(env.provideExecutionArgs().getInitialStates());
+    }
+    qce::simulator::InterleavedSimulator interleaved;
+    auto state = interleaved.run(envs[0], initialStates);
+    assert(state.getBatch() == envs.size());
+    assert(state.extract(20).isApprox(sim.constructSolution(envs[20]).getResult(), GATE_EQ_PRECISION));
+
+    // circuits with different gates are rejected
+    envs[5].hadamard(2);
+    bool isRejected = false;
+    try {
+        interleaved.constructSolutions(envs);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+}
+
+void interleaved_operands_test() {
+    // the same qubits of gates, angles of operands differ per circuit
+    std::vector<qce::QubitEnv> envs;
+    for (std::size_t i = 0; i < 11; i++) {
+        const double angle = 0.3 * (i + 1);
+        qce::QubitEnv env(5, i % 2 == 0 ? qce::qubitconsts::zero_basis_state : qce::qubitconsts::plus_basis_state);
+        env.hadamard(0); env.hadamard(2); env.hadamard(4);
+        env.mcx(1, {0, 2});
+        env.mcphase(3, {1, 4}, angle);
+        env.mcz(4, {0, 1});
+        env.mcswap(0, 3, {2});
+        qce::QubitMat_t rotation;
+        rotation << std::cos(angle), -std::sin(angle), std::sin(angle), std::cos(angle);
+        env.mcu(2, {0}, rotation);
+        qce::DynamicQubitMat_t phases = qce::DynamicQubitMat_t::Zero(4, 4);
+        for (Eigen::Index d = 0; d < 4; d++) {
+            phases(d, d) = std::polar(1.0, angle * d);
+        }
+        env.unitary(phases, {1, 3});
+        env.pauliExp("XZY", {0, 2, 4}, angle);
+        env.qft({1, 2, 3});
+        env.groverDiffusion({0, 4});
+        envs.push_back(env);
+    }
+
+    qce::simulator::SimpleSimulator sim;
+    for (std::size_t width: {1, 4, 16}) {
+        qce::simulator::InterleavedSimulator interleaved(width);
+        auto solutions = interleaved.constructSolutions(envs);
+        for (std::size_t i = 0; i < envs.size(); i++) {
+            assert(solutions[i].getResult().isApprox(sim.constructSolution(envs[i]).getResult(), GATE_EQ_PRECISION));
+        }
+    }
+
+    // different qubits of multi-controlled gate are rejected
+    for (std::size_t i = 0; i < envs.size(); i++) {
+        envs[i].mcx(0, {i == 4 ? std::size_t(2) : std::size_t(1)});
+    }
+    bool isRejected = false;
+    try {
+        qce::simulator::InterleavedSimulator().constructSolutions(envs);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+}
+
+int main() {
+    batch_futures_test();
+    batch_callback_test();
+    batch_single_job_test();
+    interleaved_simulator_test();
+    interleaved_operands_test();
+}
@@ -3,6 +3,7 @@
 
 #include "OperationGraph.hpp"
 #include "OperationArgs.hpp"
+#include "GateKernels.hpp"
 
 const double GATE_EQ_PRECISION = 1e-5;
 
@@ -115,6 +116,67 @@ void chain_multiple_hadamard_test() {
     assert(result2.result.isApprox(answer, GATE_EQ_PRECISION));
 }
 
+void gate_record_facade_test() {
+    std::vector<std::size_t> qubitPositions = {2, 0, 1};
+    std::vector<std::size_t> controlQubits = {0};
+    qce::operations::CnotGate gate(controlQubits, 2, qubitPositions);
+
+    auto record = gate.getRecord();
+    assert(record.kind == qce::operations::GateKind::Cnot);
+    assert(record.target == 0 && record.control == 1);
+
+    // facade in natural order over record is the same operation
+    auto facade = qce::operations::makeGateOperation(record, 3);
+    assert(facade->constructOperation().isApprox(gate.constructOperation(), GATE_EQ_PRECISION));
+    assert(facade->getRecord() == record);
+}
+
+void kernels_match_facades_test() {
+    using qce::operations::GateKind;
+    using qce::operations::GateRecord;
+    const std::size_t n = 4;
+    qce::DynamicQubitState state = qce::DynamicQubitState::Random(1 << n);
+    qce::kernels::BitLayout layout(n);
+
+    std::vector<GateRecord> records = {
+        GateRecord(GateKind::Hadamard, 2), GateRecord(GateKind::X, 0), GateRecord(GateKind::Y, 3),
+        GateRecord(GateKind::Z, 1), GateRecord(GateKind::S, 2), GateRecord(GateKind::Cnot, 1, 3),
+        GateRecord(GateKind::Cnot, 3, 0), GateRecord(GateKind::Swap, 0, 2), GateRecord(GateKind::CZ, 3, 1),
+        GateRecord(GateKind::CPhase, 0, 2)
+    };
+
+    for (const GateRecord &record: records) {
+        qce::DynamicQubitState expected = qce::operations::makeGateOperation(record, n)->constructOperation() * state;
+        qce::kernels::applyGate(state, record, layout);
+        assert(state.isApprox(expected, GATE_EQ_PRECISION));
+    }
+}
+
+void layout_qubit_order_test() {
+    // facade with qubit order of permuted layout is the same operation as kernel over that layout
+    qce::kernels::BitLayout layout(3);
+    layout.swapQubits(0, 2);
+    qce::DynamicQubitState state = qce::DynamicQubitState::Random(8);
+
+    std::vector<std::size_t> controlQubits = {0};
+    qce::operations::CnotGate gate(controlQubits, 1, layout.getQubitOrder());
+    qce::DynamicQubitState expected = gate.constructOperation() * state;
+
+    qce::kernels::applyGate(state, qce::operations::GateRecord(qce::operations::GateKind::Cnot, 1, 0), layout);
+    assert(state.isApprox(expected, GATE_EQ_PRECISION));
+}
+
+void wide_index_test() {
+    // indices of states above 32 qubits don't fit into 32 bits
+    const uint64_t value = (uint64_t(1) << 40) | (uint64_t(1) << 33) | 5;
+    assert(qce::kernels::insertZeroBit(value, 35) == ((uint64_t(1) << 41) | (uint64_t(1) << 33) | 5));
+    assert(qce::kernels::insertZeroBit(value, 0) == ((uint64_t(1) << 41) | (uint64_t(1) << 34) | 10));
+
+    qce::kernels::BitLayout layout(34);
+    assert(layout.bitOf(0) == 33);
+    assert(layout.qubitAt(33) == 0);
+}
+
 int main() {
     // hadamard_gate_test();
     cnot_gate_test();
@@ -122,4 +184,8 @@ int main() {
     cz_gate_test();
     cphase_gate_test();
     chain_multiple_hadamard_test();
+    gate_record_facade_test();
+    kernels_match_facades_test();
+    layout_qubit_order_test();
+    wide_index_test();
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <cassert>
+#include <vector>
+
+#include "QubitEnv.hpp"
+#include "DependencyGraph.hpp"
+#include "QubitConsts.hpp"
+#include "Simulator.hpp"
+
+const double GATE_EQ_PRECISION = 1e-5;
+
+using qce::operations::GateKind;
+using qce::operations::GateRecord;
+
+void commutation_test() {
+    using qce::operations::commutes;
+
+    assert(commutes(GateRecord(GateKind::Z, 0), GateRecord(GateKind::CZ, 1, 0)));
+    assert(commutes(GateRecord(GateKind::S, 1), GateRecord(GateKind::Cnot, 0, 1)));
+    assert(commutes(GateRecord(GateKind::X, 0), GateRecord(GateKind::Cnot, 0, 1)));
+    assert(commutes(GateRecord(GateKind::Cnot, 2, 0), GateRecord(GateKind::Cnot, 1, 0)));
+    assert(commutes(GateRecord(GateKind::Hadamard, 0), GateRecord(GateKind::Hadamard, 0)));
+    assert(commutes(GateRecord(GateKind::Swap, 0, 1), GateRecord(GateKind::Swap, 1, 0)));
+    assert(commutes(GateRecord(GateKind::Hadamard, 0), GateRecord(GateKind::X, 1)));
+
+    assert(!commutes(GateRecord(GateKind::X, 0), GateRecord(GateKind::Z, 0)));
+    assert(!commutes(GateRecord(GateKind::Z, 0), GateRecord(GateKind::Cnot, 0, 1)));
+    assert(!commutes(GateRecord(GateKind::Cnot, 1, 0), GateRecord(GateKind::Cnot, 0, 1)));
+    assert(!commutes(GateRecord(GateKind::Hadamard, 0), GateRecord(GateKind::Z, 0)));
+    assert(!commutes(GateRecord(GateKind::Y, 1), GateRecord(GateKind::CZ, 0, 1)));
+}
+
+void dependency_graph_test() {
+    qce::QubitEnv env(4, qce::qubitconsts::zero_basis_state);
+    env.hadamard(0);     // 0, layer 0
+    env.hadamard(1);     // 1, layer 0
+    env.cnot(1, 0);      // 2, layer 1
+    env.x(3);            // 3, layer 0
+    env.cz(2, 3);        // 4, layer 1
+    env.swap(1, 2);      // 5, layer 2
+    env.z(0);            // 6, layer 2
+
+    auto dag = env.getDependencyGraph();
+    assert(dag.size() == 7);
+    assert(dag.getDepth() == 3);
+    assert(dag.getLayer(2) == 1 && dag.getLayer(4) == 1 && dag.getLayer(5) == 2);
+    assert((dag.getPredecessors(2) == std::vector<std::size_t>{1, 0}));
+    assert((dag.getSuccessors(2) == std::vector<std::size_t>{5, 6}));
+    assert((dag.getPredecessors(5) == std::vector<std::size_t>{2, 4}));
+    assert(dag.getPredecessors(0).empty() && dag.getSuccessors(6).empty());
+
+    std::vector<std::size_t> visited;
+    dag.forEachLayer([&](const std::vector<std::size_t> &layer) {
+        // gates of one layer act on disjoint qubits
+        std::vector<bool> used(4, false);
+        for (std::size_t index: layer) {
+            qce::operations::forEachGateQubit(dag.getGate(index), [&](uint32_t qubit) {
+                assert(!used[qubit]);
+                used[qubit] = true;
+            });
+            visited.push_back(index);
+        }
+    });
+    assert(visited.size() == 7);
+
+    auto statistics = dag.getStatistics();
+    assert(statistics.gateCount == 7 && statistics.multiQubitGateCount == 3);
+    assert(statistics.depth == 3 && statistics.maxLayerWidth == 3);
+}
+
+void fill_redundant_circuit(qce::QubitEnv &env) {
+    env.hadamard(0); env.hadamard(1);
+    env.hadamard(0);                    // cancels with first H(0)
+    env.x(2); env.cnot(1, 0); env.z(0); env.cnot(1, 0);  // Z on control commutes with CNOTs, CNOTs cancel
+    env.x(2);                           // cancels with X(2) across CNOTs on other qubits
+    env.s(3); env.s(3); env.s(3); env.s(3);              // S^4
+    env.cz(0, 3); env.z(3); env.cz(3, 0);                // adjacent CZs separated by diagonal gate
+    env.cs(1, 2); env.cs(2, 1);                          // merged into CZ
+    env.swap(1, 3); env.hadamard(0); env.swap(3, 1);
+    env.y(2);
+}
+
+void peephole_optimizer_test() {
+    qce::QubitEnv env(4, qce::qubitconsts::plus_basis_state);
+    qce::QubitEnv reference(4, qce::qubitconsts::plus_basis_state);
+    fill_redundant_circuit(env);
+    fill_redundant_circuit(reference);
+
+    std::size_t before = env.provideExecutionArgs().getNodes().size();
+    auto report = env.optimize();
+    std::size_t after = env.provideExecutionArgs().getNodes().size();
+    assert(report.gatesBefore == before && report.gatesAfter == after);
+    // left: H(1), Z(0), Z(3), CZ(1, 2), H(0), Y(2)
+    assert(after == 6);
+    assert(report.removedGates() == before - 6);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(reference).getResult();
+    assert(sim.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    // optimization is idempotent
+    auto second = env.optimize();
+    assert(second.removedGates() == 0 && env.provideExecutionArgs().getNodes().size() == after);
+}
+
+void optimizer_respects_commutation_test() {
+    std::vector<GateRecord> gates = {
+        GateRecord(GateKind::Hadamard, 0), GateRecord(GateKind::Z, 0), GateRecord(GateKind::Hadamard, 0),
+        GateRecord(GateKind::Cnot, 1, 0), GateRecord(GateKind::X, 0), GateRecord(GateKind::Cnot, 1, 0)
+    };
+    auto report = qce::operations::optimizeGates(gates);
+    assert(report.removedGates() == 0 && gates.size() == 6);
+}
+
+void multi_controlled_optimizer_test() {
+    qce::QubitEnv env(5, qce::qubitconsts::plus_basis_state);
+    qce::QubitEnv reference(5, qce::qubitconsts::plus_basis_state);
+    for (qce::QubitEnv *circuit: {&env, &reference}) {
+        circuit->hadamard(4);
+        circuit->toffoli(3, 0, 1);
+        circuit->z(0);                          // diagonal on control commutes with Toffoli
+        circuit->mcx(3, {1, 0});                // the same controls in other order, cancels
+        circuit->mcswap(2, 4, {0});
+        circuit->mcswap(4, 2, {0});             // cancels, targets are swapped
+        circuit->mcz(1, {2, 3});
+        circuit->mcphase(0, {1}, 0.3);
+    }
+
+    auto report = env.optimize();
+    assert(report.cancelledPairs == 2);
+    assert(env.provideExecutionArgs().getNodes().size() == 4);
+
+    qce::simulator::SimpleSimulator sim;
+    assert(sim.constructSolution(env).getResult().isApprox(sim.constructSolution(reference).getResult(), GATE_EQ_PRECISION));
+
+    // X on control of Toffoli doesn't commute with it
+    qce::QubitEnv blocked(3, qce::qubitconsts::zero_basis_state);
+    blocked.toffoli(2, 0, 1); blocked.x(0); blocked.toffoli(2, 0, 1);
+    assert(blocked.optimize().removedGates() == 0);
+}
+
+int main() {
+    commutation_test();
+    dependency_graph_test();
+    peephole_optimizer_test();
+    multi_controlled_optimizer_test();
+    optimizer_respects_commutation_test();
+}
@@ -0,0 +1,150 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include "QasmParser.hpp"
+#include "QubitEnv.hpp"
+#include "Simulator.hpp"
+#include "QubitConsts.hpp"
+
+const double GATE_EQ_PRECISION = 1e-5;
+
+const char *PROGRAM =
+    "OPENQASM 2.0;\n"
+    "include \"qelib1.inc\";\n"
+    "// two registers are numbered consecutively\n"
+    "qreg a[2];\n"
+    "qreg b[3];\n"
+    "creg c[2];\n"
+    "creg d[3];\n"
+    "h a;          // broadcast over register\n"
+    "cx a[0], b[1];\n"
+    "x b[2]; y a[1];\n"
+    "cz b[1],a[1];\n"
+    "barrier a, b;\n"
+    "swap a[0], b[0];\n"
+    "s b;\n"
+    "z  a[0] ;\n"
+    "cx a, b[0];\n"
+    "measure a[1] -> c[1];\n"
+    "measure b -> d;\n";
+
+qce::DynamicQubitState expectedProgramState() {
+    // the same program written through QubitEnv, qubits of b are 2..4
+    qce::QubitEnv env(5, qce::qubitconsts::zero_basis_state);
+    env.hadamard(0); env.hadamard(1);
+    env.cnot(3, 0);
+    env.x(4); env.y(1);
+    env.cz(1, 3);
+    env.swap(0, 2);
+    env.s(2); env.s(3); env.s(4);
+    env.z(0);
+    env.cnot(2, 0); env.cnot(2, 1);
+
+    qce::simulator::SimpleSimulator sim;
+    return sim.constructSolution(env).getResult();
+}
+
+void parse_stream_test() {
+    auto expected = expectedProgramState();
+
+    // tiny buffers cut every statement and token and make buffer grow
+    for (std::size_t bufferBytes: {1, 7, 64, 1 << 20}) {
+        std::istringstream input(PROGRAM);
+        qce::qasm::QasmEnvBuilder builder;
+        qce::qasm::parseQasm(input, builder, bufferBytes);
+
+        qce::simulator::SimpleSimulator sim;
+        assert(sim.constructSolution(builder.getEnv()).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+        const auto &measurements = builder.getMeasurements();
+        assert(measurements.size() == 4);
+        assert(measurements[0] == std::make_pair(std::size_t(1), std::size_t(1)));
+        assert(measurements[3] == std::make_pair(std::size_t(4), std::size_t(4)));
+    }
+}
+
+void parse_file_streaming_test() {
+    const char *directory = std::getenv("TMPDIR");
+    const std::string path = std::string(directory != nullptr ? directory : "/tmp") +
+        "/qce-program-" + std::to_string(getpid()) + ".qasm";
+    {
+        std::ofstream file(path);
+        file << PROGRAM;
+    }
+
+    // eager environment applies gates while file is parsed
+    qce::qasm::QasmEnvBuilder builder(true, 4);
+    qce::qasm::parseQasmFile(path, builder);
+    assert(builder.getEnv().getExecutionMode() == qce::ExecutionMode::Eager);
+    assert(builder.getEnv().getLiveState().isApprox(expectedProgramState(), GATE_EQ_PRECISION));
+
+    std::remove(path.c_str());
+}
+
+void toffoli_test() {
+    for (std::size_t input = 0; input < 8; input++) {
+        std::string program = "OPENQASM 2.0;\nqreg q[3];\n";
+        for (std::size_t qubit = 0; qubit < 3; qubit++) {
+            if ((input >> (2 - qubit)) & 1) {
+                program += "x q[" + std::to_string(qubit) + "];\n";
+            }
+        }
+        program += "ccx q[0], q[1], q[2];\n";
+
+        std::istringstream stream(program);
+        qce::qasm::QasmEnvBuilder builder;
+        qce::qasm::parseQasm(stream, builder);
+
+        qce::simulator::SimpleSimulator sim;
+        auto result = sim.constructSolution(builder.getEnv()).getResult();
+        std::size_t output = (input & 6) == 6 ? input ^ 1 : input;
+        assert(std::abs(result[(Eigen::Index)output] - 1.) < GATE_EQ_PRECISION);
+    }
+}
+
+std::size_t errorLine(const std::string &program) {
+    std::istringstream stream(program);
+    qce::qasm::QasmEnvBuilder builder;
+    try {
+        qce::qasm::parseQasm(stream, builder, 5);
+    } catch (const qce::qasm::QasmError &error) {
+        return error.getLine();
+    }
+
+    return 0;
+}
+
+void errors_test() {
+    assert(errorLine("qreg q[2];\nh q[0];\nrx(0.5) q[1];\n") == 3);
+    assert(errorLine("qreg q[2];\n\nh q[2];\n") == 3);
+    assert(errorLine("qreg q[2];\ncx q[0], q[0];\n") == 2);
+    assert(errorLine("qreg q[2];\nh q[0]") == 2);
+    assert(errorLine("include \"other.inc\";\n") == 1);
+    assert(errorLine("qreg q[2];\nh q[0];\nqreg r[1];\n") == 3);
+    assert(errorLine("qreg q[2];\nqreg r[3];\ncx q, r;\n") == 3);
+    assert(errorLine("qreg q[2];\n// comment only\nh q;") == 0);
+
+    // registers without gates still declare qubits, which stay in initial state
+    for (const char *program: {"qreg q[2];\ncreg c[2];\n", "qreg q[1];\nqreg r[1];\nbarrier q, r;\n"}) {
+        assert(errorLine(program) == 0);
+        std::istringstream stream(program);
+        qce::qasm::QasmEnvBuilder builder;
+        qce::qasm::parseQasm(stream, builder, 3);
+
+        qce::simulator::SimpleSimulator sim;
+        auto result = sim.constructSolution(builder.getEnv()).getResult();
+        assert(result.isApprox((qce::DynamicQubitState(4) << 1, 0, 0, 0).finished(), GATE_EQ_PRECISION));
+    }
+}
+
+int main() {
+    parse_stream_test();
+    parse_file_streaming_test();
+    toffoli_test();
+    errors_test();
+}
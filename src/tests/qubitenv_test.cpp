@@ -1,10 +1,29 @@
 #include <cassert>
 #include <iostream>
 #include <complex>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "QubitEnv.hpp"
 #include "OperationGraph.hpp"
 #include "Simulator.hpp"
+#include "QubitRemapping.hpp"
+#include "BlockedExecution.hpp"
+#include "ParallelSimulator.hpp"
+#include "ChunkedExecution.hpp"
+#include "ResumableSimulator.hpp"
+#include "CircuitFormat.hpp"
+#include "PrefixCache.hpp"
+#include "ResultCache.hpp"
+#include "HybridSimulator.hpp"
+#include "SparseSimulator.hpp"
+#include "ReversibleSimulator.hpp"
 #include "QubitConsts.hpp"
 #include "Qubit.h"
 
@@ -164,6 +183,34 @@ void qubit_env_cz_test() {
     assert(sol.getResult().isApprox(idealResult, GATE_EQ_PRECISION));
 }
 
+void qubit_env_invalid_qubits_test() {
+    // qubits out of environment or shared by both operands are rejected before gate is stored
+    std::size_t rejected = 0;
+    for (auto add: std::vector<std::function<void(qce::QubitEnv&)>>{
+        [](qce::QubitEnv &e) { e.hadamard(3); },
+        [](qce::QubitEnv &e) { e.x(std::size_t(1) << 32); },
+        [](qce::QubitEnv &e) { e.s(7); },
+        [](qce::QubitEnv &e) { e.cnot(1, 1); },
+        [](qce::QubitEnv &e) { e.swap(2, 2); },
+        [](qce::QubitEnv &e) { e.cz(0, 3); },
+        [](qce::QubitEnv &e) { e.cs(5, 1); }
+    }) {
+        for (bool isEager: {false, true}) {
+            qce::QubitEnv invalid(3, qce::qubitconsts::zero_basis_state);
+            if (isEager) {
+                invalid.enableEagerExecution(4);
+            }
+            try {
+                add(invalid);
+            } catch (const std::invalid_argument &) {
+                rejected++;
+            }
+            assert(invalid.provideExecutionArgs().getNodes().empty());
+        }
+    }
+    assert(rejected == 14);
+}
+
 void simulator_solution_test() {
     qce::QubitEnv env(4, qce::qubitconsts::zero_basis_state);
     env.y(1); env.hadamard(1); env.hadamard(2); env.cz(0, 1); env.y(1); env.hadamard(3);
@@ -179,6 +226,1307 @@ void simulator_solution_test() {
     }
 }
 
+void fill_mixed_circuit(qce::QubitEnv &env) {
+    env.y(1); env.hadamard(1); env.hadamard(2); env.cz(0, 1); env.y(1); env.hadamard(3);
+    env.hadamard(0); env.x(0); env.x(2); env.hadamard(1); env.x(1); env.s(1); env.cs(0, 3);
+    env.hadamard(3); env.cz(3, 2); env.y(1); env.cz(2, 0); env.hadamard(2); env.z(2);
+    env.cnot(1, 3); env.swap(0, 2); env.s(0); env.hadamard(0);
+}
+
+void qubit_env_eager_test() {
+    qce::QubitEnv deferred(4, qce::qubitconsts::zero_basis_state);
+    fill_mixed_circuit(deferred);
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(deferred).getResult();
+
+    for (std::size_t window: {0, 1, 4, 64}) {
+        qce::QubitEnv eager(4, qce::qubitconsts::zero_basis_state);
+        eager.enableEagerExecution(window);
+        fill_mixed_circuit(eager);
+
+        assert(eager.getExecutionMode() == qce::ExecutionMode::Eager);
+        assert(eager.provideExecutionArgs().getNodes().empty());
+        // buffered gates are applied only by flush, const getters never write live state
+        bool isRejected = false;
+        try {
+            eager.getLiveState();
+        } catch (const std::logic_error &) {
+            isRejected = true;
+        }
+        assert(isRejected == eager.hasPendingGates() && isRejected == (window > 0));
+        eager.flush();
+        assert(!eager.hasPendingGates());
+        assert(eager.getLiveState().isApprox(expected, GATE_EQ_PRECISION));
+        assert(sim.constructSolution(eager).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    }
+
+    // gates added before switching are applied to live state
+    qce::QubitEnv switched(4, qce::qubitconsts::zero_basis_state);
+    switched.y(1); switched.hadamard(1); switched.hadamard(2);
+    switched.enableEagerExecution(2);
+    switched.cz(0, 1); switched.y(1); switched.hadamard(3);
+    switched.hadamard(0); switched.x(0); switched.x(2); switched.hadamard(1); switched.x(1); switched.s(1); switched.cs(0, 3);
+    switched.hadamard(3); switched.cz(3, 2); switched.y(1); switched.cz(2, 0); switched.hadamard(2); switched.z(2);
+    switched.cnot(1, 3); switched.swap(0, 2); switched.s(0); switched.hadamard(0);
+    switched.flush();
+    assert(switched.getLiveState().isApprox(expected, GATE_EQ_PRECISION));
+}
+
+void qubit_env_incremental_test() {
+    qce::QubitEnv expected(4, qce::qubitconsts::zero_basis_state);
+    fill_mixed_circuit(expected);
+    const std::size_t gatesCount = expected.provideExecutionArgs().getNodes().size();
+
+    // simulators compute fresh state and keep nothing in environment
+    qce::QubitEnv env(4, qce::qubitconsts::zero_basis_state);
+    qce::simulator::SimpleSimulator sim;
+    env.y(1); env.hadamard(1);
+    sim.constructSolution(env);
+    assert(env.getComputedGatesCount() == 0);
+
+    // gates are appended one by one and state is computed after each of them
+    env.computeStateIncrementally();
+    assert(env.getComputedGatesCount() == 2);
+    env.hadamard(2); env.cz(0, 1); env.y(1); env.hadamard(3);
+    env.hadamard(0); env.x(0); env.x(2); env.hadamard(1); env.x(1); env.s(1); env.cs(0, 3);
+    env.hadamard(3); env.cz(3, 2); env.y(1); env.cz(2, 0); env.hadamard(2); env.z(2);
+    env.cnot(1, 3); env.swap(0, 2); env.s(0); env.hadamard(0);
+    assert(env.computeStateIncrementally().isApprox(expected.computeState(), GATE_EQ_PRECISION));
+    assert(env.getComputedGatesCount() == gatesCount);
+    qce::QubitEnv released = env;
+    released.releaseComputedState();
+    assert(released.getComputedGatesCount() == 0 && env.getComputedGatesCount() == gatesCount);
+
+    // removing gate after computed state keeps it, removing earlier gate drops it
+    env.x(3); env.x(3);
+    env.computeStateIncrementally();
+    env.x(1);
+    env.removeGate(gatesCount + 2);
+    assert(env.getComputedGatesCount() == gatesCount + 2);
+    env.removeGate(gatesCount + 1);
+    assert(env.getComputedGatesCount() == 0);
+    env.removeGate(gatesCount);
+    assert(env.computeStateIncrementally().isApprox(expected.computeState(), GATE_EQ_PRECISION));
+
+    // the same initial state keeps computed state, another one drops it
+    env.changeState(2, qce::qubitconsts::zero_basis_state);
+    assert(env.getComputedGatesCount() == gatesCount);
+    env.changeState(2, qce::qubitconsts::one_basis_state);
+    assert(env.getComputedGatesCount() == 0);
+    expected.changeState(2, qce::qubitconsts::one_basis_state);
+    assert(env.computeStateIncrementally().isApprox(expected.computeState(), GATE_EQ_PRECISION));
+
+    // optimization drops state only when it changes computed gates
+    env.x(3); env.x(3);
+    env.computeStateIncrementally();
+    env.optimize();
+    assert(env.getComputedGatesCount() == 0);
+    assert(env.computeStateIncrementally().isApprox(expected.computeState(), GATE_EQ_PRECISION));
+
+    // switching to eager mode starts from computed state
+    env.hadamard(1);
+    env.enableEagerExecution();
+    expected.hadamard(1);
+    assert(env.getLiveState().isApprox(expected.computeState(), GATE_EQ_PRECISION));
+}
+
+void remapping_simulator_test() {
+    qce::QubitEnv env(6, qce::qubitconsts::zero_basis_state);
+    for (std::size_t i = 0; i < 6; i++) {
+        env.hadamard(i);
+    }
+    env.cnot(0, 5); env.s(0); env.cz(1, 4); env.y(2); env.swap(0, 3); env.cs(5, 1);
+    env.x(4); env.cnot(2, 0); env.hadamard(5); env.swap(4, 1); env.z(3); env.cnot(5, 2);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    // only two low bits are "cache resident", so almost every gate needs remapping
+    qce::simulator::RemappingSimulator remapping(2, 4);
+    auto result = remapping.constructSolution(env).getResult();
+    assert(result.isApprox(expected, GATE_EQ_PRECISION));
+    assert(remapping.getStatistics().remaps > 0);
+
+    // when every qubit fits, layout never changes
+    qce::simulator::RemappingSimulator wide(6, 4);
+    assert(wide.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(wide.getStatistics().remaps == 0);
+}
+
+void blocked_simulator_test() {
+    qce::QubitEnv env(6, qce::qubitconsts::zero_basis_state);
+    for (std::size_t i = 0; i < 6; i++) {
+        env.hadamard(i);
+    }
+    // qubits 3..5 are stored at three low bits
+    env.cnot(4, 5); env.s(3); env.cz(5, 3); env.y(4);
+    env.cnot(0, 5);
+    env.swap(3, 4); env.cs(5, 4); env.x(3);
+    env.hadamard(1);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    qce::simulator::BlockedSimulator blocked(3);
+    assert(blocked.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    // H(3..5) + four gates, then three gates
+    assert(blocked.getStatistics().blockedRuns == 2);
+    assert(blocked.getStatistics().blockedGates == 10);
+    assert(blocked.getStatistics().sweeps == 7);
+
+    // tile bigger than state
+    qce::simulator::BlockedSimulator whole(10);
+    assert(whole.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(whole.getStatistics().sweeps == 1);
+}
+
+void parallel_simulator_test() {
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 8; i++) {
+        qubits.emplace_back(i % 3 == 0 ? qce::qubitconsts::plus_basis_state : qce::qubitconsts::zero_basis_state);
+    }
+    qce::QubitEnv env(qubits);
+    env.hadamard(7); env.cnot(1, 0); env.swap(2, 7); env.cz(6, 3); env.y(4); env.cs(5, 0);
+    env.x(7); env.cnot(0, 6); env.hadamard(2); env.s(1); env.swap(0, 5);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    for (std::size_t threads: {1, 3, 4, 64}) {
+        qce::simulator::ParallelSimulator parallel(threads);
+        assert(parallel.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+        auto placement = parallel.getPlacementStatistics();
+        assert(placement.numaNodes >= 1);
+        assert(placement.localPages + placement.remotePages + placement.unknownPages > 0);
+    }
+
+    // failed worker cancels barrier, so the others don't wait for it forever
+    qce::simulator::ThreadBarrier barrier(3);
+    bool passed[2] = {false, false};
+    std::vector<std::thread> waiting;
+    for (std::size_t i = 0; i < 2; i++) {
+        waiting.emplace_back([&, i]() {
+            passed[i] = barrier.wait();
+            while (barrier.wait()) {}
+        });
+    }
+    assert(barrier.wait());
+    barrier.cancel();
+    for (std::thread &thread: waiting) {
+        thread.join();
+    }
+    assert(passed[0] && passed[1] && !barrier.wait());
+}
+
+void out_of_core_simulator_test() {
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 7; i++) {
+        qubits.emplace_back(i % 2 == 0 ? qce::qubitconsts::plus_basis_state : qce::qubitconsts::zero_basis_state);
+    }
+    qce::QubitEnv env(qubits);
+    // qubits 0..3 select chunk of 2^3 amplitudes
+    env.hadamard(6); env.cnot(5, 6); env.hadamard(1); env.s(4);
+    env.cnot(0, 5); env.cz(3, 2); env.swap(6, 1); env.y(0);
+    env.cs(2, 4); env.x(1); env.hadamard(3); env.swap(0, 6);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    qce::simulator::OutOfCoreSimulator outOfCore("", 3, 4);
+    assert(outOfCore.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    // s(4) is applied in the first pass, before hadamard(1)
+    assert(outOfCore.getStatistics().reorderedGates > 0);
+    assert(outOfCore.getStatistics().swapPasses > 0);
+
+    qce::simulator::ChunkedState state = outOfCore.run(env);
+    assert(state.getChunksCount() == 16);
+    assert(state.load().isApprox(expected, GATE_EQ_PRECISION));
+
+    // chunk bigger than state
+    qce::simulator::OutOfCoreSimulator whole("", 20);
+    assert(whole.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(whole.getStatistics().gatePasses == 1);
+    assert(whole.getStatistics().swapPasses == 0);
+}
+
+void chunked_simulator_test() {
+    qce::QubitEnv env(10, qce::qubitconsts::zero_basis_state);
+    env.hadamard(0);
+    for (std::size_t i = 1; i < 10; i++) {
+        env.cnot(i, i - 1);
+    }
+    env.s(9); env.swap(2, 8); env.y(5); env.cz(0, 7);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    // 64 chunks of 16 amplitudes, every chunk is separate allocation
+    qce::simulator::ChunkedSimulator chunked(4);
+    qce::simulator::ChunkedState state = chunked.run(env);
+    assert(!state.isMapped());
+    assert(state.getChunksCount() == 64);
+    assert(state.load().isApprox(expected, GATE_EQ_PRECISION));
+    assert(std::abs(state[1023] - expected[1023]) < GATE_EQ_PRECISION);
+
+    // long circuit with gates applied out of order and remaps between passes, even without lookahead
+    qce::QubitEnv longEnv(8, qce::qubitconsts::plus_basis_state);
+    for (std::size_t i = 0; i < 300; i++) {
+        std::size_t first = (i * 5) % 8, second = (i * 3 + 1) % 8;
+        if (i % 4 == 0 && first != second) {
+            longEnv.cnot(first, second);
+        } else if (i % 4 == 1) {
+            longEnv.s(first);
+        } else {
+            longEnv.hadamard(second);
+        }
+    }
+    auto longExpected = sim.constructSolution(longEnv).getResult();
+    for (std::size_t lookahead: {0, 3, 256}) {
+        qce::simulator::ChunkedSimulator longChunked(3, lookahead);
+        assert(longChunked.constructSolution(longEnv).getResult().isApprox(longExpected, GATE_EQ_PRECISION));
+    }
+}
+
+/**
+ * GHZ state of 31..34 qubits, takes 32..256 GiB. Runs only when QCE_LARGE_STATE_TESTS is set,
+ * sizes which don't fit into physical memory are skipped.
+*/
+void large_state_test() {
+    if (std::getenv("QCE_LARGE_STATE_TESTS") == nullptr) {
+        return;
+    }
+
+    const uint64_t memory = (uint64_t)sysconf(_SC_PHYS_PAGES) * (uint64_t)sysconf(_SC_PAGESIZE);
+    for (std::size_t n = 31; n <= 34; n++) {
+        const uint64_t size = uint64_t(1) << n;
+        if (size * sizeof(qce::kernels::Amplitude_t) + (memory >> 3) > memory) {
+            std::cout << "large_state_test: skipped " << n << " qubits, not enough memory" << std::endl;
+            continue;
+        }
+
+        qce::QubitEnv env(n, qce::qubitconsts::zero_basis_state);
+        env.hadamard(0);
+        for (std::size_t i = 1; i < n; i++) {
+            env.cnot(i, i - 1);
+        }
+        env.x(n - 1);
+
+        qce::simulator::ChunkedSimulator chunked;
+        qce::simulator::ChunkedState state = chunked.run(env);
+        const double amplitude = qce::qubitconsts::_RSQRROOT_OF_2;
+        // |0..01> and |1..10>
+        assert(std::abs(state[1] - amplitude) < GATE_EQ_PRECISION);
+        assert(std::abs(state[size - 2] - amplitude) < GATE_EQ_PRECISION);
+        assert(std::abs(state[0]) < GATE_EQ_PRECISION);
+        assert(std::abs(state[size >> 1]) < GATE_EQ_PRECISION);
+        assert(std::abs(state[size - 1]) < GATE_EQ_PRECISION);
+    }
+}
+
+void fill_resumable_circuit(qce::QubitEnv &env) {
+    for (std::size_t i = 0; i < 8; i++) {
+        env.hadamard(i);
+    }
+    env.cnot(1, 0); env.s(2); env.cz(3, 4); env.y(5); env.swap(6, 7);
+    env.cs(0, 7); env.x(3); env.cnot(4, 2); env.hadamard(5); env.z(1);
+    env.swap(0, 4); env.cnot(7, 6); env.s(3);
+}
+
+void checkpoint_restore_test() {
+    const char *directory = std::getenv("TMPDIR");
+    const std::string path = std::string(directory != nullptr ? directory : "/tmp") +
+        "/qce-checkpoint-" + std::to_string(getpid());
+
+    qce::QubitEnv env(8, qce::qubitconsts::zero_basis_state);
+    fill_resumable_circuit(env);
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    qce::simulator::ResumableSimulator first;
+    first.seed(42);
+    assert(!first.advance(env, 7));
+    first.checkpoint(path);
+    assert(first.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    qce::simulator::ResumableSimulator second;
+    second.restore(path);
+    assert(second.getPosition() == 7);
+    assert(second.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    // RNG continues where it was checkpointed
+    for (std::size_t i = 0; i < 5; i++) {
+        assert(first.measure() == second.measure());
+    }
+
+    // checkpoint of other circuit
+    qce::QubitEnv other(8, qce::qubitconsts::zero_basis_state);
+    other.hadamard(0);
+    qce::simulator::ResumableSimulator third;
+    third.restore(path);
+    bool isRejected = false;
+    try {
+        third.constructSolution(other);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+
+    // the same gates from other initial states are other circuit, both in memory and after restore
+    qce::QubitEnv ones(8, qce::qubitconsts::one_basis_state);
+    fill_resumable_circuit(ones);
+    auto onesExpected = sim.constructSolution(ones).getResult();
+    assert(first.constructSolution(ones).getResult().isApprox(onesExpected, GATE_EQ_PRECISION));
+    assert(first.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    qce::QubitEnv pair(2, qce::qubitconsts::zero_basis_state), onesPair(2, qce::qubitconsts::one_basis_state);
+    pair.cnot(1, 0); onesPair.cnot(1, 0);
+    qce::simulator::ResumableSimulator reused;
+    assert(reused.constructSolution(pair).getResult().isApprox((qce::DynamicQubitState(4) << 1, 0, 0, 0).finished()));
+    assert(reused.constructSolution(onesPair).getResult().isApprox((qce::DynamicQubitState(4) << 0, 0, 1, 0).finished()));
+    qce::simulator::ResumableSimulator fourth;
+    fourth.restore(path);
+    isRejected = false;
+    try {
+        fourth.constructSolution(ones);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+
+    // damaged amplitude is detected by state checksum
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-3, std::ios::end);
+        file.put('\x7f');
+    }
+    isRejected = false;
+    try {
+        qce::simulator::ResumableSimulator damaged;
+        damaged.restore(path);
+    } catch (const std::runtime_error &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+
+    // checkpoint every 5 gates, the last one is made after gate 20 of 21
+    qce::simulator::ResumableSimulator periodic(path, 5);
+    assert(periodic.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    qce::simulator::ResumableSimulator resumed;
+    resumed.restore(path);
+    assert(resumed.getPosition() == 20);
+    assert(resumed.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    std::remove(path.c_str());
+}
+
+/**
+ * Multi-controlled gate applied by definition: matrix acts on target where every control is |1>.
+*/
+qce::DynamicQubitState controlled_reference(
+    qce::DynamicQubitState state,
+    std::size_t n,
+    std::size_t target,
+    const std::vector<std::size_t> &controls,
+    const qce::QubitMat_t &matrix
+) {
+    uint64_t targetBit = uint64_t(1) << (n - 1 - target), mask = 0;
+    for (std::size_t control: controls) {
+        mask |= uint64_t(1) << (n - 1 - control);
+    }
+    for (uint64_t index = 0; index < (uint64_t(1) << n); index++) {
+        if ((index & targetBit) != 0 || (index & mask) != mask) {
+            continue;
+        }
+        auto a0 = state[(Eigen::Index)index], a1 = state[(Eigen::Index)(index | targetBit)];
+        state[(Eigen::Index)index] = matrix(0, 0) * a0 + matrix(0, 1) * a1;
+        state[(Eigen::Index)(index | targetBit)] = matrix(1, 0) * a0 + matrix(1, 1) * a1;
+    }
+    return state;
+}
+
+void fill_multi_controlled_circuit(qce::QubitEnv &env) {
+    env.hadamard(0); env.hadamard(2); env.cs(1, 0); env.hadamard(3); env.cnot(4, 2); env.hadamard(1);
+    env.toffoli(4, 0, 1);
+    env.mcz(2, {0, 3, 4});
+    env.mcphase(1, {2, 3}, 0.7);
+    env.cfredkin(0, 3, 2);
+    env.mcu(3, {1, 4}, qce::qubitconsts::hadamard_gate);
+    env.y(4);
+    env.mcswap(1, 4, {0, 2, 3});
+    env.mcx(0, {1, 2, 3, 4});
+    env.unitary(qce::qubitconsts::cnot_gate, {2, 4});
+    env.qft({3, 1, 4}); env.phaseOracle([](uint64_t value) { return value != 1; }, {0, 2}); env.groverDiffusion({1, 0});
+}
+
+void circuit_format_test() {
+    const char *directory = std::getenv("TMPDIR");
+    const std::string path = std::string(directory != nullptr ? directory : "/tmp") +
+        "/qce-circuit-" + std::to_string(getpid());
+
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 4; i++) {
+        qubits.emplace_back(i % 2 == 0 ? qce::qubitconsts::plus_basis_state : qce::qubitconsts::one_basis_state);
+    }
+    qce::QubitEnv env(qubits);
+    fill_mixed_circuit(env);
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    qce::operations::writeCircuit(path, env);
+    qce::operations::MappedCircuit circuit(path);
+    assert(circuit.getQubitsCount() == 4);
+    assert(circuit.getGatesCount() == 23);
+    qce::simulator::StreamSimulator stream;
+    assert(stream.constructSolution(circuit).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    // indices above 127 take several varint bytes
+    qce::QubitEnv wide(16384, qce::qubitconsts::zero_basis_state);
+    wide.cnot(299, 0); wide.hadamard(128); wide.swap(1, 200); wide.cs(16383, 299);
+    qce::operations::writeCircuit(path, wide);
+    qce::operations::MappedCircuit wideCircuit(path);
+    std::vector<qce::operations::GateRecord> decoded;
+    wideCircuit.forEachGate([&](const qce::operations::GateRecord &gate) { decoded.push_back(gate); });
+    const auto &nodes = wide.provideExecutionArgs().getNodes();
+    assert(decoded.size() == nodes.size());
+    for (std::size_t i = 0; i < decoded.size(); i++) {
+        assert(decoded[i] == nodes[i].getData());
+    }
+    bool isWideRejected = false;
+    try {
+        stream.constructSolution(wideCircuit);
+    } catch (const std::invalid_argument &) {
+        isWideRejected = true;
+    }
+    assert(isWideRejected);
+
+    // multi-controlled gates carry their controls and values in stream
+    qce::QubitEnv controlled(5, qce::qubitconsts::zero_basis_state);
+    fill_multi_controlled_circuit(controlled);
+    qce::operations::writeCircuit(path, controlled);
+    qce::operations::MappedCircuit controlledCircuit(path);
+    assert(controlledCircuit.getGatesCount() == controlled.provideExecutionArgs().getNodes().size());
+    assert(stream.constructSolution(controlledCircuit).getResult().isApprox(
+        sim.constructSolution(controlled).getResult(), GATE_EQ_PRECISION));
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+    }
+    bool isRejected = false;
+    try {
+        qce::operations::MappedCircuit damaged(path);
+    } catch (const std::runtime_error &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+
+    std::remove(path.c_str());
+}
+
+qce::QubitEnv prefix_family_member(std::size_t member) {
+    qce::QubitEnv env(6, qce::qubitconsts::zero_basis_state);
+    // 70 shared gates
+    for (std::size_t layer = 0; layer < 10; layer++) {
+        env.hadamard(layer % 6); env.cnot((layer + 1) % 6, layer % 6); env.s((layer + 2) % 6);
+        env.cz((layer + 3) % 6, (layer + 4) % 6); env.y(layer % 6); env.swap(1, (layer + 2) % 6 == 1 ? 0 : (layer + 2) % 6);
+        env.x((layer + 5) % 6);
+    }
+    // measurement basis of member
+    for (std::size_t qubit = 0; qubit < 6; qubit++) {
+        if (member % 3 == 1) {
+            env.hadamard(qubit);
+        } else if (member % 3 == 2) {
+            env.s(qubit); env.z(qubit); env.hadamard(qubit);
+        }
+    }
+
+    return env;
+}
+
+void prefix_cache_simulator_test() {
+    qce::simulator::SimpleSimulator sim;
+
+    qce::simulator::PrefixCacheSimulator cached(std::size_t(1) << 20, 16);
+    for (std::size_t member = 0; member < 3; member++) {
+        qce::QubitEnv env = prefix_family_member(member);
+        assert(cached.constructSolution(env).getResult().isApprox(sim.constructSolution(env).getResult(), GATE_EQ_PRECISION));
+    }
+    // every member after the first starts from checkpoint at 64 gates
+    assert(cached.getSkippedGates() == 2 * 64);
+
+    // repeated circuit starts from its final state
+    qce::QubitEnv repeated = prefix_family_member(1);
+    std::size_t gatesCount = repeated.provideExecutionArgs().getNodes().size();
+    assert(cached.constructSolution(repeated).getResult().isApprox(sim.constructSolution(repeated).getResult(), GATE_EQ_PRECISION));
+    assert(cached.getSkippedGates() == 2 * 64 + gatesCount);
+
+    // room for one state in memory, evicted states go to disk and come back
+    const char *directory = std::getenv("TMPDIR");
+    qce::simulator::PrefixCacheSimulator spilling(64 * 16, 16, directory != nullptr ? directory : "/tmp", std::size_t(1) << 20);
+    for (std::size_t member = 0; member < 3; member++) {
+        qce::QubitEnv env = prefix_family_member(member);
+        assert(spilling.constructSolution(env).getResult().isApprox(sim.constructSolution(env).getResult(), GATE_EQ_PRECISION));
+    }
+    const auto &statistics = spilling.getCache().getStatistics();
+    assert(spilling.getCache().getUsedMemory() <= 64 * 16);
+    assert(statistics.evictions > 0 && statistics.spills > 0);
+    assert(statistics.diskHits == 2);
+    assert(spilling.getSkippedGates() == 2 * 64);
+
+    // without spill directory evicted states are lost
+    qce::simulator::PrefixCacheSimulator small(64 * 16, 16);
+    for (std::size_t member = 0; member < 3; member++) {
+        qce::QubitEnv env = prefix_family_member(member);
+        assert(small.constructSolution(env).getResult().isApprox(sim.constructSolution(env).getResult(), GATE_EQ_PRECISION));
+    }
+    assert(small.getSkippedGates() == 0);
+    assert(small.getCache().getStatistics().spills == 0);
+}
+
+void result_cache_test() {
+    const char *base = std::getenv("TMPDIR");
+    std::string directory = std::string(base != nullptr ? base : "/tmp") + "/qce-results-XXXXXX";
+    const char *created = mkdtemp(&directory[0]);
+    assert(created != nullptr);
+
+    qce::QubitEnv env(4, qce::qubitconsts::zero_basis_state);
+    fill_mixed_circuit(env);
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    // 16 amplitudes take 256 bytes, with header two states fit
+    const uint64_t maxBytes = 2 * (256 + sizeof(qce::simulator::ResultFileHeader));
+    {
+        qce::simulator::ResultCache cache(directory, maxBytes, 16);
+        qce::simulator::CachedSimulator cached(sim, "simple", cache);
+        assert(cached.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+        assert(cached.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+        assert(cache.getStatistics().misses == 1 && cache.getStatistics().hits == 1);
+
+        // directory is locked while cache is open
+        bool isRejected = false;
+        try {
+            qce::simulator::ResultCache second(directory, maxBytes, 16);
+        } catch (const std::runtime_error &) {
+            isRejected = true;
+        }
+        assert(isRejected);
+    }
+
+    // index and results persist between runs, key depends on backend and gates
+    qce::simulator::ResultCache cache(directory, maxBytes, 16);
+    qce::simulator::CachedSimulator cached(sim, "simple", cache);
+    assert(cache.getEntriesCount() == 1);
+    assert(cached.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(cache.getStatistics().hits == 1);
+
+    const qce::simulator::ResultKey key = qce::simulator::resultKeyOf(env, "simple", "complex128", qce::simulator::ResultKind::State);
+    assert(key != qce::simulator::resultKeyOf(env, "parallel", "complex128", qce::simulator::ResultKind::State));
+    qce::QubitEnv other = env;
+    other.x(0);
+    assert(key != qce::simulator::resultKeyOf(other, "simple", "complex128", qce::simulator::ResultKind::State));
+
+    // the least recently used result is evicted when size limit is reached
+    qce::QubitEnv third = env;
+    third.y(2);
+    cached.constructSolution(other);
+    cached.constructSolution(env);
+    cached.constructSolution(third);
+    assert(cache.getStatistics().evictions == 1);
+    assert(cache.contains(key));
+    assert(!cache.contains(qce::simulator::resultKeyOf(other, "simple", "complex128", qce::simulator::ResultKind::State)));
+    assert(cache.getUsedBytes() <= maxBytes);
+
+    // damaged result is dropped and recomputed
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key.key);
+        std::fstream file(directory + "/" + name + ".result", std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(100);
+        file.put('\x5a');
+    }
+    assert(cached.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(cache.getStatistics().damaged == 1);
+    assert(cache.contains(key));
+
+    // colliding key with another check is a miss and doesn't drop result of key
+    const qce::simulator::ResultKey colliding{key.key, key.check ^ 1};
+    qce::DynamicQubitState loaded;
+    assert(!cache.contains(colliding));
+    assert(!cache.loadState(colliding, loaded));
+    assert(cache.loadState(key, loaded) && loaded.isApprox(expected, GATE_EQ_PRECISION));
+
+    // histogram is cached with its shots
+    qce::simulator::Histogram histogram = cached.sample(env, 100);
+    uint64_t shots = 0;
+    for (const auto &entry: histogram) {
+        assert(std::norm(expected[(Eigen::Index)entry.first]) > 0);
+        shots += entry.second;
+    }
+    assert(shots == 100);
+    assert(cached.sample(env, 100) == histogram);
+
+    // result which can't be written is still returned, directory in place of temporary file blocks it
+    qce::QubitEnv fourth = env;
+    fourth.z(3);
+    const qce::simulator::ResultKey fourthKey = qce::simulator::resultKeyOf(fourth, "simple", "complex128", qce::simulator::ResultKind::State);
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)fourthKey.key);
+        assert(mkdir((directory + "/" + name + ".result.tmp").c_str(), 0755) == 0);
+    }
+    assert(cached.constructSolution(fourth).getResult().isApprox(sim.constructSolution(fourth).getResult(), GATE_EQ_PRECISION));
+    assert(cache.getStatistics().failedStores == 1);
+    assert(!cache.contains(fourthKey));
+
+    cache.remove(key);
+    cache.remove(qce::simulator::resultKeyOf(third, "simple", "complex128", qce::simulator::ResultKind::State));
+    cache.remove(qce::simulator::resultKeyOf(env, "simple", "complex128", qce::simulator::ResultKind::Histogram, 100));
+    assert(cache.getEntriesCount() == 0);
+    std::remove((directory + "/index").c_str());
+    assert(rmdir(directory.c_str()) == 0);
+}
+
+void hybrid_simulator_test() {
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 8; i++) {
+        qubits.emplace_back(i % 3 == 1 ? qce::qubitconsts::plus_basis_state : qce::qubitconsts::zero_basis_state);
+    }
+    qce::QubitEnv env(qubits);
+    for (std::size_t i = 0; i < 8; i += 2) {
+        env.hadamard(i);
+    }
+    // every kind of two qubit gate both inside halves and across cut, in both directions
+    env.cnot(5, 1); env.cz(2, 6); env.swap(3, 4); env.cs(7, 0); env.cnot(1, 2); env.y(4);
+    env.cnot(0, 7); env.swap(6, 2); env.s(3); env.cz(5, 4); env.cs(1, 6); env.hadamard(5);
+    env.x(0); env.swap(0, 1); env.cnot(7, 3);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+    std::vector<uint64_t> basisStates;
+    for (uint64_t x = 0; x < 256; x++) {
+        basisStates.push_back(x);
+    }
+
+    for (std::size_t cut: {0, 3, 7}) {
+        for (std::size_t threads: {1, 3}) {
+            qce::simulator::HybridSimulator hybrid(threads, cut);
+            auto amplitudes = hybrid.amplitudes(env, basisStates);
+            for (uint64_t x = 0; x < 256; x++) {
+                assert(std::abs(amplitudes[x] - expected[(Eigen::Index)x]) < GATE_EQ_PRECISION);
+            }
+        }
+    }
+    qce::simulator::HybridSimulator middle(1);
+    middle.amplitude(env, 0);
+    // six controlled gates of two terms and two swaps of four terms cross the middle
+    assert(middle.getStatistics().cutGates == 8);
+    assert(middle.getStatistics().paths == 64 * 16);
+
+    // GHZ state of 36 qubits needs two half states of 2^18 amplitudes
+    qce::QubitEnv wide(36, qce::qubitconsts::zero_basis_state);
+    wide.hadamard(0);
+    for (std::size_t i = 1; i < 36; i++) {
+        wide.cnot(i, i - 1);
+    }
+    qce::simulator::HybridSimulator hybrid(2);
+    auto amplitudes = hybrid.amplitudes(wide, {0, (uint64_t(1) << 36) - 1, 1, uint64_t(1) << 35});
+    assert(std::abs(amplitudes[0] - M_SQRT1_2) < GATE_EQ_PRECISION);
+    assert(std::abs(amplitudes[1] - M_SQRT1_2) < GATE_EQ_PRECISION);
+    assert(std::abs(amplitudes[2]) < GATE_EQ_PRECISION && std::abs(amplitudes[3]) < GATE_EQ_PRECISION);
+    assert(hybrid.getStatistics().paths == 2);
+
+    bool isRejected = false;
+    try {
+        hybrid.amplitude(wide, uint64_t(1) << 36);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+}
+
+void sparse_simulator_test() {
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 10; i++) {
+        qubits.emplace_back(i == 4 ? qce::qubitconsts::minus_basis_state : qce::qubitconsts::zero_basis_state);
+    }
+    qce::QubitEnv env(qubits);
+    env.x(0); env.cnot(3, 0); env.swap(3, 9); env.hadamard(2); env.y(2); env.cz(2, 9);
+    env.s(4); env.cs(2, 4); env.hadamard(2); env.z(9); env.cnot(7, 2); env.hadamard(5);
+    env.hadamard(6); env.hadamard(1); env.cnot(8, 6); env.y(1); env.s(8); env.swap(1, 6);
+
+    qce::simulator::SimpleSimulator simple;
+    auto expected = simple.constructSolution(env).getResult();
+
+    // cutoff 1 keeps the whole circuit sparse, cutoff 1/64 moves to dense state
+    qce::simulator::SparseSimulator sparse(1e-12, 1.);
+    assert(sparse.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(sparse.getStatistics().denseFallbacks == 0);
+    // minus state and hadamards on four qubits branch into at most 2^5 entries
+    assert(sparse.getStatistics().maxEntries > 1 && sparse.getStatistics().maxEntries <= 32);
+
+    qce::simulator::SparseSimulator fallback(1e-12, 1. / 64);
+    assert(fallback.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(fallback.getStatistics().denseFallbacks == 1);
+
+    // second hadamard cancels half of entries, they are pruned
+    qce::QubitEnv twice(10, qce::qubitconsts::zero_basis_state);
+    twice.hadamard(3); twice.cnot(5, 3); twice.cnot(5, 3); twice.hadamard(3);
+    auto state = sparse.sparseState(twice);
+    assert(state.size() == 1 && std::abs(state.amplitude(0) - 1.) < GATE_EQ_PRECISION);
+    assert(sparse.getStatistics().prunedEntries == 1);
+
+    // GHZ state with shifted bits on 50 qubits keeps two entries
+    qce::QubitEnv wide(50, qce::qubitconsts::zero_basis_state);
+    wide.hadamard(0);
+    for (std::size_t i = 1; i < 50; i++) {
+        wide.cnot(i, i - 1);
+    }
+    wide.x(49); wide.swap(0, 49); wide.z(0);
+    state = sparse.sparseState(wide);
+    uint64_t ones = (uint64_t(1) << 50) - 1;
+    assert(state.size() == 2);
+    assert(std::abs(state.amplitude(ones ^ (uint64_t(1) << 49)) - M_SQRT1_2) < GATE_EQ_PRECISION);
+    assert(std::abs(state.amplitude(uint64_t(1) << 49) + M_SQRT1_2) < GATE_EQ_PRECISION);
+    assert(std::abs(state.amplitude(0)) < GATE_EQ_PRECISION);
+
+    bool isRejected = false;
+    try {
+        sparse.sparseState(env, 8);
+    } catch (const std::runtime_error &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+}
+
+void reversible_simulator_test() {
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 8; i++) {
+        qubits.emplace_back(i % 3 == 0 ? qce::qubitconsts::one_basis_state : qce::qubitconsts::zero_basis_state);
+    }
+    qce::QubitEnv env(qubits);
+    env.cnot(1, 0); env.x(2); env.swap(2, 7); env.cnot(4, 1); env.swap(0, 5); env.cnot(0, 3); env.x(6);
+
+    qce::simulator::SimpleSimulator simple;
+    qce::simulator::ReversibleSimulator reversible;
+    assert(qce::simulator::isClassicalCircuit(env));
+    assert(reversible.constructSolution(env).getResult().isApprox(simple.constructSolution(env).getResult(), GATE_EQ_PRECISION));
+
+    // hadamard makes circuit quantum, it's simulated densely
+    qce::QubitEnv quantum = env;
+    quantum.hadamard(4);
+    assert(!qce::simulator::isClassicalCircuit(quantum));
+    assert(reversible.constructSolution(quantum).getResult().isApprox(simple.constructSolution(quantum).getResult(), GATE_EQ_PRECISION));
+
+    // 130 qubits register: one travels along the chain by cnot and swap, setting every even qubit
+    qce::QubitEnv wide(130, qce::qubitconsts::zero_basis_state);
+    wide.x(0);
+    for (uint32_t i = 1; i < 130; i += 2) {
+        wide.cnot(i, i - 1);
+        wide.swap(i, i + 1 < 130 ? i + 1 : 0);
+    }
+    auto bits = reversible.evaluate(wide);
+    assert(bits.size() == 3);
+    for (uint32_t i = 0; i < 130; i++) {
+        bool expected = i % 2 == 0 || i == 129;
+        assert(((bits[i / 64] >> (i % 64)) & 1) == (uint64_t)expected);
+    }
+    bool isRejected = false;
+    try {
+        reversible.evaluate(quantum);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+
+    // bit-sliced batch of all 64 inputs of 6 qubits, qubit q of input v is bit q of v
+    qce::QubitEnv small(6, qce::qubitconsts::zero_basis_state);
+    small.cnot(1, 0); small.swap(2, 3); small.x(5); small.cnot(4, 5);
+    std::vector<uint64_t> lanes(6, 0);
+    for (uint64_t v = 0; v < 64; v++) {
+        for (std::size_t q = 0; q < 6; q++) {
+            lanes[q] |= ((v >> q) & 1) << v;
+        }
+    }
+    auto outputs = reversible.evaluateBatch(small, lanes);
+    for (uint64_t v = 0; v < 64; v++) {
+        auto inputBit = [&](std::size_t q) { return (v >> q) & 1; };
+        uint64_t expected[6] = {
+            inputBit(0), inputBit(1) ^ inputBit(0), inputBit(3), inputBit(2),
+            inputBit(4) ^ inputBit(5) ^ 1, inputBit(5) ^ 1
+        };
+        for (std::size_t q = 0; q < 6; q++) {
+            assert(((outputs[q] >> v) & 1) == expected[q]);
+        }
+    }
+
+    // Toffoli and Fredkin keep circuit classical, on registers of any width
+    qce::QubitEnv gates(120, qce::qubitconsts::zero_basis_state);
+    gates.x(0); gates.x(1);
+    gates.toffoli(119, 0, 1); gates.cfredkin(2, 119, 0); gates.mcx(60, {0, 1, 2}); gates.mcx(61, {0, 3});
+    assert(qce::simulator::isClassicalCircuit(gates));
+    auto gateBits = reversible.evaluate(gates);
+    for (uint32_t i = 0; i < 120; i++) {
+        bool expected = i <= 2 || i == 60;
+        assert(((gateBits[i / 64] >> (i % 64)) & 1) == (uint64_t)expected);
+    }
+
+    qce::QubitEnv sliced(6, qce::qubitconsts::zero_basis_state);
+    sliced.toffoli(0, 1, 2); sliced.cfredkin(3, 4, 5);
+    auto slicedOutputs = reversible.evaluateBatch(sliced, lanes);
+    for (uint64_t v = 0; v < 64; v++) {
+        auto inputBit = [&](std::size_t q) { return (v >> q) & 1; };
+        uint64_t expected[6] = {
+            inputBit(0) ^ (inputBit(1) & inputBit(2)), inputBit(1), inputBit(2),
+            inputBit(5) ? inputBit(4) : inputBit(3), inputBit(5) ? inputBit(3) : inputBit(4), inputBit(5)
+        };
+        for (std::size_t q = 0; q < 6; q++) {
+            assert(((slicedOutputs[q] >> v) & 1) == expected[q]);
+        }
+    }
+}
+
+void multi_controlled_gates_test() {
+    qce::simulator::SimpleSimulator sim;
+
+    // Toffoli and Fredkin match their 8x8 matrices
+    qce::QubitEnv small(3, qce::qubitconsts::zero_basis_state);
+    small.hadamard(0); small.hadamard(1); small.cs(2, 1); small.hadamard(2); small.cnot(0, 2); small.s(0);
+    auto prepared = sim.constructSolution(small).getResult();
+    qce::QubitEnv toffoli = small;
+    toffoli.toffoli(2, 0, 1);
+    assert(sim.constructSolution(toffoli).getResult().isApprox(qce::qubitconsts::toffoli_gate * prepared, GATE_EQ_PRECISION));
+    qce::QubitEnv fredkin = small;
+    fredkin.cfredkin(1, 2, 0);
+    assert(sim.constructSolution(fredkin).getResult().isApprox(qce::qubitconsts::fredkin_gate * prepared, GATE_EQ_PRECISION));
+
+    // every kind against its definition, swap is three multi-controlled X gates
+    qce::QubitEnv base(5, qce::qubitconsts::zero_basis_state);
+    base.hadamard(0); base.hadamard(1); base.cs(2, 0); base.hadamard(2); base.hadamard(3); base.cnot(4, 3); base.hadamard(4);
+    auto state = sim.constructSolution(base).getResult();
+    qce::QubitMat_t phase;
+    phase << 1, 0, 0, std::polar(1., 0.7);
+
+    qce::QubitEnv mcx = base;
+    mcx.mcx(4, {0, 1, 2});
+    assert(sim.constructSolution(mcx).getResult().isApprox(
+        controlled_reference(state, 5, 4, {0, 1, 2}, qce::qubitconsts::pauli_x_gate), GATE_EQ_PRECISION));
+    qce::QubitEnv mcz = base;
+    mcz.mcz(2, {0, 3, 4});
+    assert(sim.constructSolution(mcz).getResult().isApprox(
+        controlled_reference(state, 5, 2, {0, 3, 4}, qce::qubitconsts::pauli_z_gate), GATE_EQ_PRECISION));
+    qce::QubitEnv mcphase = base;
+    mcphase.mcphase(1, {2, 3}, 0.7);
+    assert(sim.constructSolution(mcphase).getResult().isApprox(
+        controlled_reference(state, 5, 1, {2, 3}, phase), GATE_EQ_PRECISION));
+    qce::QubitEnv mcu = base;
+    mcu.mcu(3, {1, 4}, qce::qubitconsts::hadamard_gate);
+    assert(sim.constructSolution(mcu).getResult().isApprox(
+        controlled_reference(state, 5, 3, {1, 4}, qce::qubitconsts::hadamard_gate), GATE_EQ_PRECISION));
+    qce::QubitEnv mcswap = base;
+    mcswap.mcswap(1, 4, {0, 3});
+    auto swapped = controlled_reference(state, 5, 1, {4, 0, 3}, qce::qubitconsts::pauli_x_gate);
+    swapped = controlled_reference(swapped, 5, 4, {1, 0, 3}, qce::qubitconsts::pauli_x_gate);
+    swapped = controlled_reference(swapped, 5, 1, {4, 0, 3}, qce::qubitconsts::pauli_x_gate);
+    assert(sim.constructSolution(mcswap).getResult().isApprox(swapped, GATE_EQ_PRECISION));
+
+    // eager execution and other backends agree with graph of multi-controlled gates
+    qce::QubitEnv env(5, qce::qubitconsts::zero_basis_state);
+    fill_multi_controlled_circuit(env);
+    auto expected = sim.constructSolution(env).getResult();
+    for (std::size_t fusionWindow: {0, 4}) {
+        qce::QubitEnv eager(5, qce::qubitconsts::zero_basis_state);
+        eager.enableEagerExecution(fusionWindow);
+        fill_multi_controlled_circuit(eager);
+        eager.flush();
+        assert(eager.getLiveState().isApprox(expected, GATE_EQ_PRECISION));
+    }
+    qce::simulator::ParallelSimulator parallel(3);
+    assert(parallel.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    qce::simulator::BlockedSimulator blocked(3);
+    assert(blocked.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    qce::simulator::SparseSimulator sparse(1e-12, 1.);
+    assert(sparse.constructSolution(env).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    assert(sparse.getStatistics().denseFallbacks == 0);
+
+    // hybrid simulator applies gates inside a half, gate across cut is rejected
+    qce::QubitEnv halves(6, qce::qubitconsts::plus_basis_state);
+    halves.toffoli(2, 0, 1); halves.cnot(3, 2); halves.mcz(5, {3, 4}); halves.mcu(4, {3}, qce::qubitconsts::hadamard_gate);
+    auto halvesExpected = sim.constructSolution(halves).getResult();
+    qce::simulator::HybridSimulator hybrid(1, 3);
+    for (uint64_t x = 0; x < 64; x += 7) {
+        assert(std::abs(hybrid.amplitude(halves, x) - halvesExpected[(Eigen::Index)x]) < GATE_EQ_PRECISION);
+    }
+    halves.toffoli(3, 0, 1);
+    bool isRejected = false;
+    try {
+        hybrid.amplitude(halves, 0);
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+
+    // repeated or missing qubits are rejected
+    std::size_t rejected = 0;
+    for (auto add: std::vector<std::function<void(qce::QubitEnv&)>>{
+        [](qce::QubitEnv &e) { e.mcx(2, {0, 2}); },
+        [](qce::QubitEnv &e) { e.mcz(0, {1, 1}); },
+        [](qce::QubitEnv &e) { e.mcswap(1, 1, {0}); },
+        [](qce::QubitEnv &e) { e.toffoli(5, 0, 1); }
+    }) {
+        qce::QubitEnv invalid(5, qce::qubitconsts::zero_basis_state);
+        try {
+            add(invalid);
+        } catch (const std::invalid_argument &) {
+            rejected++;
+        }
+    }
+    assert(rejected == 4);
+}
+
+qce::DynamicQubitMat_t kronecker(const qce::DynamicQubitMat_t &first, const qce::DynamicQubitMat_t &second) {
+    qce::DynamicQubitMat_t result(first.rows() * second.rows(), first.cols() * second.cols());
+    for (Eigen::Index row = 0; row < first.rows(); row++) {
+        for (Eigen::Index column = 0; column < first.cols(); column++) {
+            result.block(row * second.rows(), column * second.cols(), second.rows(), second.cols()) = first(row, column) * second;
+        }
+    }
+    return result;
+}
+
+void unitary_gate_test() {
+    using namespace qce::qubitconsts;
+    qce::simulator::SimpleSimulator sim;
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 6; i++) {
+        qubits.emplace_back(i % 2 == 0 ? plus_basis_state : plusi_basis_state);
+    }
+    qce::QubitEnv base(qubits);
+    base.cnot(1, 0); base.cs(3, 2); base.hadamard(5); base.cnot(4, 5);
+
+    // the first qubit is the most significant bit of matrix index, for every k from 1 to 5
+    qce::QubitEnv env = base, expected = base;
+    env.unitary(hadamard_gate, {3});
+    expected.hadamard(3);
+    env.unitary(cnot_gate, {0, 2});
+    expected.cnot(2, 0);
+    env.unitary(toffoli_gate, {3, 5, 1});
+    expected.toffoli(1, 3, 5);
+    env.unitary(kronecker(cnot_gate, swap_gate), {4, 1, 0, 5});
+    expected.cnot(1, 4); expected.swap(0, 5);
+    env.unitary(kronecker(kronecker(hadamard_gate, pauli_x_gate), kronecker(phase_s_gate, kronecker(pauli_y_gate, hadamard_gate))), {4, 0, 2, 1, 3});
+    expected.hadamard(4); expected.x(0); expected.s(2); expected.y(1); expected.hadamard(3);
+    env.unitary(fredkin_gate, {2, 0, 1});
+    expected.cfredkin(0, 1, 2);
+    auto state = sim.constructSolution(expected).getResult();
+    assert(sim.constructSolution(env).getResult().isApprox(state, GATE_EQ_PRECISION));
+
+    // random dense unitaries agree between backends and eager execution
+    qce::QubitEnv random = base;
+    auto addRandom = [&](qce::QubitEnv &target) {
+        std::srand(7);
+        for (std::size_t k = 1; k <= 5; k++) {
+            qce::DynamicQubitMat_t matrix = qce::DynamicQubitMat_t::Random(1 << k, 1 << k);
+            qce::DynamicQubitMat_t q = Eigen::HouseholderQR<qce::DynamicQubitMat_t>(matrix).householderQ();
+            std::vector<std::size_t> gateQubits;
+            for (std::size_t j = 0; j < k; j++) {
+                gateQubits.push_back((j * 5 + k) % 6);
+            }
+            target.unitary(q, gateQubits);
+        }
+    };
+    addRandom(random);
+    auto randomState = sim.constructSolution(random).getResult();
+    assert(std::abs(randomState.norm() - 1) < GATE_EQ_PRECISION);
+    qce::QubitEnv eager = base;
+    eager.enableEagerExecution(4);
+    addRandom(eager);
+    eager.flush();
+    assert(eager.getLiveState().isApprox(randomState, GATE_EQ_PRECISION));
+    qce::simulator::ParallelSimulator parallel(3);
+    assert(parallel.constructSolution(random).getResult().isApprox(randomState, GATE_EQ_PRECISION));
+    qce::simulator::SparseSimulator sparse(1e-12, 1.);
+    assert(sparse.constructSolution(random).getResult().isApprox(randomState, GATE_EQ_PRECISION));
+
+    // matrix must match qubits and be unitary unless check is disabled
+    std::size_t rejected = 0;
+    qce::DynamicQubitMat_t doubled = 2 * qce::DynamicQubitMat_t::Identity(4, 4);
+    for (auto add: std::vector<std::function<void(qce::QubitEnv&)>>{
+        [&](qce::QubitEnv &e) { e.unitary(doubled, {0, 1}); },
+        [&](qce::QubitEnv &e) { e.unitary(cnot_gate, {0, 1, 2}); },
+        [&](qce::QubitEnv &e) { e.unitary(cnot_gate, {1, 1}); },
+        [&](qce::QubitEnv &e) { e.unitary(hadamard_gate, {6}); },
+        [&](qce::QubitEnv &e) { e.unitary(qce::DynamicQubitMat_t::Identity(64, 64), {0, 1, 2, 3, 4, 5}); }
+    }) {
+        qce::QubitEnv invalid = base;
+        try {
+            add(invalid);
+        } catch (const std::invalid_argument &) {
+            rejected++;
+        }
+    }
+    assert(rejected == 5);
+    qce::QubitEnv unchecked = base;
+    unchecked.unitary(doubled, {0, 1}, false);
+    assert(std::abs(sim.constructSolution(unchecked).getResult().norm() - 2) < GATE_EQ_PRECISION);
+}
+
+void fourier_decomposition(qce::QubitEnv &env, const std::vector<std::size_t> &qubits, bool inverse) {
+    const std::size_t k = qubits.size();
+    if (inverse) {
+        for (std::size_t j = 0; j < k / 2; j++) {
+            env.swap(qubits[j], qubits[k - 1 - j]);
+        }
+        for (std::size_t j = k; j-- > 0;) {
+            for (std::size_t m = k; m-- > j + 1;) {
+                env.mcphase(qubits[j], {qubits[m]}, -M_PI / (double)(std::size_t(1) << (m - j)));
+            }
+            env.hadamard(qubits[j]);
+        }
+        return;
+    }
+
+    for (std::size_t j = 0; j < k; j++) {
+        env.hadamard(qubits[j]);
+        for (std::size_t m = j + 1; m < k; m++) {
+            env.mcphase(qubits[j], {qubits[m]}, M_PI / (double)(std::size_t(1) << (m - j)));
+        }
+    }
+    for (std::size_t j = 0; j < k / 2; j++) {
+        env.swap(qubits[j], qubits[k - 1 - j]);
+    }
+}
+
+void register_operations_test() {
+    qce::simulator::SimpleSimulator sim;
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 6; i++) {
+        qubits.emplace_back(i % 3 == 0 ? qce::qubitconsts::plusi_basis_state : qce::qubitconsts::plus_basis_state);
+    }
+    qce::QubitEnv base(qubits);
+    base.cnot(2, 0); base.cs(4, 1); base.hadamard(4); base.y(5); base.cnot(3, 5); base.s(0); base.hadamard(1);
+    const std::vector<std::size_t> registerQubits = {1, 3, 4, 0};
+
+    // every operation against its decomposition into gates
+    qce::QubitEnv qft = base, qftGates = base;
+    qft.qft(registerQubits);
+    fourier_decomposition(qftGates, registerQubits, false);
+    auto qftState = sim.constructSolution(qftGates).getResult();
+    assert(sim.constructSolution(qft).getResult().isApprox(qftState, GATE_EQ_PRECISION));
+
+    qce::QubitEnv iqft = base, iqftGates = base;
+    iqft.iqft(registerQubits);
+    fourier_decomposition(iqftGates, registerQubits, true);
+    assert(sim.constructSolution(iqft).getResult().isApprox(sim.constructSolution(iqftGates).getResult(), GATE_EQ_PRECISION));
+    qft.iqft(registerQubits);
+    assert(sim.constructSolution(qft).getResult().isApprox(sim.constructSolution(base).getResult(), GATE_EQ_PRECISION));
+
+    qce::QubitEnv diffusion = base, diffusionGates = base;
+    diffusion.groverDiffusion(registerQubits);
+    for (std::size_t qubit: registerQubits) {
+        diffusionGates.hadamard(qubit); diffusionGates.x(qubit);
+    }
+    diffusionGates.mcz(0, {1, 3, 4});
+    for (std::size_t qubit: registerQubits) {
+        diffusionGates.x(qubit); diffusionGates.hadamard(qubit);
+    }
+    auto diffusionState = sim.constructSolution(diffusionGates).getResult();
+    assert(sim.constructSolution(diffusion).getResult().isApprox(-diffusionState, GATE_EQ_PRECISION));
+
+    auto predicate = [](uint64_t value) { return value == 5 || value % 3 == 0; };
+    const std::vector<std::size_t> oracleQubits = {2, 5, 0};
+    qce::QubitEnv oracle = base, oracleGates = base;
+    oracle.phaseOracle(predicate, oracleQubits);
+    for (uint64_t value = 0; value < 8; value++) {
+        if (!predicate(value)) {
+            continue;
+        }
+        for (std::size_t j = 0; j < 3; j++) {
+            if (((value >> (2 - j)) & 1) == 0) {
+                oracleGates.x(oracleQubits[j]);
+            }
+        }
+        oracleGates.mcz(oracleQubits[2], {oracleQubits[0], oracleQubits[1]});
+        for (std::size_t j = 0; j < 3; j++) {
+            if (((value >> (2 - j)) & 1) == 0) {
+                oracleGates.x(oracleQubits[j]);
+            }
+        }
+    }
+    assert(sim.constructSolution(oracle).getResult().isApprox(sim.constructSolution(oracleGates).getResult(), GATE_EQ_PRECISION));
+    qce::QubitEnv wholeOracle = base, permutedOracle = base;
+    wholeOracle.phaseOracle([](uint64_t index) { return index % 7 == 2; });
+    permutedOracle.phaseOracle([](uint64_t index) { return index % 7 == 2; }, {0, 1, 2, 3, 4, 5});
+    assert(sim.constructSolution(wholeOracle).getResult().isApprox(sim.constructSolution(permutedOracle).getResult(), GATE_EQ_PRECISION));
+
+    // backends and eager execution
+    auto fillOperations = [&](qce::QubitEnv &env) {
+        env.qft(registerQubits); env.phaseOracle(predicate, oracleQubits); env.cnot(5, 1);
+        env.groverDiffusion({5, 2}); env.iqft({0, 2, 5});
+    };
+    qce::QubitEnv operations = base;
+    fillOperations(operations);
+    auto expected = sim.constructSolution(operations).getResult();
+    qce::QubitEnv eager = base;
+    eager.enableEagerExecution(4);
+    fillOperations(eager);
+    eager.flush();
+    assert(eager.getLiveState().isApprox(expected, GATE_EQ_PRECISION));
+    qce::simulator::ParallelSimulator parallel(3);
+    assert(parallel.constructSolution(operations).getResult().isApprox(expected, GATE_EQ_PRECISION));
+    qce::simulator::SparseSimulator sparse(1e-12, 1.);
+    assert(sparse.constructSolution(operations).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    // Grover search of 32 values finds marked one after 4 iterations
+    qce::QubitEnv search(5, qce::qubitconsts::plus_basis_state);
+    const std::vector<std::size_t> all = {0, 1, 2, 3, 4};
+    for (std::size_t iteration = 0; iteration < 4; iteration++) {
+        search.phaseOracle([](uint64_t value) { return value == 19; });
+        search.groverDiffusion(all);
+    }
+    assert(std::norm(sim.constructSolution(search).getResult()[19]) > 0.99);
+
+    bool isRejected = false;
+    try {
+        search.qft({});
+    } catch (const std::invalid_argument &) {
+        isRejected = true;
+    }
+    assert(isRejected);
+}
+
+qce::DynamicQubitMat_t pauli_matrix(char pauli) {
+    switch (pauli) {
+        case 'X': return qce::qubitconsts::pauli_x_gate;
+        case 'Y': return qce::qubitconsts::pauli_y_gate;
+        case 'Z': return qce::qubitconsts::pauli_z_gate;
+        default: return qce::qubitconsts::identity;
+    }
+}
+
+/**
+ * Dense matrix of Hamiltonian on n qubits, qubit 0 is the most significant.
+*/
+qce::DynamicQubitMat_t hamiltonian_matrix(const std::vector<qce::PauliTerm> &hamiltonian, std::size_t n) {
+    qce::DynamicQubitMat_t result = qce::DynamicQubitMat_t::Zero(1 << n, 1 << n);
+    for (const qce::PauliTerm &term: hamiltonian) {
+        std::string factors(n, 'I');
+        for (std::size_t j = 0; j < term.qubits.size(); j++) {
+            factors[term.qubits[j]] = term.paulis[j];
+        }
+        qce::DynamicQubitMat_t product = pauli_matrix(factors[0]);
+        for (std::size_t qubit = 1; qubit < n; qubit++) {
+            product = kronecker(product, pauli_matrix(factors[qubit]));
+        }
+        result += term.weight * product;
+    }
+    return result;
+}
+
+void pauli_evolution_test() {
+    qce::simulator::SimpleSimulator sim;
+    std::vector<qce::Qubit> qubits;
+    for (std::size_t i = 0; i < 5; i++) {
+        qubits.emplace_back(i % 2 == 0 ? qce::qubitconsts::plusi_basis_state : qce::qubitconsts::plus_basis_state);
+    }
+    qce::QubitEnv base(qubits);
+    base.cnot(1, 0); base.cs(2, 1); base.hadamard(3); base.cnot(4, 3); base.s(4);
+    auto state = sim.constructSolution(base).getResult();
+
+    // exp(-i theta P) = cos(theta) - i sin(theta) P, identity factors are skipped
+    const double theta = 0.37;
+    qce::QubitEnv rotation = base, pauli = base;
+    rotation.pauliExp("XIYZ", {1, 0, 3, 4}, theta);
+    pauli.x(1); pauli.y(3); pauli.z(4);
+    qce::DynamicQubitState expected = std::cos(theta) * state - qce::kernels::Amplitude_t(0, std::sin(theta)) * sim.constructSolution(pauli).getResult();
+    assert(sim.constructSolution(rotation).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    qce::QubitEnv diagonal = base, diagonalPauli = base;
+    diagonal.pauliExp("ZZ", {2, 0}, theta);
+    diagonalPauli.z(2); diagonalPauli.z(0);
+    expected = std::cos(theta) * state - qce::kernels::Amplitude_t(0, std::sin(theta)) * sim.constructSolution(diagonalPauli).getResult();
+    assert(sim.constructSolution(diagonal).getResult().isApprox(expected, GATE_EQ_PRECISION));
+
+    qce::QubitEnv identity = base;
+    identity.pauliExp("II", {1, 2}, theta);
+    assert(sim.constructSolution(identity).getResult().isApprox(std::polar(1., -theta) * state, GATE_EQ_PRECISION));
+
+    // Trotter step is diagonal group followed by other terms, the second order is symmetric
+    const std::vector<qce::PauliTerm> hamiltonian = {
+        {"ZZ", {0, 1}, 0.5}, {"X", {0}, 0.3}, {"YZ", {1, 2}, 0.2}, {"Z", {2}, 0.7}, {"I", {1}, 0.1}, {"XX", {3, 4}, -0.4}
+    };
+    const double step = 0.2;
+    qce::QubitEnv first = base, firstManual = base;
+    first.trotterStep(hamiltonian, step);
+    for (std::size_t i: {0, 3, 4}) {
+        firstManual.pauliExp(hamiltonian[i].paulis, hamiltonian[i].qubits, hamiltonian[i].weight * step);
+    }
+    for (std::size_t i: {1, 2, 5}) {
+        firstManual.pauliExp(hamiltonian[i].paulis, hamiltonian[i].qubits, hamiltonian[i].weight * step);
+    }
+    assert(sim.constructSolution(first).getResult().isApprox(sim.constructSolution(firstManual).getResult(), GATE_EQ_PRECISION));
+    // diagonal terms are one gate
+    assert(first.provideExecutionArgs().getNodes().size() == base.provideExecutionArgs().getNodes().size() + 4);
+
+    qce::QubitEnv second = base, secondManual = base;
+    second.trotterStep(hamiltonian, step, qce::TrotterOrder::Second);
+    for (std::size_t i: {0, 3, 4}) {
+        secondManual.pauliExp(hamiltonian[i].paulis, hamiltonian[i].qubits, hamiltonian[i].weight * step / 2);
+    }
+    for (std::size_t i: {1, 2}) {
+        secondManual.pauliExp(hamiltonian[i].paulis, hamiltonian[i].qubits, hamiltonian[i].weight * step / 2);
+    }
+    secondManual.pauliExp(hamiltonian[5].paulis, hamiltonian[5].qubits, hamiltonian[5].weight * step);
+    for (std::size_t i: {2, 1, 0, 3, 4}) {
+        secondManual.pauliExp(hamiltonian[i].paulis, hamiltonian[i].qubits, hamiltonian[i].weight * step / 2);
+    }
+    assert(sim.constructSolution(second).getResult().isApprox(sim.constructSolution(secondManual).getResult(), GATE_EQ_PRECISION));
+
+    // product formulas converge to exact evolution, the second order much faster
+    Eigen::SelfAdjointEigenSolver<qce::DynamicQubitMat_t> solver(hamiltonian_matrix(hamiltonian, 5));
+    const double time = 1;
+    qce::DynamicQubitState exact = solver.eigenvectors() *
+        (solver.eigenvalues().cast<qce::kernels::Amplitude_t>() * qce::kernels::Amplitude_t(0, -time)).array().exp().matrix().asDiagonal() *
+        solver.eigenvectors().adjoint() * state;
+    double errors[2];
+    for (qce::TrotterOrder order: {qce::TrotterOrder::First, qce::TrotterOrder::Second}) {
+        qce::QubitEnv evolved = base;
+        for (std::size_t i = 0; i < 8; i++) {
+            evolved.trotterStep(hamiltonian, time / 8, order);
+        }
+        errors[order == qce::TrotterOrder::First ? 0 : 1] = (sim.constructSolution(evolved).getResult() - exact).norm();
+    }
+    assert(errors[0] < 0.05 && errors[1] < 0.005 && errors[1] < errors[0] / 4);
+
+    // backends and eager execution
+    qce::QubitEnv eager = base;
+    eager.enableEagerExecution(4);
+    eager.trotterStep(hamiltonian, step, qce::TrotterOrder::Second);
+    eager.flush();
+    auto secondState = sim.constructSolution(second).getResult();
+    assert(eager.getLiveState().isApprox(secondState, GATE_EQ_PRECISION));
+    qce::simulator::ParallelSimulator parallel(3);
+    assert(parallel.constructSolution(second).getResult().isApprox(secondState, GATE_EQ_PRECISION));
+    qce::simulator::SparseSimulator sparse(1e-12, 1.);
+    assert(sparse.constructSolution(second).getResult().isApprox(secondState, GATE_EQ_PRECISION));
+
+    std::size_t rejected = 0;
+    for (auto add: std::vector<std::function<void(qce::QubitEnv&)>>{
+        [](qce::QubitEnv &e) { e.pauliExp("XA", {0, 1}, 1); },
+        [](qce::QubitEnv &e) { e.pauliExp("XZ", {0}, 1); },
+        [](qce::QubitEnv &e) { e.pauliExp("IZ", {7, 1}, 1); },
+        [](qce::QubitEnv &e) { e.trotterStep({{"ZZ", {0, 0, 1}, 1.}}, 1); }
+    }) {
+        qce::QubitEnv invalid = base;
+        try {
+            add(invalid);
+        } catch (const std::invalid_argument &) {
+            rejected++;
+        }
+    }
+    assert(rejected == 4);
+}
+
 int main() {
     qubit_env_no_gates_test();
     qubit_env_hadamard_test1();
@@ -191,6 +1539,26 @@ int main() {
     qubit_env_hadamard_cnot_test();
     qubit_env_hadamard_swap_test();
     qubit_env_cz_test();
+    qubit_env_invalid_qubits_test();
+    qubit_env_eager_test();
+    qubit_env_incremental_test();
+    remapping_simulator_test();
+    blocked_simulator_test();
+    parallel_simulator_test();
+    out_of_core_simulator_test();
+    chunked_simulator_test();
+    large_state_test();
+    checkpoint_restore_test();
+    circuit_format_test();
+    prefix_cache_simulator_test();
+    result_cache_test();
+    hybrid_simulator_test();
+    sparse_simulator_test();
+    reversible_simulator_test();
+    multi_controlled_gates_test();
+    unitary_gate_test();
+    register_operations_test();
+    pauli_evolution_test();
 
     simulator_solution_test();
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <cassert>
+#include <dirent.h>
+#include <stdexcept>
+#include <sys/resource.h>
+
+#include "QubitEnv.hpp"
+#include "Simulator.hpp"
+#include "ShardedSimulator.hpp"
+#include "QubitConsts.hpp"
+
+const double GATE_EQ_PRECISION = 1e-5;
+
+void fill_circuit(qce::QubitEnv &env) {
+    for (std::size_t i = 0; i < env.getQubitCount(); i++) {
+        env.hadamard(i);
+    }
+    // qubits 0 and 1 are global for 4 ranks
+    env.cnot(0, 4); env.s(1); env.cz(0, 1); env.y(2); env.swap(1, 4); env.cs(0, 3);
+    env.x(0); env.cnot(3, 1); env.hadamard(0); env.swap(0, 1); env.z(2); env.cnot(4, 0);
+    env.hadamard(1); env.y(0);
+}
+
+void sharded_simulator_test() {
+    qce::QubitEnv env(5, qce::qubitconsts::zero_basis_state);
+    env.x(2);
+    fill_circuit(env);
+
+    qce::simulator::SimpleSimulator sim;
+    auto expected = sim.constructSolution(env).getResult();
+
+    for (std::size_t ranks: {1, 2, 4, 8}) {
+        qce::simulator::ShardedSimulator sharded(ranks);
+        auto result = sharded.constructSolution(env).getResult();
+        assert(result.isApprox(expected, GATE_EQ_PRECISION));
+        assert((ranks == 1) == (sharded.getStatistics().globalSwaps == 0));
+    }
+}
+
+void sharded_initial_state_test() {
+    // initial states of global qubits are taken into account
+    std::vector<qce::Qubit> qubits = {
+        qce::Qubit(qce::qubitconsts::one_basis_state), qce::Qubit(qce::qubitconsts::plus_basis_state),
+        qce::Qubit(qce::qubitconsts::zero_basis_state), qce::Qubit(qce::qubitconsts::minus_basis_state)
+    };
+    qce::QubitEnv env(qubits);
+    env.cnot(2, 0); env.hadamard(1);
+
+    qce::simulator::SimpleSimulator sim;
+    qce::simulator::ShardedSimulator sharded(4);
+    assert(sharded.constructSolution(env).getResult().isApprox(sim.constructSolution(env).getResult(), GATE_EQ_PRECISION));
+}
+
+std::size_t open_descriptors_count() {
+    std::size_t count = 0;
+    DIR *directory = opendir("/proc/self/fd");
+    assert(directory != nullptr);
+    while (readdir(directory) != nullptr) {
+        count++;
+    }
+    closedir(directory);
+    return count;
+}
+
+void sharded_setup_failure_test() {
+    // 8 ranks need 56 sockets, with lower limit of descriptors mesh can't be created
+    qce::QubitEnv env(5, qce::qubitconsts::zero_basis_state);
+    fill_circuit(env);
+    const std::size_t openCount = open_descriptors_count();
+    rlimit limit;
+    assert(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+    rlimit lowered = limit;
+    lowered.rlim_cur = openCount + 16;
+    assert(setrlimit(RLIMIT_NOFILE, &lowered) == 0);
+
+    bool isRejected = false;
+    try {
+        qce::simulator::ShardedSimulator sharded(8);
+        sharded.constructSolution(env);
+    } catch (const std::runtime_error &) {
+        isRejected = true;
+    }
+    assert(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+    assert(isRejected);
+    // sockets created before failure are closed
+    assert(open_descriptors_count() == openCount);
+}
+
+int main() {
+    sharded_simulator_test();
+    sharded_initial_state_test();
+    sharded_setup_failure_test();
+}